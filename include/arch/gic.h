@@ -65,6 +65,7 @@ void gic_init(void);
 void gic_enable_interrupt(u32 irq);
 void gic_disable_interrupt(u32 irq);
 void gic_set_type(u32 irq, irq_type_t type);
+void gic_set_priority(u32 irq, u8 priority);
 u32 gic_get_interrupt(void);
 void gic_end_interrupt(u32 irq);
 int gic_register_handler(u32 irq, irq_handler_t handler, void *data);
@@ -10,4 +10,10 @@
 // UART interrupts
 #define IRQ_UART 153
 
+// GIC priorities, lower is more urgent: of several pending interrupts the GIC signals the most urgent first.
+#define IRQ_PRIORITY_DEFAULT 0x80
+#define IRQ_PRIORITY_SYSTEM_TIMER 0x40
+// UART0 and UART3 share one interrupt, the handler serves the Marklin line before the console
+#define IRQ_PRIORITY_UART 0xA0
+
 #endif // ARCH_INTERRUPTS_H
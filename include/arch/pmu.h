@@ -0,0 +1,55 @@
+#ifndef PMU_H
+#define PMU_H
+
+#include "types.h"
+
+// ARMv8 common event numbers, counted by event counters 0 and 1
+#define PMU_EVENT_L1D_CACHE_REFILL 0x03
+#define PMU_EVENT_L1D_CACHE 0x04
+
+#define PMCR_E (1 << 0) // Enable all counters
+#define PMCR_P (1 << 1) // Reset event counters
+#define PMCR_C (1 << 2) // Reset cycle counter
+#define PMCR_LC (1 << 6) // 64-bit cycle counter
+
+#define PMUSERENR_EN (1 << 0) // EL0 access to the PMU
+#define PMUSERENR_CR (1 << 2) // EL0 reads of the cycle counter
+#define PMUSERENR_ER (1 << 3) // EL0 reads of the event counters
+
+#ifdef __KERNEL__
+// Start the cycle counter and event counters 0/1 (L1D refills, L1D accesses) at EL0 and EL1,
+// and let user space read them so benchmarks need no syscall per sample
+static inline void pmu_init(void)
+{
+	asm volatile("msr pmevtyper0_el0, %0" ::"r"((u64)PMU_EVENT_L1D_CACHE_REFILL));
+	asm volatile("msr pmevtyper1_el0, %0" ::"r"((u64)PMU_EVENT_L1D_CACHE));
+	asm volatile("msr pmccfiltr_el0, %0" ::"r"((u64)0));
+	asm volatile("msr pmcntenset_el0, %0" ::"r"((u64)((1U << 31) | 0x3)));
+	asm volatile("msr pmuserenr_el0, %0" ::"r"((u64)(PMUSERENR_EN | PMUSERENR_CR | PMUSERENR_ER)));
+	asm volatile("msr pmcr_el0, %0" ::"r"((u64)(PMCR_E | PMCR_P | PMCR_C | PMCR_LC)));
+	asm volatile("isb");
+}
+#endif /* __KERNEL__ */
+
+static inline u64 pmu_read_cycles(void)
+{
+	u64 cycles;
+	asm volatile("mrs %0, pmccntr_el0" : "=r"(cycles));
+	return cycles;
+}
+
+static inline u32 pmu_read_l1d_refills(void)
+{
+	u64 count;
+	asm volatile("mrs %0, pmevcntr0_el0" : "=r"(count));
+	return (u32)count;
+}
+
+static inline u32 pmu_read_l1d_accesses(void)
+{
+	u64 count;
+	asm volatile("mrs %0, pmevcntr1_el0" : "=r"(count));
+	return (u32)count;
+}
+
+#endif /* PMU_H */
@@ -91,4 +91,8 @@ struct __attribute__((packed)) arch_regs {
 		: "memory"); \
 })
 
+// Unmask and mask IRQs on this core (PSTATE.I). The kernel otherwise runs with IRQs masked throughout.
+#define local_irq_enable() asm volatile("msr daifclr, #2\n" : : : "memory")
+#define local_irq_disable() asm volatile("msr daifset, #2\n" : : : "memory")
+
 #endif
@@ -7,6 +7,11 @@
 
 #define __noreturn __attribute__((noreturn))
 
+#define __noinline __attribute__((noinline))
+
+#define CACHE_LINE_SIZE 64 // Cortex-A72 L1D/L2 line size
+#define __cacheline_aligned __attribute__((aligned(CACHE_LINE_SIZE)))
+
 #define UNREACHABLE() __builtin_unreachable()
 
 #define likely(x) __builtin_expect(!!(x), 1)
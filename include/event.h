@@ -20,7 +20,8 @@ static inline bool is_valid_event_id(int event_id)
 	return event_id >= 1 && event_id <= EVENT_MAX;
 }
 
-void event_unblock_waiting_tasks(int event_id, int event_data);
+// Returns the number of tasks woken
+int event_unblock_waiting_tasks(int event_id, int event_data);
 
 char *event_id_to_string(int event_id);
 #endif // __KERNEL__
@@ -12,5 +12,6 @@ void interrupt_unregister_handler(u32 irq);
 void interrupt_enable(u32 irq);
 void interrupt_disable(u32 irq);
 void interrupt_set_type(u32 irq, irq_type_t type);
+void interrupt_set_priority(u32 irq, u8 priority);
 
 #endif // INTERRUPT_H
@@ -0,0 +1,41 @@
+#ifndef __IPC_LATENCY_H__
+#define __IPC_LATENCY_H__
+
+#include "types.h"
+#include "arch/registers.h"
+#include "uapi/ipc_latency.h"
+
+// IPC latency histograms are compiled in unless the IPC_LATENCY CMake option turns them off, which takes
+// the timestamps out of Send, Receive and Reply and makes GetIpcLatency fail
+#ifndef IPC_LATENCY_ENABLED
+#define IPC_LATENCY_ENABLED 1
+#endif
+
+// IPC timestamps use the generic timer count, a system register read cheap enough for every Send,
+// Receive and Reply. Ticks are converted to nanoseconds only when a latency is bucketed.
+static inline u64 ipc_latency_now(void)
+{
+	return read_sysreg("cntpct_el0");
+}
+
+void ipc_latency_init(void);
+int ipc_latency_get(int tid, ipc_latency_t *latency);
+int ipc_latency_reset(int tid);
+
+#if IPC_LATENCY_ENABLED
+void ipc_latency_record_queue(int receiver_tid, u64 send_time);
+void ipc_latency_record_service(int server_tid, u64 receive_time);
+#define ipc_latency_stamp(time) ((time) = ipc_latency_now())
+#else
+#define ipc_latency_record_queue(receiver_tid, send_time) \
+	do {                                               \
+	} while (0)
+#define ipc_latency_record_service(server_tid, receive_time) \
+	do {                                                  \
+	} while (0)
+#define ipc_latency_stamp(time) \
+	do {                    \
+	} while (0)
+#endif
+
+#endif /* __IPC_LATENCY_H__ */
@@ -0,0 +1,26 @@
+#ifndef __IRQ_LATENCY_H__
+#define __IRQ_LATENCY_H__
+
+#include "types.h"
+#include "uapi/irq_latency.h"
+
+struct task;
+
+// Timestamps are generic timer counts, the clock ipc_latency.h uses.
+// irq_el0_handler (irq_el1_handler when nested) stamps exception entry, handle_irq brackets the handler
+// call with begin/end, and the handler names its source and the time of the hardware event. Tasks it wakes
+// carry that event time until they are dispatched.
+
+void irq_latency_init(void);
+void irq_latency_exception_entry(void);
+u64 irq_latency_exception_time(void);
+u64 irq_latency_timer_event(u32 compare);
+void irq_latency_begin(void);
+void irq_latency_source(int source, u64 event_time);
+void irq_latency_end(void);
+void irq_latency_mark_wakeup(struct task *task);
+void irq_latency_record_dispatch(struct task *task);
+int irq_latency_get(irq_latency_t *latency, int max_sources);
+void irq_latency_reset(void);
+
+#endif /* __IRQ_LATENCY_H__ */
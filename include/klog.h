@@ -26,21 +26,32 @@
 
 #define KLOG_LOCATION_SIZE 128
 #define KLOG_BUF_SIZE 512
-#define KLOG_MAX_ENTRIES 1024
+#define KLOG_RING_SIZE (64 * 1024) // Bytes; must be a power of two no larger than 64KB
+#define KLOG_MAX_ARGS 8 // Argument words captured per entry
+#define KLOG_MAX_STRINGS_SIZE 512 // Bytes of %s arguments captured per entry
 
-// Log entry
+#define KLOG_PAD 0xFF // Level of a padding entry filling the end of the ring
+
+// Log entry, stored unformatted. The format string, function name and line are string literals, so only
+// the argument words and the contents of %s arguments are copied. Formatting happens when the log is read.
 struct klog_entry {
-	u32 timestamp;
-	u8 level;
+	u32 size; // Bytes up to the next entry, a multiple of 8
+	u8 level; // size and level are all a padding entry has, so they stay in its first 8 bytes
 	u8 cpu;
-	char location[KLOG_LOCATION_SIZE];
-	char message[KLOG_BUF_SIZE];
+	u8 nwords; // Argument words following the header
+	u8 reserved;
+	u32 timestamp;
+	u16 strings_len; // Bytes of %s contents following the words
+	u16 tid; // Current task when logged, 0 outside task context
+	const char *fmt; // NULL if the arguments did not fit and strings holds the formatted message
+	const char *func;
+	const char *line;
+	u64 words[];
 };
 
 void klog_init(u32 destinations);
 void klog_set_destinations(u32 dest);
 u32 klog_get_destinations(void);
-int klog_read_all_unread(struct klog_entry *entries, size_t max_entries, size_t *num_entries);
 int klog_read_all_unread_formatted(char *formatted_logs, size_t size, size_t *num_entries);
 int klog_read_range_formatted(char **formatted_logs, size_t size, int start_idx, int end_idx, size_t *num_entries);
 void klog_print_all_unread(void);
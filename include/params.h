@@ -1,8 +1,13 @@
 #ifndef __PARAMS_H__
 #define __PARAMS_H__
 
-#define MAX_TASKS 64
+#define MAX_TASKS 512
 #define MAX_PRIORITIES 32
-#define TASK_STACK_SIZE (1024 * 1024 * 30) // 30MB per task
+
+// User stacks live in the 800MB region mapped by mmu.S starting at 0x1000000:
+// MAX_TASK_STACKS full-size stacks followed by one small stack per TID
+#define TASK_STACK_SIZE (1024 * 1024 * 30) // 30MB per full-size stack
+#define MAX_TASK_STACKS 24
+#define TASK_SMALL_STACK_SIZE (1024 * 128) // 128KB per small stack
 
 #endif // __PARAMS_H__
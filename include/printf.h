@@ -3,6 +3,7 @@
 
 #include <stdarg.h>
 #include <stddef.h>
+#include "types.h"
 
 // ascii digit to integer
 int a2d(const char ch);
@@ -19,6 +20,15 @@ void i2a(int num, char *buf, int flags, int precision);
 // format string to buffer with a size limit, return the number of characters written
 int __raw_vsnprintf(char *buf, size_t size, const char *fmt, va_list *p_args);
 
+// capture the arguments fmt consumes as 64-bit words for later formatting with __raw_snprintf_words.
+// %s arguments are copied into strings and captured as offsets. Returns the number of words captured,
+// or -1 if they do not fit in max_words words and strings_size bytes.
+int __raw_capture_args(const char *fmt, va_list *p_args, u64 *words, int max_words, char *strings,
+		       size_t strings_size, size_t *strings_len);
+
+// format string to buffer from words captured by __raw_capture_args, return the number of characters written
+int __raw_snprintf_words(char *buf, size_t size, const char *fmt, const u64 *words, const char *strings);
+
 // format string to buffer, return the number of characters written
 int sprintf(char *buf, const char *fmt, ...);
 
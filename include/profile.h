@@ -0,0 +1,17 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include "types.h"
+#include "uapi/profile.h"
+
+// Sampling profiler driven by a periodic hrtimer on system timer compare C3. Every period the timer
+// callback counts the PC the running task was interrupted at. IRQs are only taken from EL0, so time spent
+// in the kernel shows up on the instruction after the svc that entered it.
+
+void profile_init(void);
+int profile_start(u32 period_us);
+void profile_stop(void);
+void profile_reset(void);
+int profile_report(profile_report_t *report, u32 max_entries);
+
+#endif /* __PROFILE_H__ */
@@ -35,10 +35,11 @@ void sched_remove_task(task_t *task);
 void sched_block_current(int block_reason);
 void sched_block_task(task_t *task, int block_reason);
 void sched_unblock_task(task_t *task);
-void sched_unblock_waiting_tasks(int exited_tid, void (*callback)(task_t *task));
-void sched_unblock_event_tasks(int event_id, int event_data);
+void sched_unblock_waiting_tasks(task_t *exited_task, void (*callback)(task_t *task));
+int sched_unblock_event_tasks(int event_id, int event_data);
 task_t *sched_pick_next(void);
 void sched_yield(void);
+void sched_preempt(void);
 void sched_schedule();
 
 // Priority queue management
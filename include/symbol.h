@@ -18,6 +18,13 @@ typedef struct {
  */
 const char *symbol_lookup(uint64_t addr);
 
+/**
+ * Find the symbol containing an address
+ * @param addr Address to look up
+ * @return Closest symbol at or below addr, or NULL if there is none
+ */
+const kernel_symbol_t *symbol_find(uint64_t addr);
+
 /**
  * Initialize the symbol table
  */
@@ -5,6 +5,10 @@
 #include "context.h"
 #include "task.h"
 #include "idle.h"
+#include "ipc_latency.h"
+#include "profile.h"
+#include "irq_latency.h"
+#include "timer/time.h"
 
 #define SYSCALL_NAME_LEN 32
 
@@ -17,11 +21,11 @@ typedef enum {
 } syscall_num_t;
 #undef SYSCALL
 
-#define SYSCALL_SET_RESULT(task, value) REG_X0(task->context.regs) = value
+#define SYSCALL_SET_RESULT(task, value) REG_X0(task->context->regs) = value
 
 void handle_syscall(task_t *current_task);
 
-i64 syscall_create(task_t *current_task, int priority, void (*function)());
+i64 syscall_create(task_t *current_task, int priority, void (*function)(), size_t stack_size);
 
 i64 syscall_mytid(task_t *current_task);
 
@@ -39,6 +43,10 @@ i64 syscall_receive_nonblock(task_t *current_task, int *tid, char *msg, int msgl
 
 i64 syscall_reply(task_t *current_task, int tid, const char *reply, int rplen);
 
+i64 syscall_receive_many(task_t *current_task, int *tids, int *msglens, char *msgs, int msglen, int max_msgs);
+
+i64 syscall_reply_many(task_t *current_task, const int *tids, const char *replies, int rplen, int count);
+
 i64 syscall_klog(task_t *current_task, u8 level, const char *msg);
 
 i64 syscall_wait_tid(task_t *current_task, int tid);
@@ -52,6 +60,15 @@ i64 syscall_setup_idle_task(task_t *current_task, idle_stats_t *idle_stats);
 i64 syscall_get_unread_klogs(task_t *current_task, char *buffer, int buffer_size, int *num_entries);
 
 i64 syscall_get_task_info(task_t *current_task, char *buffer, int buffer_size);
+i64 syscall_trace_dump(task_t *current_task, void *buffer, int buffer_size);
+i64 syscall_get_task_stats(task_t *current_task, int tid, task_stats_t *stats, int max_tasks);
+i64 syscall_get_ipc_latency(task_t *current_task, int tid, ipc_latency_t *latency, int reset);
+i64 syscall_profile(task_t *current_task, int cmd, int arg, profile_report_t *report);
+i64 syscall_get_irq_latency(task_t *current_task, irq_latency_t *latency, int max_sources, int reset);
+i64 syscall_get_clock_time(task_t *current_task, clock_time_t *time);
+i64 syscall_request_tick(task_t *current_task, int tick);
+i64 syscall_sleep_us(task_t *current_task, u64 time_us, int absolute);
+i64 syscall_console_write(task_t *current_task, const char *buf, int len);
 
 void __noreturn syscall_reboot(task_t *current_task);
 
@@ -24,5 +24,17 @@ SYSCALL(SYS_RECEIVE_NONBLOCK, 16)
 SYSCALL(SYS_REBOOT, 17)
 SYSCALL(SYS_KILL, 18)
 SYSCALL(SYS_TOGGLE_IDLE_DISPLAY, 19)
+SYSCALL(SYS_RECEIVE_MANY, 20)
+SYSCALL(SYS_REPLY_MANY, 21)
+SYSCALL(SYS_CREATE_WITH_STACK, 22)
+SYSCALL(SYS_TRACE_DUMP, 23)
+SYSCALL(SYS_GET_TASK_STATS, 24)
+SYSCALL(SYS_GET_IPC_LATENCY, 25)
+SYSCALL(SYS_PROFILE, 26)
+SYSCALL(SYS_GET_IRQ_LATENCY, 27)
+SYSCALL(SYS_GET_CLOCK_TIME, 28)
+SYSCALL(SYS_REQUEST_TICK, 29)
+SYSCALL(SYS_SLEEP_US, 30)
+SYSCALL(SYS_CONSOLE_WRITE, 31)
 
 #endif
@@ -7,6 +7,9 @@
 #include "types.h"
 #include "dlist.h"
 #include "context.h"
+#include "compiler.h"
+#include "uapi/task_stats.h"
+#include "timer/hrtimer.h"
 
 typedef enum task_state {
 	TASK_STATE_ACTIVE, // Currently running
@@ -24,28 +27,16 @@ typedef enum task_block_reason {
 	TASK_BLOCK_AWAIT_EVENT, // Blocked waiting for an event
 } task_block_reason_t;
 
-typedef struct task {
-	int tid; // Task ID
-	int parent_tid; // Parent task ID
+struct task;
 
-	int priority; // Task priority (0 = highest)
-	task_state_t state; // Current task state
+// Fields only touched on create, exit, kill and debug paths
+typedef struct task_cold {
+	struct task *task; // Owning task
 
-	// Blocking information
-	task_block_reason_t block_reason; // Why the task is blocked
-	int block_ipc_tid; // TID of the task this task is waiting for in IPC
+	int parent_tid; // Parent task ID
 	int wait_tid; // TID of the task this task is waiting to exit
-	int event_id; // Event ID the task is waiting for (if blocked on event)
-	char *ipc_send_ptr; // Pointer to IPC send buffer
-	size_t ipc_send_len; // Length of IPC send buffer
-	char *ipc_receive_ptr; // Pointer to IPC receive buffer
-	int *ipc_receive_tid; // Pointer to TID that sent the message
-	size_t ipc_receive_max_len; // Maximum length of IPC receive buffer
-	char *ipc_reply_ptr; // Pointer to IPC reply buffer
-	size_t ipc_reply_max_len; // Maximum length of IPC reply buffer
 
-	// Context and stack management
-	context_t context; // Saved registers when not running
+	// Stack management
 	void *stack_base; // Bottom of stack (lowest address)
 	void *stack_top; // Top of stack (highest address, initial SP)
 	size_t stack_size; // Stack size in bytes
@@ -53,25 +44,75 @@ typedef struct task {
 	// Entry point for new tasks
 	void (*entry_point)(void);
 
+	// Task relationships
+	struct dlist_node waiters; // Tasks blocked in WaitTid on this task
+	struct dlist_node wait_node; // Node in the waited-on task's waiters list
+	struct dlist_node children; // Live tasks created by this task
+	struct dlist_node child_node; // Node in the parent's children list
+
+	hrtimer_t sleep_timer; // Wakes the task from SleepUs
+} task_cold_t;
+
+// CPU and IPC accounting, reported through GetTaskStats
+typedef struct task_acct {
+	u64 dispatch_time; // When the task was last switched to, in microseconds
+	u64 run_time_us;
+	u32 dispatches;
+	u32 voluntary_switches;
+	u32 preemptions;
+	u32 sends;
+	u32 receives;
+} task_acct_t;
+
+// Fields used by the scheduler and IPC paths, ordered so the scheduler's share sits in the first cache line.
+// The register context and cold data live in separate tables so they do not dilute these lines.
+typedef struct task {
+	int tid; // Task ID
+	int priority; // Task priority (0 = highest)
+	task_state_t state; // Current task state
+	task_block_reason_t block_reason; // Why the task is blocked
+
 	// Scheduling queues - intrusive linkage
 	struct dlist_node ready_queue_node; // For ready queue
 	struct dlist_node blocked_queue_node; // For blocked queue
 
+	context_t *context; // Saved registers when not running
+	task_cold_t *cold; // Stack, relationships and debug data
+
+	// Blocking information
+	int block_ipc_tid; // TID of the task this task is waiting for in IPC
+	int event_id; // Event ID the task is waiting for (if blocked on event)
+
 	// For message passing
 	struct dlist_node ipc_sender_queue; // For IPC
 	struct dlist_node ipc_sender_node; // Node in sender queue
-} task_t;
+	char *ipc_send_ptr; // Pointer to IPC send buffer
+	size_t ipc_send_len; // Length of IPC send buffer
+	char *ipc_receive_ptr; // Pointer to IPC receive buffer
+	int *ipc_receive_tid; // Pointer to TID that sent the message
+	size_t ipc_receive_max_len; // Maximum length of IPC receive buffer
+	int *ipc_receive_len; // Pointer to length of the received message (ReceiveMany only)
+	char *ipc_reply_ptr; // Pointer to IPC reply buffer
+	size_t ipc_reply_max_len; // Maximum length of IPC reply buffer
+	bool ipc_receive_many; // Blocked in ReceiveMany, return a message count instead of a length
+	u64 ipc_send_time; // When the pending Send was issued, see ipc_latency.h
+	u64 ipc_receive_time; // When the receiver obtained the pending Send
+	u64 irq_wake_time; // Hardware event of the IRQ that woke the task, 0 once dispatched, see irq_latency.h
+	int irq_wake_source;
+
+	task_acct_t acct;
+} __cacheline_aligned task_t;
 
 // Current running task
 extern task_t *current_task;
 
 // Task management functions
 void task_init(void);
-task_t *task_create(void (*entry_point)(void), int priority);
+task_t *task_create(void (*entry_point)(void), int priority, size_t stack_size);
 void task_destroy(task_t *task);
 
 // Stack management
-void *task_alloc_stack(int task_id);
+void *task_alloc_stack(int task_id, size_t stack_size);
 void task_free_stack(void *stack_base);
 void task_setup_stack(task_t *task, void (*entry_point)(void));
 
@@ -86,6 +127,7 @@ void task_free_tid(int tid);
 
 void task_dump(void);
 int task_format_info(char *buffer, int buffer_size);
+int task_get_stats(int tid, task_stats_t *stats, int max_tasks);
 #endif /* __KERNEL__ */
 
 #endif /* __TASK_H__ */
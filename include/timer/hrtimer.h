@@ -0,0 +1,26 @@
+#ifndef HRTIMER_H
+#define HRTIMER_H
+
+#include "types.h"
+#include "dlist.h"
+
+// Microsecond one-shot timers on system timer compare C3, independent of the 10ms tick on C1.
+// Expiry times are values of the 64-bit free-running counter (TIME_GET_TICK_64). Callbacks run in
+// IRQ context and may restart their own timer.
+
+struct hrtimer;
+typedef void (*hrtimer_callback_fn)(struct hrtimer *timer, u64 now);
+
+typedef struct hrtimer {
+	struct dlist_node node; // Node in the pending list, sorted by expiry
+	hrtimer_callback_fn callback;
+	u64 expires; // Counter value the timer fires at
+	bool active;
+} hrtimer_t;
+
+void hrtimer_subsystem_init(void);
+void hrtimer_init(hrtimer_t *timer, hrtimer_callback_fn callback);
+void hrtimer_start(hrtimer_t *timer, u64 expires);
+void hrtimer_cancel(hrtimer_t *timer);
+
+#endif /* HRTIMER_H */
@@ -18,6 +18,10 @@
 
 #define TIME_FREQ 1000000 // 1MHz
 
+#define TIME_TICK_US 10000 // Length of an EVENT_TIMER_TICK clock tick
+#define TIME_NO_TICK 0xFFFFFFFFU
+#define TIME_TICK_MIN_LEAD_US 5 // A compare armed closer than this to CLO may be missed
+
 static inline u64 time_get_tick_64(void)
 {
 	u32 hi = SYSTEM_TIMER_REG(CHI);
@@ -42,8 +46,26 @@ static inline u64 time_get_tick_64(void)
 void time_test(void);
 void time_init(void);
 u64 time_get_boot_time_tick(void);
+// 64-bit microseconds since boot from the free-running system timer, never wraps or goes backwards
+u64 time_get_monotonic_us(void);
+u64 time_monotonic_us_to_tick(u64 time_us);
+
+#ifdef __KERNEL__
+#include "uapi/clock_time.h"
+
+void time_get_clock(clock_time_t *clock);
+#endif
 
 void time_setup_timer_tick(void);
+u32 time_get_tick_count(void);
+// Deliver EVENT_TIMER_TICK once tick is reached. Only the earliest request is kept, so a task that wants
+// a later tick too asks again after each delivery.
+void time_request_tick(u32 tick);
+// Take a timer interrupt at the next tick boundary without delivering EVENT_TIMER_TICK, so the running task
+// is preempted there as it was by the periodic tick
+void time_request_slice(void);
+// Tick delivered while no task awaited EVENT_TIMER_TICK, or -1
+int time_take_pending_tick(void);
 
 #define TIME_STYLE_HHMMSSMS 0
 #define TIME_STYLE_SSMS 1
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include "klog.h"
+#include "uapi/ktrace.h"
+
+// Kernel trace points record fixed-size binary events into a ring buffer instead of formatting a log line.
+// The KTRACE CMake option compiles them in by default and out entirely with OFF. Without it, or with AUTO,
+// they are compiled in with KLOG_DEBUG only.
+#ifndef KTRACE_ENABLED
+#define KTRACE_ENABLED (KLOG_COMPILE_LEVEL >= KLOG_DEBUG)
+#endif
+
+#define KTRACE_MAX_RECORDS 16384 // Must be a power of two
+
+typedef enum {
+	KTRACE_SCHED_ENQUEUE, // arg0 = priority
+	KTRACE_SCHED_DEQUEUE, // arg0 = priority
+	KTRACE_SCHED_BLOCK, // arg0 = block reason
+	KTRACE_SCHED_UNBLOCK, // arg0 = block reason
+	KTRACE_SCHED_SWITCH, // arg0 = priority, arg1 = resume PC (low 32 bits)
+	KTRACE_IRQ_ENTER, // tid = interrupted task, arg0 = IRQ number
+	KTRACE_IRQ_EXIT, // tid = interrupted task, arg0 = IRQ number
+	KTRACE_IPC_SEND, // tid = sender, arg0 = receiver, arg1 = message length
+	KTRACE_IPC_RECEIVE, // tid = receiver, arg0 = sender, arg1 = message length
+	KTRACE_IPC_REPLY, // tid = replier, arg0 = sender being replied to, arg1 = reply length
+	KTRACE_AWAIT_EVENT, // arg0 = event id
+	KTRACE_EVENT_DELIVER, // tid = woken task, arg0 = event id, arg1 = event data
+	KTRACE_EVENT_COUNT,
+} ktrace_event_t;
+
+void ktrace_record(u16 event, u16 tid, u32 arg0, u32 arg1);
+int ktrace_read(struct ktrace_record *records, int max_records);
+int ktrace_dump(void *buffer, size_t size);
+void ktrace_dump_console(u32 max_records);
+const char *ktrace_event_to_string(u16 event);
+void ktrace_print_recent(int count);
+
+#if KTRACE_ENABLED
+#define ktrace(event, tid, arg0, arg1) ktrace_record((event), (u16)(tid), (u32)(arg0), (u32)(arg1))
+#else
+#define ktrace(event, tid, arg0, arg1) \
+	do {                            \
+	} while (0)
+#endif
+
+#endif /* TRACE_H */
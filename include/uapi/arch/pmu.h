@@ -0,0 +1 @@
+../../arch/pmu.h
\ No newline at end of file
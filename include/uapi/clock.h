@@ -13,7 +13,7 @@ typedef enum {
 
 typedef struct {
 	clock_msg_type_t type;
-	int ticks;
+	int ticks; // Kernel tick count for CLOCK_TICK_NOTIFY
 } clock_request_t;
 
 typedef struct {
@@ -0,0 +1,14 @@
+#ifndef __UAPI_CLOCK_TIME_H__
+#define __UAPI_CLOCK_TIME_H__
+
+#include "types.h"
+
+// Kernel clock read by GetClockTime
+typedef struct {
+	u64 time_us; // Monotonic microseconds since boot
+	u64 ticks; // 10ms ticks since the tick was set up, derived from the free-running counter
+	u32 missed_ticks; // Whole ticks by which requested tick interrupts were handled late
+	u32 max_late_us; // Worst delay from a requested tick to its interrupt being handled
+} clock_time_t;
+
+#endif /* __UAPI_CLOCK_TIME_H__ */
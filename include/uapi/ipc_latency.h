@@ -0,0 +1,15 @@
+#ifndef __UAPI_IPC_LATENCY_H__
+#define __UAPI_IPC_LATENCY_H__
+
+#include "types.h"
+
+#define IPC_LATENCY_BUCKETS 32
+
+// Log2 latency histograms of the messages a task served. Bucket i counts latencies in [2^i, 2^(i+1)) ns;
+// bucket 0 also counts anything under 1 ns and the last bucket everything above its lower bound.
+typedef struct {
+	u32 queue[IPC_LATENCY_BUCKETS]; // Send to the receiver obtaining the message
+	u32 service[IPC_LATENCY_BUCKETS]; // Receiver obtaining the message to its Reply
+} ipc_latency_t;
+
+#endif /* __UAPI_IPC_LATENCY_H__ */
@@ -0,0 +1,28 @@
+#ifndef __UAPI_IRQ_LATENCY_H__
+#define __UAPI_IRQ_LATENCY_H__
+
+#include "types.h"
+
+// Interrupt sources with their own latency histograms, the index into GetIrqLatency's output
+#define IRQ_LATENCY_TIMER_TICK 0 // System timer C1, the 10ms clock tick
+#define IRQ_LATENCY_HRTIMER 1 // System timer C3, microsecond one-shot timers and the profiler
+#define IRQ_LATENCY_CONSOLE_UART 2 // UART0
+#define IRQ_LATENCY_MARKLIN_UART 3 // UART3
+#define IRQ_LATENCY_OTHER 4
+#define IRQ_LATENCY_SOURCES 5
+
+#define IRQ_LATENCY_BUCKETS 32
+
+// Log2 histograms in ns, bucket i counts [2^i, 2^(i+1)) like ipc_latency_t. Timer sources measure from the
+// compare match. A UART's FIFO event carries no timestamp, so UART sources measure from IRQ exception entry
+// and do not see the time the IRQ stayed masked before that.
+typedef struct {
+	u32 count; // IRQs handled for this source
+	u32 wakeups; // Tasks woken by those IRQs and dispatched since
+	u32 entry_max_ns;
+	u32 wake_max_ns;
+	u32 entry[IRQ_LATENCY_BUCKETS]; // Hardware event to the handler being called
+	u32 wake[IRQ_LATENCY_BUCKETS]; // Hardware event to the first instruction of a task the handler woke
+} irq_latency_t;
+
+#endif /* __UAPI_IRQ_LATENCY_H__ */
@@ -0,0 +1,29 @@
+#ifndef __UAPI_KTRACE_H__
+#define __UAPI_KTRACE_H__
+
+#include "types.h"
+
+// 16 bytes, so four records share a cache line
+struct ktrace_record {
+	u32 timestamp; // Generic timer count (CNTPCT_EL0), low word
+	u16 event; // ktrace_event_t, see the kernel's trace.h
+	u16 tid; // Task the event is about
+	u32 arg0;
+	u32 arg1;
+};
+
+#define KTRACE_DUMP_MAGIC 0x4352544b // "KTRC" in little-endian byte order
+#define KTRACE_DUMP_VERSION 1
+
+// Binary dump layout: this header followed by count records, oldest first
+struct ktrace_dump_header {
+	u32 magic;
+	u16 version;
+	u16 record_size;
+	u32 timer_freq; // CNTFRQ_EL0, to convert timestamps to time
+	u32 count;
+	u32 dropped; // Records overwritten before this dump
+	u32 reserved;
+};
+
+#endif /* __UAPI_KTRACE_H__ */
@@ -0,0 +1,35 @@
+#ifndef __UAPI_PROFILE_H__
+#define __UAPI_PROFILE_H__
+
+#include "types.h"
+
+// Profile(cmd, arg, report) commands
+#define PROFILE_START 0 // Start sampling every arg microseconds (PROFILE_DEFAULT_PERIOD_US if 0)
+#define PROFILE_STOP 1
+#define PROFILE_RESET 2 // Drop all samples, keep sampling if running
+#define PROFILE_REPORT 3 // Fill report with the hottest functions, arg limits the entries (0 for all that fit)
+
+#define PROFILE_DEFAULT_PERIOD_US 1000
+#define PROFILE_MIN_PERIOD_US 50
+#define PROFILE_REPORT_MAX_ENTRIES 32
+#define PROFILE_NAME_LEN 40
+
+typedef struct {
+	u64 addr; // Start of the function, 0 for samples outside the symbol table
+	u32 hits;
+	u32 reserved;
+	char name[PROFILE_NAME_LEN];
+} profile_entry_t;
+
+// Flat profile: samples aggregated per function, hottest first
+typedef struct {
+	u32 samples; // Samples taken, including dropped ones
+	u32 dropped; // Samples whose PC found no free slot in the kernel table
+	u32 period_us;
+	u32 running;
+	u32 count; // Valid entries
+	u32 functions; // Distinct functions sampled, may exceed count
+	profile_entry_t entries[PROFILE_REPORT_MAX_ENTRIES];
+} profile_report_t;
+
+#endif /* __UAPI_PROFILE_H__ */
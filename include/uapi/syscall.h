@@ -3,6 +3,12 @@
 
 #include "types.h"
 #include "idle.h"
+#include "task_stats.h"
+#include "ipc_latency.h"
+#include "profile.h"
+#include "irq_latency.h"
+#include "ktrace.h"
+#include "clock_time.h"
 
 #undef SYSCALL
 #undef __SYSCALL_LIST_H__
@@ -15,6 +21,14 @@ typedef enum {
 
 int Create(int priority, void (*function)());
 
+/**
+ * Create a task with a stack of at least stack_size bytes.
+ * Stacks up to TASK_SMALL_STACK_SIZE come from a per-TID pool, so tasks that need little stack do not
+ * use up one of the MAX_TASK_STACKS full-size stacks that Create hands out.
+ * @return TID of the new task, -1 on invalid priority, -2 if out of task descriptors or stacks
+ */
+int CreateWithStack(int priority, void (*function)(), int stack_size);
+
 int MyTid();
 
 int MyParentTid();
@@ -31,6 +45,22 @@ int ReceiveNonBlock(int *tid, char *msg, int msglen);
 
 int Reply(int tid, const char *reply, int rplen);
 
+/**
+ * Receive up to max_msgs queued messages in one kernel entry.
+ * msgs is an array of max_msgs slots, each msglen bytes long. Blocks until at least one sender is queued.
+ * @param tids Output array of sender TIDs, one per received message
+ * @param msglens Optional output array of full message lengths (may be NULL)
+ * @return Number of messages received, or negative on error
+ */
+int ReceiveMany(int *tids, int *msglens, char *msgs, int msglen, int max_msgs);
+
+/**
+ * Reply to several senders in one kernel entry.
+ * replies is an array of count slots, each rplen bytes long; slot i is sent to tids[i].
+ * @return Number of senders successfully replied to, or negative on error
+ */
+int ReplyMany(const int *tids, const char *replies, int rplen, int count);
+
 int KLog(u8 level, const char *msg);
 
 int WaitTid(int tid);
@@ -45,12 +75,95 @@ int GetUnreadKlogs(char *buffer, int buffer_size, int *num_entries);
 
 int GetTaskInfo(char *buffer, int buffer_size);
 
+/**
+ * Read per-task CPU time, switch and IPC counters.
+ * @param tid Task to read, or -1 for every live task in TID order
+ * @param stats Output array of max_tasks entries
+ * @return Number of entries written, or -1 if tid is not a live task or the arguments are invalid
+ */
+int GetTaskStats(int tid, task_stats_t *stats, int max_tasks);
+
+/**
+ * Read the IPC latency histograms of the messages a task has served since it was created or last reset.
+ * @param tid Task to read, or -1 together with reset and a NULL latency to clear every task
+ * @param latency Output histograms, may be NULL to only reset
+ * @param reset Clear the task's histograms after reading them
+ * @return 0 on success, -1 on an invalid TID or nothing to do
+ */
+int GetIpcLatency(int tid, ipc_latency_t *latency, int reset);
+
+/**
+ * Control the kernel sampling profiler, which counts the PC of the running task at a fixed rate.
+ * @param cmd PROFILE_START, PROFILE_STOP, PROFILE_RESET or PROFILE_REPORT (see profile.h)
+ * @param arg Sampling period in microseconds for PROFILE_START, maximum entries for PROFILE_REPORT
+ * @param report Output flat profile for PROFILE_REPORT, ignored otherwise
+ * @return Number of report entries for PROFILE_REPORT, 0 for the other commands, -1 on invalid arguments
+ */
+int Profile(int cmd, int arg, profile_report_t *report);
+
+/**
+ * Read the interrupt latency histograms, one per IRQ_LATENCY_ source (see irq_latency.h).
+ * @param latency Output array of max_sources entries indexed by source, may be NULL to only reset
+ * @param reset Clear every source's histograms after reading them
+ * @return Number of sources written, 0 for a reset only, -1 on invalid arguments
+ */
+int GetIrqLatency(irq_latency_t *latency, int max_sources, int reset);
+
+/**
+ * Read the kernel's monotonic microsecond clock and the state of the 10ms tick.
+ * Unlike Time(), this needs no clock server round trip and resolves microseconds.
+ * @return 0 on success, -1 if time is NULL
+ */
+int GetClockTime(clock_time_t *time);
+
+/**
+ * Ask for EVENT_TIMER_TICK to be delivered once the tick count reaches tick. The timer interrupt is only
+ * armed for requested ticks, so AwaitEvent(EVENT_TIMER_TICK) waits for the earliest outstanding request.
+ * Only that request is kept; ask again for later ticks after each delivery.
+ * @return The current tick count, or -1 if tick is negative
+ */
+int RequestTick(int tick);
+
+/**
+ * Block on a microsecond one-shot timer, independent of the 10ms tick and the clock server.
+ * @param time_us Microseconds to sleep, or with absolute the GetClockTime time_us to wake at
+ * @return Microseconds the wakeup came after the requested time
+ */
+int SleepUs(u64 time_us, int absolute);
+
+static inline int DelayUs(u64 us)
+{
+	return SleepUs(us, 0);
+}
+
+static inline int DelayUntilUs(u64 time_us)
+{
+	return SleepUs(time_us, 1);
+}
+
+/**
+ * Queue bytes on the kernel's own console buffer, which the kernel drains on exception entry and after each
+ * IRQ, bypassing the IO server. Meant for exercising that drain; does not wait for buffer space.
+ * @return The number of bytes queued, less than len when the buffer filled up, or -1 if len is negative
+ */
+int ConsoleWrite(const char *buf, int len);
+
 void __attribute__((noreturn)) Reboot();
 
 int Kill(int tid, int kill_children);
 
 int ToggleIdleDisplay(void);
 
+/**
+ * Dump the kernel trace ring (context switches, IRQs, IPC and events).
+ * With a buffer, writes a struct ktrace_dump_header followed by the most recent records that fit (see ktrace.h).
+ * With a NULL buffer, the kernel writes the most recent buffer_size records (0 for all) to the console as hex
+ * between KTRACE-BEGIN/KTRACE-END lines, with IRQs masked until it is done; only for debugging sessions.
+ * Convert either form with scripts/ktrace_to_perfetto.py. The ring is empty unless tracing is compiled in.
+ * @return Bytes written to buffer (0 for the console dump), or negative on error
+ */
+int TraceDump(void *buffer, int buffer_size);
+
 int syscall(syscall_num_t num, long args[6]);
 
 #endif
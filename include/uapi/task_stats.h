@@ -0,0 +1,24 @@
+#ifndef __UAPI_TASK_STATS_H__
+#define __UAPI_TASK_STATS_H__
+
+#include "types.h"
+
+#define TASK_STATS_NAME_SIZE 32
+
+// Per-task CPU and IPC counters, accumulated by the kernel since the task was created
+typedef struct {
+	int tid;
+	int parent_tid;
+	int priority;
+	u32 reserved;
+	u64 run_time_us; // CPU time, including interrupts taken while the task was running
+	u32 dispatches; // Times the scheduler switched to this task
+	u32 voluntary_switches; // Switched out after blocking, yielding or exiting
+	u32 preemptions; // Switched out by an interrupt while still runnable
+	u32 sends; // Send calls issued
+	u32 receives; // Messages received
+	u32 reserved2;
+	char name[TASK_STATS_NAME_SIZE]; // Entry point symbol
+} task_stats_t;
+
+#endif /* __UAPI_TASK_STATS_H__ */
@@ -17,9 +17,11 @@ void uart_putc(size_t line, char c);
 void uart_putc_direct(size_t line, char c);
 void uart_puts(size_t line, const char *buf);
 void uart_putl(size_t line, const char *buf, size_t size);
+size_t uart_putl_nonblock(size_t line, const char *buf, size_t size);
 void uart_printf(size_t line, size_t buf_size, const char *fmt, ...);
 void uart_process_tx_buffers(void);
 void uart_process_tx_buffers_blocking(void);
+void uart_process_tx_buffers_preemptible(void);
 void uart_clear_buffer(size_t line);
 void uart_buffer_status_print(void);
 void uart_clear_pending_input(size_t line);
@@ -0,0 +1,59 @@
+#!/bin/bash
+
+# Build one CTX_SWITCH perf image per KLOG_LEVEL, to compare context-switch cost with kernel
+# logging and scheduler tracing compiled in or out. Each image prints a CSV row tagged with its level.
+
+set -e
+
+if [[ "$1" == "clean" ]]; then
+    rm -rf ctx_switch_perf_artifacts
+    rm -rf build_ctx_switch_*
+    exit 0
+fi
+
+CROSS_COMPILER_PATH_FLAG="-DCMAKE_CROSS_COMPILER_PATH=/u/cs452/public/xdev/bin"
+if [[ -d "/u/cs452/public/xdev/bin" ]]; then
+    CROSS_COMPILER_PATH_FLAG="-DCMAKE_CROSS_COMPILER_PATH=/u/cs452/public/xdev/bin"
+elif [[ -d "/Users/tongkun/Playground/arm-gnu-toolchain-14.2.rel1-darwin-arm64-aarch64-none-elf/bin" ]]; then
+    CROSS_COMPILER_PATH_FLAG="-DCMAKE_CROSS_COMPILER_PATH=/Users/tongkun/Playground/arm-gnu-toolchain-14.2.rel1-darwin-arm64-aarch64-none-elf/bin"
+fi
+
+ARTIFACT_DIR="ctx_switch_perf_artifacts"
+
+build_kernel() {
+    local klog_level=$1
+    local build_dir="build_ctx_switch_${klog_level}"
+
+    echo "Building configuration: klog_level=$klog_level"
+
+    rm -rf "$build_dir"
+    mkdir "$build_dir"
+
+    cd "$build_dir"
+
+    cmake -DCMAKE_BUILD_TYPE=Release -DMMU=on -DPERF_TEST=CTX_SWITCH -DKLOG_LEVEL="$klog_level" \
+        $CROSS_COMPILER_PATH_FLAG ..
+    make -j$(nproc 2>/dev/null || echo 4)
+
+    cd ..
+
+    echo "Built kernel.img in $build_dir/"
+    cp "$build_dir/kernel.img" "$ARTIFACT_DIR/kernel_ctx_switch_${klog_level}.img"
+}
+
+mkdir -p "$ARTIFACT_DIR"
+
+klog_levels=(
+    "NONE"
+    "ERROR"
+    "INFO"
+    "DEBUG"
+)
+
+for klog_level in "${klog_levels[@]}"; do
+    echo ""
+    echo "Processing configuration: $klog_level"
+    echo "-----------------------------------------------"
+
+    build_kernel "$klog_level"
+done
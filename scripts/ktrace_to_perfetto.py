@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""
+Convert a kernel trace dump to Chrome trace JSON, viewable in Perfetto (ui.perfetto.dev) or chrome://tracing.
+
+The dump is either the binary written by TraceDump(buffer, size), or a serial capture containing the hex
+dump the kernel prints between KTRACE-BEGIN and KTRACE-END (TraceDump(NULL, 0), the TUI "trace" command).
+Both start with struct ktrace_dump_header followed by struct ktrace_record entries, see include/trace.h.
+
+Resume PCs of context switches are resolved with the symbol table that cmake/GenerateSymbols.cmake writes
+to <build>/src/symbols.c.
+
+Usage: python3 ktrace_to_perfetto.py <dump> [-s build/src/symbols.c] [-o trace.json] [--sched]
+"""
+
+import argparse
+import bisect
+import json
+import re
+import struct
+import sys
+from typing import Dict, List, Optional, Tuple
+
+KTRACE_DUMP_MAGIC = 0x4352544B
+HEADER_FORMAT = "<IHHIIII"
+RECORD_FORMAT = "<IHHII"
+
+# Must match ktrace_event_t in include/trace.h
+EVENTS = [
+    "ENQUEUE",
+    "DEQUEUE",
+    "BLOCK",
+    "UNBLOCK",
+    "SWITCH",
+    "IRQ_ENTER",
+    "IRQ_EXIT",
+    "SEND",
+    "RECEIVE",
+    "REPLY",
+    "AWAIT_EVENT",
+    "EVENT_DELIVER",
+]
+
+# Must match task_block_reason_t in include/task.h and the EVENT_ ids in include/event.h
+BLOCK_REASONS = ["NONE", "TIMER", "IPC_RECEIVE", "IPC_REPLY", "WAIT_TID", "AWAIT_EVENT"]
+EVENT_NAMES = {1: "TIMER_TICK", 2: "UART_RX", 3: "UART_TX", 4: "UART_MS"}
+
+PID = 1
+IRQ_TID = 100000  # Track for interrupt handling, outside the task id range
+
+
+def read_dump(path: str) -> bytes:
+    """Return the binary dump, extracting it from a serial capture if needed."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == KTRACE_DUMP_MAGIC:
+        return data
+
+    text = data.decode("ascii", errors="ignore")
+    begin = text.rfind("KTRACE-BEGIN")
+    if begin < 0:
+        sys.exit(f"Error: '{path}' is neither a binary dump nor contains a KTRACE-BEGIN marker")
+    end = text.find("KTRACE-END", begin)
+    if end < 0:
+        sys.exit(f"Error: '{path}' has no KTRACE-END marker; the capture is truncated")
+
+    hex_digits = re.sub(r"[^0-9a-fA-F]", "", text[begin + len("KTRACE-BEGIN"):end])
+    return bytes.fromhex(hex_digits)
+
+
+def parse_dump(data: bytes) -> Tuple[int, int, List[Tuple[int, int, int, int, int]]]:
+    """Return (timer frequency, dropped records, records) with records as (ts, event, tid, arg0, arg1)."""
+    header_size = struct.calcsize(HEADER_FORMAT)
+    magic, version, record_size, freq, count, dropped, _ = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != KTRACE_DUMP_MAGIC:
+        sys.exit("Error: bad dump magic")
+    if version != 1 or record_size != struct.calcsize(RECORD_FORMAT):
+        sys.exit(f"Error: unsupported dump version {version} with {record_size}-byte records")
+
+    available = (len(data) - header_size) // record_size
+    if available < count:
+        print(f"Warning: dump holds {available} of {count} records", file=sys.stderr)
+        count = available
+
+    records = [struct.unpack_from(RECORD_FORMAT, data, header_size + i * record_size) for i in range(count)]
+    return freq, dropped, records
+
+
+class Symbols:
+    """Address to name lookup over the table generated into symbols.c."""
+
+    def __init__(self, path: Optional[str]):
+        self.addrs: List[int] = []
+        self.names: List[str] = []
+        if not path:
+            return
+
+        with open(path, "r") as f:
+            entries = re.findall(r'\{0x([0-9a-fA-F]+), "([^"]+)"\}', f.read())
+
+        # Trace records keep the low 32 bits of the PC
+        table = sorted((int(addr, 16) & 0xFFFFFFFF, name) for addr, name in entries)
+        self.addrs = [addr for addr, _ in table]
+        self.names = [name for _, name in table]
+
+    def lookup(self, pc: int) -> str:
+        i = bisect.bisect_right(self.addrs, pc) - 1
+        if i < 0:
+            return f"{pc:#x}"
+        return f"{self.names[i]}+{pc - self.addrs[i]:#x}"
+
+
+def convert(freq: int, records, symbols: Symbols, include_sched: bool) -> List[Dict]:
+    trace: List[Dict] = []
+    tids = set()
+
+    # Unwrap the 32-bit timer count and convert to microseconds from the first record
+    last_raw = records[0][0] if records else 0
+    ticks = 0
+
+    def ts_us() -> float:
+        return ticks * 1e6 / freq
+
+    running: Optional[Tuple[int, float, str]] = None  # (tid, start, resume symbol)
+    irq_start: Dict[int, float] = {}
+    flow_ids: Dict[Tuple[int, int], int] = {}  # (sender, receiver) -> flow id awaiting its RECEIVE
+    next_flow = 1
+
+    def instant(tid: int, name: str, args: Dict):
+        trace.append({"name": name, "ph": "i", "s": "t", "pid": PID, "tid": tid, "ts": ts_us(), "args": args})
+
+    for raw, event, tid, arg0, arg1 in records:
+        ticks += (raw - last_raw) & 0xFFFFFFFF
+        last_raw = raw
+        name = EVENTS[event] if event < len(EVENTS) else f"EVENT_{event}"
+        tids.add(tid)
+
+        if name == "SWITCH":
+            now = ts_us()
+            if running:
+                prev_tid, start, where = running
+                trace.append({"name": f"task {prev_tid}", "ph": "X", "pid": PID, "tid": prev_tid, "ts": start,
+                              "dur": now - start, "args": {"resumed_at": where}})
+            running = (tid, now, symbols.lookup(arg1))
+        elif name == "IRQ_ENTER":
+            irq_start[arg0] = ts_us()
+        elif name == "IRQ_EXIT":
+            start = irq_start.pop(arg0, None)
+            if start is not None:
+                trace.append({"name": f"IRQ {arg0}", "ph": "X", "pid": PID, "tid": IRQ_TID, "ts": start,
+                              "dur": ts_us() - start, "args": {"interrupted_task": tid}})
+        elif name == "SEND":
+            flow_ids[(tid, arg0)] = next_flow
+            instant(tid, f"Send -> {arg0}", {"len": arg1})
+            trace.append({"name": "ipc", "cat": "ipc", "ph": "s", "id": next_flow, "pid": PID, "tid": tid,
+                          "ts": ts_us()})
+            next_flow += 1
+        elif name == "RECEIVE":
+            instant(tid, f"Receive <- {arg0}", {"len": arg1})
+            flow = flow_ids.pop((arg0, tid), None)
+            if flow is not None:
+                trace.append({"name": "ipc", "cat": "ipc", "ph": "f", "bp": "e", "id": flow, "pid": PID,
+                              "tid": tid, "ts": ts_us()})
+        elif name == "REPLY":
+            instant(tid, f"Reply -> {arg0}", {"len": arg1})
+        elif name == "AWAIT_EVENT":
+            instant(tid, f"AwaitEvent {EVENT_NAMES.get(arg0, arg0)}", {})
+        elif name == "EVENT_DELIVER":
+            instant(tid, f"Event {EVENT_NAMES.get(arg0, arg0)}", {"data": arg1})
+        elif include_sched:
+            if name in ("BLOCK", "UNBLOCK"):
+                reason = BLOCK_REASONS[arg0] if arg0 < len(BLOCK_REASONS) else arg0
+                instant(tid, f"{name.capitalize()} {reason}", {})
+            else:
+                instant(tid, name.capitalize(), {"priority": arg0})
+
+    if running:
+        prev_tid, start, where = running
+        trace.append({"name": f"task {prev_tid}", "ph": "X", "pid": PID, "tid": prev_tid, "ts": start,
+                      "dur": ts_us() - start, "args": {"resumed_at": where}})
+
+    trace.append({"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "choochoo"}})
+    trace.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": IRQ_TID, "args": {"name": "IRQ"}})
+    for tid in sorted(tids):
+        trace.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": tid, "args": {"name": f"task {tid}"}})
+
+    return trace
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a kernel trace dump to Chrome/Perfetto trace JSON")
+    parser.add_argument("dump", help="Binary dump or serial capture containing KTRACE-BEGIN/KTRACE-END")
+    parser.add_argument("-s", "--symbols", help="symbols.c generated by cmake/GenerateSymbols.cmake")
+    parser.add_argument("-o", "--output", default="trace.json", help="Output JSON file (default: trace.json)")
+    parser.add_argument("--sched", action="store_true", help="Also emit enqueue/dequeue/block/unblock events")
+    args = parser.parse_args()
+
+    freq, dropped, records = parse_dump(read_dump(args.dump))
+    if not records:
+        sys.exit("Error: the dump holds no records; was the kernel built with -DKTRACE=OFF?")
+
+    symbols = Symbols(args.symbols)
+    trace = convert(freq, records, symbols, args.sched)
+
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, f)
+
+    span_ms = sum((records[i][0] - records[i - 1][0]) & 0xFFFFFFFF for i in range(1, len(records))) * 1e3 / freq
+    print(f"{len(records)} records over {span_ms:.3f} ms ({dropped} older records overwritten) -> {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,5 +1,9 @@
 #!/bin/bash
 
+# Build one SRR perf image per optimization/cache configuration.
+# The kernel trace ring is compiled in by default. Set KTRACE=OFF to build images without it, to measure its
+# overhead against the default ones; those artifacts get a _noktrace suffix.
+
 set -e
 
 if [[ "$1" == "clean" ]]; then
@@ -16,20 +20,25 @@ elif [[ -d "/Users/tongkun/Playground/arm-gnu-toolchain-14.2.rel1-darwin-arm64-a
 fi
 
 ARTIFACT_DIR="srr_perf_artifacts"
+KTRACE="${KTRACE:-ON}"
+TRACE_SUFFIX=""
+if [[ "$KTRACE" == "OFF" ]]; then
+    TRACE_SUFFIX="_noktrace"
+fi
 
 build_kernel() {
     local opt_flag=$1
     local cache_flag=$2
-    local build_dir="build_${opt_flag}_${cache_flag}"
+    local build_dir="build_${opt_flag}_${cache_flag}${TRACE_SUFFIX}"
 
-    echo "Building configuration: optimization=$opt_flag, cache=$cache_flag"
+    echo "Building configuration: optimization=$opt_flag, cache=$cache_flag, ktrace=$KTRACE"
 
     rm -rf "$build_dir"
     mkdir "$build_dir"
 
     cd "$build_dir"
 
-    local cmake_flags="-DCMAKE_BUILD_TYPE=Release -DMMU=on -DSRR_PERF=ON $CROSS_COMPILER_PATH_FLAG"
+    local cmake_flags="-DCMAKE_BUILD_TYPE=Release -DMMU=on -DPERF_TEST=SRR -DKTRACE=$KTRACE $CROSS_COMPILER_PATH_FLAG"
 
     if [[ "$opt_flag" == "opt" ]]; then
         cmake_flags="$cmake_flags -DOPT=ON"
@@ -56,7 +65,7 @@ build_kernel() {
     cd ..
 
     echo "Built kernel.img in $build_dir/"
-    cp "$build_dir/kernel.img" "$ARTIFACT_DIR/kernel_${opt_flag}_${cache_flag}.img"
+    cp "$build_dir/kernel.img" "$ARTIFACT_DIR/kernel_${opt_flag}_${cache_flag}${TRACE_SUFFIX}.img"
 }
 
 
@@ -75,7 +84,7 @@ configurations=(
 
 for config in "${configurations[@]}"; do
     IFS=':' read -r opt_flag cache_flag <<< "$config"
-    build_dir="build_${opt_flag}_${cache_flag}"
+    build_dir="build_${opt_flag}_${cache_flag}${TRACE_SUFFIX}"
 
     echo ""
     echo "Processing configuration: $opt_flag + $cache_flag"
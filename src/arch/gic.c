@@ -57,7 +57,7 @@ void gic_init(void)
 	gicd_write(GICD_CTLR, GICD_CTLR_ENABLE | GICD_CTLR_ENABLEGRP1);
 
 	gicc_write(GICC_PMR, 0xF0); // Set priority mask to allow priorities 0x00-0xEF
-	gicc_write(GICC_BPR, 7); // No sub-priority grouping
+	gicc_write(GICC_BPR, 3); // Group priority in bits [7:3], every implemented level can preempt a lower one
 
 	gicc_write(GICC_CTLR, GICC_CTLR_ENABLE | GICC_CTLR_ENABLEGRP1);
 
@@ -112,6 +112,25 @@ void gic_set_type(u32 irq, irq_type_t type)
 	gicd_write(reg, val);
 }
 
+// Lower values are more urgent. The GIC-400 implements the top five bits, the rest read as zero.
+void gic_set_priority(u32 irq, u8 priority)
+{
+	if (irq >= GIC_MAX_INTERRUPTS) {
+		klog_error("Invalid IRQ number for priority configuration: %u", irq);
+		return;
+	}
+
+	u32 reg = GICD_IPRIORITYR + (irq & ~0x3);
+	u32 shift = (irq % 4) * 8;
+	u32 val = gicd_read(reg);
+
+	val &= ~(0xFFu << shift);
+	val |= (u32)priority << shift;
+	gicd_write(reg, val);
+
+	klog_debug("Set IRQ %u priority to %#x", irq, priority);
+}
+
 u32 gic_get_interrupt(void)
 {
 	u32 iar = gicc_read(GICC_IAR);
@@ -1,5 +1,6 @@
 #include "boot_test.h"
 
+#include "arch/pmu.h"
 #include "compiler.h"
 #include "dlist.h"
 #include "klog.h"
@@ -356,6 +357,71 @@ static void __maybe_unused test_work_fn(void *arg)
 	work_execution_count++;
 }
 
+// Capture fmt's arguments as klog does, format them back and compare with snprintf
+static void __maybe_unused klog_capture_check(const char *fmt, ...)
+{
+	char expected[256];
+	char actual[256];
+	u64 words[KLOG_MAX_ARGS];
+	char strings[KLOG_MAX_STRINGS_SIZE];
+	size_t strings_len;
+	va_list args;
+
+	va_start(args, fmt);
+	__raw_vsnprintf(expected, sizeof(expected), fmt, &args);
+	va_end(args);
+
+	va_start(args, fmt);
+	int nwords = __raw_capture_args(fmt, &args, words, KLOG_MAX_ARGS, strings, sizeof(strings), &strings_len);
+	va_end(args);
+
+	BUG_ON(nwords < 0);
+	__raw_snprintf_words(actual, sizeof(actual), fmt, words, strings);
+	BUG_ON(strcmp(expected, actual) != 0);
+}
+
+static int __maybe_unused klog_capture_words(int max_words, const char *fmt, ...)
+{
+	u64 words[KLOG_MAX_ARGS];
+	char strings[16];
+	size_t strings_len;
+	va_list args;
+
+	va_start(args, fmt);
+	int nwords = __raw_capture_args(fmt, &args, words, max_words, strings, sizeof(strings), &strings_len);
+	va_end(args);
+
+	return nwords;
+}
+
+static void __maybe_unused klog_test(void)
+{
+	klog_capture_check("%d %5d %-5d|", 42, -7, 3);
+	klog_capture_check("%x %#x %o %b", 0xbeef, 42, 8, 5);
+	klog_capture_check("%s:%s %.3s", "task", "ready", "truncated");
+	klog_capture_check("%p %ld %llu", (void *)0x1234, -1L, 123456789012ULL);
+	klog_capture_check("%c%c %% %*d", 'o', 'k', 6, 99);
+
+	// Overflow must be reported so klog can fall back to formatting eagerly
+	BUG_ON(klog_capture_words(2, "%d %d %d", 1, 2, 3) != -1);
+	BUG_ON(klog_capture_words(2, "%d %s", 1, "longer than the strings buffer") != -1);
+	BUG_ON(klog_capture_words(2, "%d %s", 1, "ok") != 2);
+
+	// Cost of a klog_info call that only records to memory
+	u32 destinations = klog_get_destinations();
+	klog_set_destinations(KLOG_DEST_MEMORY);
+	u64 start = pmu_read_cycles();
+	for (int i = 0; i < 64; i++) {
+		klog_info("klog bench %d %s", i, "memory");
+	}
+	u64 cycles = pmu_read_cycles() - start;
+	klog_set_destinations(destinations);
+
+	klog_info("klog_info: %llu cycles/call to memory, ring %d bytes (was %d bytes for 1024 formatted entries)",
+		  cycles / 64, KLOG_RING_SIZE, 1024 * (KLOG_LOCATION_SIZE + KLOG_BUF_SIZE + 8));
+	klog_info("All klog tests passed!");
+}
+
 static void __maybe_unused priority_queue_test(void)
 {
 	// Test 1: Basic integer priority queue
@@ -516,6 +582,7 @@ void boot_test(void)
 	string_test();
 	timer_test();
 	printf_test();
+	klog_test();
 	priority_queue_test();
 	klog_info("Boot test passed!");
 }
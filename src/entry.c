@@ -9,6 +9,7 @@
 #include "task.h"
 #include "sched.h"
 #include "interrupt.h"
+#include "irq_latency.h"
 #include "klog.h"
 
 u8 from_exception = 0;
@@ -37,12 +38,12 @@ void sync_el0_handler(context_t *context)
 	u64 far = read_sysreg("far_el1");
 
 	klog_debug("esr = %#lx, ec = %#lx, far = %#lx", esr, ec, far);
-	uart_process_tx_buffers_blocking();
+	uart_process_tx_buffers_preemptible();
 
 	// Save current task context if we have a current task
 	if (current_task) {
 		// Copy the saved context from the stack to the task structure
-		memcpy(&current_task->context, context, sizeof(context_t));
+		memcpy(current_task->context, context, sizeof(context_t));
 	}
 
 	if (ec == 0x15) {
@@ -73,21 +74,30 @@ void sync_el0_handler(context_t *context)
 
 void irq_el0_handler(context_t *context)
 {
+	irq_latency_exception_entry();
 	from_exception = 1;
 
 	if (current_task) {
-		memcpy(&current_task->context, context, sizeof(context_t));
+		memcpy(current_task->context, context, sizeof(context_t));
 	}
-	uart_process_tx_buffers_blocking();
 
+	// The console drain happens in the bottom half of handle_irq, where other IRQs can preempt it
 	handle_irq();
 
-	sched_schedule();
+	sched_preempt();
 
 	panic("irq_el0_handler: should not be reached");
 	UNREACHABLE();
 }
 
+// An IRQ that preempted the console drain of irq_el0_handler or sync_el0_handler. Only the top half runs: tasks
+// it wakes are queued and picked up by the sched_preempt or sched_schedule of the interrupted handler.
+void irq_el1_handler(void)
+{
+	irq_latency_exception_entry();
+	handle_irq();
+}
+
 void other_handler()
 {
 	klog_set_destinations(KLOG_DEST_CONSOLE);
@@ -2,16 +2,16 @@
 #include "sched.h"
 #include "klog.h"
 
-void event_unblock_waiting_tasks(int event_id, int event_data)
+int event_unblock_waiting_tasks(int event_id, int event_data)
 {
 	klog_debug("Event %d occurred with data %d", event_id, event_data);
 
 	if (!is_valid_event_id(event_id)) {
 		klog_error("Invalid event ID %d", event_id);
-		return;
+		return 0;
 	}
 
-	sched_unblock_event_tasks(event_id, event_data);
+	return sched_unblock_event_tasks(event_id, event_data);
 }
 
 char *event_id_to_string(int event_id)
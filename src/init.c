@@ -1,4 +1,5 @@
 #include "arch/cpu.h"
+#include "arch/pmu.h"
 #include "klog.h"
 #include "arch/rpi.h"
 #include "timer/timer.h"
@@ -10,6 +11,10 @@
 #include "arch/exception.h"
 #include "sched.h"
 #include "interrupt.h"
+#include "ipc_latency.h"
+#include "profile.h"
+#include "irq_latency.h"
+#include "timer/hrtimer.h"
 
 #define KLOG_DEFAULT_DESTINATIONS (KLOG_DEST_CONSOLE | KLOG_DEST_MEMORY)
 
@@ -43,6 +48,12 @@ int __noreturn kmain(void)
 
 	exception_init();
 
+	pmu_init();
+
+	ipc_latency_init();
+
+	irq_latency_init();
+
 	timer_subsystem_init();
 
 	task_init();
@@ -57,7 +68,11 @@ int __noreturn kmain(void)
 
 	time_setup_timer_tick();
 
-	task_t *test_task = task_create((void *)__user_task_start, 0);
+	hrtimer_subsystem_init();
+
+	profile_init();
+
+	task_t *test_task = task_create((void *)__user_task_start, 0, TASK_STACK_SIZE);
 
 	if (test_task) {
 		sched_add_task(test_task);
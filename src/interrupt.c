@@ -4,6 +4,9 @@
 #include "context.h"
 #include "task.h"
 #include "sched.h"
+#include "trace.h"
+#include "irq_latency.h"
+#include "uart.h"
 
 extern u8 from_exception;
 
@@ -19,14 +22,25 @@ void handle_irq(void)
 
 	if (irq == GIC_SPURIOUS_INTID) {
 		klog_debug("Spurious interrupt received");
+		uart_process_tx_buffers_preemptible();
 		return;
 	}
 
 	klog_debug("Handling IRQ %u", irq);
+	ktrace(KTRACE_IRQ_ENTER, current_task ? current_task->tid : 0, irq, 0);
 
+	// Top half with IRQs masked: the handler clears the device and wakes its tasks
+	irq_latency_begin();
 	gic_handle_interrupt(irq);
+	irq_latency_end();
 
 	gic_end_interrupt(irq);
+	ktrace(KTRACE_IRQ_EXIT, current_task ? current_task->tid : 0, irq, 0);
+
+	// Bottom half: drain kernel console output after EOI, so the running priority has dropped and any source,
+	// the timers included, can preempt the FIFO waits through irq_el1_handler. An IRQ taken during the drain
+	// finds it running and only does its top half.
+	uart_process_tx_buffers_preemptible();
 
 	klog_debug("IRQ %u handling complete", irq);
 }
@@ -55,3 +69,8 @@ void interrupt_set_type(u32 irq, irq_type_t type)
 {
 	gic_set_type(irq, type);
 }
+
+void interrupt_set_priority(u32 irq, u8 priority)
+{
+	gic_set_priority(irq, priority);
+}
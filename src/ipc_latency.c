@@ -0,0 +1,93 @@
+#include "ipc_latency.h"
+#include "params.h"
+#include "string.h"
+#include "compiler.h"
+
+#if IPC_LATENCY_ENABLED
+
+// Indexed by the TID of the task that received (queue) or replied to (service) the message
+static ipc_latency_t ipc_latency_table[MAX_TASKS];
+// Nanoseconds per timer tick in 16.16 fixed point, so bucketing a latency is a multiply and shifts
+static u64 ipc_ns_per_tick_q16;
+// Longest latency in ticks whose conversion does not overflow
+static u64 ipc_max_ticks;
+
+void ipc_latency_init(void)
+{
+	ipc_ns_per_tick_q16 = (1000000000ULL << 16) / read_sysreg("cntfrq_el0");
+	ipc_max_ticks = ~0ULL / ipc_ns_per_tick_q16;
+	memset(ipc_latency_table, 0, sizeof(ipc_latency_table));
+}
+
+static inline int ipc_latency_bucket(u64 start)
+{
+	u64 ticks = ipc_latency_now() - start;
+	if (ticks >= ipc_max_ticks) {
+		return IPC_LATENCY_BUCKETS - 1;
+	}
+
+	u64 ns = (ticks * ipc_ns_per_tick_q16) >> 16;
+	if (ns == 0) {
+		return 0;
+	}
+
+	int bucket = 63 - __builtin_clzll(ns);
+	return bucket < IPC_LATENCY_BUCKETS ? bucket : IPC_LATENCY_BUCKETS - 1;
+}
+
+void ipc_latency_record_queue(int receiver_tid, u64 send_time)
+{
+	ipc_latency_table[receiver_tid].queue[ipc_latency_bucket(send_time)]++;
+}
+
+void ipc_latency_record_service(int server_tid, u64 receive_time)
+{
+	ipc_latency_table[server_tid].service[ipc_latency_bucket(receive_time)]++;
+}
+
+int ipc_latency_get(int tid, ipc_latency_t *latency)
+{
+	if (tid < 0 || tid >= MAX_TASKS || !latency) {
+		return -1;
+	}
+
+	*latency = ipc_latency_table[tid];
+	return 0;
+}
+
+// Clear one task's histograms, or every task's when tid is -1
+int ipc_latency_reset(int tid)
+{
+	if (tid == -1) {
+		memset(ipc_latency_table, 0, sizeof(ipc_latency_table));
+		return 0;
+	}
+
+	if (tid < 0 || tid >= MAX_TASKS) {
+		return -1;
+	}
+
+	memset(&ipc_latency_table[tid], 0, sizeof(ipc_latency_table[tid]));
+	return 0;
+}
+
+#else
+
+void ipc_latency_init(void)
+{
+}
+
+int ipc_latency_get(int tid, ipc_latency_t *latency)
+{
+	UNUSED(tid);
+	UNUSED(latency);
+	return -1;
+}
+
+int ipc_latency_reset(int tid)
+{
+	UNUSED(tid);
+	return -1;
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include "irq_latency.h"
+#include "ipc_latency.h"
+#include "timer/time.h"
+#include "task.h"
+#include "string.h"
+
+static irq_latency_t irq_latency_table[IRQ_LATENCY_SOURCES];
+static u64 irq_timer_freq;
+
+static u64 irq_exception_time; // IRQ exception entry, before the console drain
+static u64 irq_handler_time; // Just before the handler was called
+static u64 irq_event_time; // Hardware event of the source being handled
+static int irq_source = -1; // Source being handled, -1 outside a handler or before it named one
+static bool irq_source_seen;
+
+void irq_latency_init(void)
+{
+	irq_timer_freq = read_sysreg("cntfrq_el0");
+	memset(irq_latency_table, 0, sizeof(irq_latency_table));
+}
+
+static inline u32 irq_latency_ns(u64 start, u64 end)
+{
+	if (end <= start) {
+		return 0;
+	}
+
+	u64 ns = (end - start) * 1000000000ULL / irq_timer_freq;
+	return ns > 0xFFFFFFFFULL ? 0xFFFFFFFFU : (u32)ns;
+}
+
+static inline int irq_latency_bucket(u32 ns)
+{
+	if (ns == 0) {
+		return 0;
+	}
+
+	int bucket = 31 - __builtin_clz(ns);
+	return bucket < IRQ_LATENCY_BUCKETS ? bucket : IRQ_LATENCY_BUCKETS - 1;
+}
+
+void irq_latency_exception_entry(void)
+{
+	irq_exception_time = ipc_latency_now();
+}
+
+u64 irq_latency_exception_time(void)
+{
+	return irq_exception_time;
+}
+
+// Generic timer count at which the system timer matched compare, from how far CLO has moved past it
+u64 irq_latency_timer_event(u32 compare)
+{
+	u64 now = ipc_latency_now();
+	u32 late_us = SYSTEM_TIMER_REG(CLO) - compare;
+
+	return now - (u64)late_us * irq_timer_freq / TIME_FREQ;
+}
+
+void irq_latency_begin(void)
+{
+	irq_handler_time = ipc_latency_now();
+	irq_source = -1;
+	irq_source_seen = false;
+}
+
+// Called by a handler once per source it serves, before it wakes any task for that source
+void irq_latency_source(int source, u64 event_time)
+{
+	if (source < 0 || source >= IRQ_LATENCY_SOURCES) {
+		source = IRQ_LATENCY_OTHER;
+	}
+
+	irq_latency_t *latency = &irq_latency_table[source];
+	u32 ns = irq_latency_ns(event_time, irq_handler_time);
+
+	latency->count++;
+	latency->entry[irq_latency_bucket(ns)]++;
+	if (ns > latency->entry_max_ns) {
+		latency->entry_max_ns = ns;
+	}
+
+	irq_source = source;
+	irq_event_time = event_time;
+	irq_source_seen = true;
+}
+
+void irq_latency_end(void)
+{
+	// Handlers that do not name a source are accounted from exception entry
+	if (!irq_source_seen) {
+		irq_latency_source(IRQ_LATENCY_OTHER, irq_exception_time);
+	}
+
+	irq_source = -1;
+}
+
+void irq_latency_mark_wakeup(struct task *task)
+{
+	if (irq_source < 0) {
+		return;
+	}
+
+	task->irq_wake_time = irq_event_time;
+	task->irq_wake_source = irq_source;
+}
+
+// Called as the task is switched to, the closest the kernel gets to its first instruction
+void irq_latency_record_dispatch(struct task *task)
+{
+	if (!task->irq_wake_time) {
+		return;
+	}
+
+	irq_latency_t *latency = &irq_latency_table[task->irq_wake_source];
+	u32 ns = irq_latency_ns(task->irq_wake_time, ipc_latency_now());
+
+	latency->wakeups++;
+	latency->wake[irq_latency_bucket(ns)]++;
+	if (ns > latency->wake_max_ns) {
+		latency->wake_max_ns = ns;
+	}
+
+	task->irq_wake_time = 0;
+}
+
+int irq_latency_get(irq_latency_t *latency, int max_sources)
+{
+	if (!latency || max_sources <= 0) {
+		return -1;
+	}
+
+	int count = max_sources < IRQ_LATENCY_SOURCES ? max_sources : IRQ_LATENCY_SOURCES;
+	memcpy(latency, irq_latency_table, count * sizeof(irq_latency_t));
+	return count;
+}
+
+void irq_latency_reset(void)
+{
+	memset(irq_latency_table, 0, sizeof(irq_latency_table));
+}
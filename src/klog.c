@@ -5,25 +5,28 @@
 #include "timer/time.h"
 #include "klog.h"
 #include "string.h"
+#include "task.h"
 #include "uart.h"
 #include <stddef.h>
 
-// Global variables
-static struct klog_entry klog_buffer[KLOG_MAX_ENTRIES];
-static u32 klog_write_index = 0;
-static u32 klog_read_index = 0;
-static u32 klog_count = 0;
+#define KLOG_ENTRY_ALIGN 8
+#define KLOG_ENTRY_MAX_SIZE (sizeof(struct klog_entry) + KLOG_MAX_ARGS * sizeof(u64) + KLOG_MAX_STRINGS_SIZE)
+#define KLOG_RING_MASK (KLOG_RING_SIZE - 1)
+
+// Byte ring of variable-sized entries. head, tail and read_pos are free-running byte counters; an entry
+// starts at (counter & KLOG_RING_MASK) and never wraps, a padding entry fills the end of the ring instead.
+static u8 klog_ring[KLOG_RING_SIZE] __attribute__((aligned(KLOG_ENTRY_ALIGN)));
+static u32 klog_head = 0; // Where the next entry is written
+static u32 klog_tail = 0; // Oldest entry still in the ring
+static u32 klog_read_pos = 0; // Oldest entry not yet read
 static u32 klog_destinations = KLOG_DEST_CONSOLE | KLOG_DEST_MEMORY;
 
 // Initialize the logging system
 void klog_init(u32 destinations)
 {
-	// Initialize the log buffer
-	for (int i = 0; i < KLOG_MAX_ENTRIES; i++) {
-		klog_buffer[i].timestamp = 0;
-		klog_buffer[i].level = 0;
-		klog_buffer[i].message[0] = '\0';
-	}
+	klog_head = 0;
+	klog_tail = 0;
+	klog_read_pos = 0;
 
 	klog_set_destinations(destinations);
 }
@@ -45,7 +48,17 @@ static u32 klog_get_timestamp(void)
 	return time_get_boot_time_tick();
 }
 
-static size_t klog_format_entry(struct klog_entry *entry, char *buf, size_t size)
+static inline struct klog_entry *klog_entry_at(u32 pos)
+{
+	return (struct klog_entry *)&klog_ring[pos & KLOG_RING_MASK];
+}
+
+static inline const char *klog_entry_strings(const struct klog_entry *entry)
+{
+	return (const char *)&entry->words[entry->nwords];
+}
+
+static size_t klog_format_entry(const struct klog_entry *entry, char *buf, size_t size)
 {
 	const char *level_str;
 	switch (entry->level) {
@@ -69,43 +82,104 @@ static size_t klog_format_entry(struct klog_entry *entry, char *buf, size_t size
 		break;
 	}
 
+	char message[KLOG_BUF_SIZE];
+	char location[KLOG_LOCATION_SIZE];
+	const char *strings = klog_entry_strings(entry);
+
+	if (entry->fmt) {
+		__raw_snprintf_words(message, sizeof(message), entry->fmt, entry->words, strings);
+	} else {
+		strncpy(message, strings, sizeof(message) - 1);
+		message[sizeof(message) - 1] = '\0';
+	}
+	snprintf(location, sizeof(location), "%s:%s", entry->func, entry->line);
+
 	char time_str[TIME_STYLE_SSMS_BUF_SIZE];
 	time_format_time(time_str, entry->timestamp, TIME_STYLE_SSMS);
-	int ret = snprintf(buf, size, "[%s][%d][%s][%s] %s\r\n", time_str, entry->cpu, level_str, entry->location,
-			   entry->message);
+	int ret = snprintf(buf, size, "[%s][%d][%s][%s] %s\r\n", time_str, entry->cpu, level_str, location, message);
 	return ret;
 }
 
+// Drop the oldest entries until size more bytes fit after head
+static void klog_make_room(u32 size)
+{
+	while (klog_head + size - klog_tail > KLOG_RING_SIZE) {
+		klog_tail += klog_entry_at(klog_tail)->size;
+	}
+
+	if ((i32)(klog_read_pos - klog_tail) < 0) {
+		klog_read_pos = klog_tail;
+	}
+}
+
+// Reserve size bytes for a new entry, padding out the end of the ring if the entry would wrap
+static struct klog_entry *klog_reserve(u32 size)
+{
+	u32 offset = klog_head & KLOG_RING_MASK;
+
+	if (offset + size > KLOG_RING_SIZE) {
+		u32 pad_size = KLOG_RING_SIZE - offset;
+		klog_make_room(pad_size);
+
+		struct klog_entry *pad = klog_entry_at(klog_head);
+		pad->size = pad_size;
+		pad->level = KLOG_PAD;
+		klog_head += pad_size;
+	}
+
+	klog_make_room(size);
+
+	struct klog_entry *entry = klog_entry_at(klog_head);
+	klog_head += size;
+	return entry;
+}
+
 static void klog_write_entry(u8 level, const char *func, const char *line, const char *fmt, va_list args)
 {
-	u8 cpu = get_cpu_id();
-	char buf[KLOG_BUF_SIZE];
-	char location[KLOG_LOCATION_SIZE];
+	u64 scratch[KLOG_ENTRY_MAX_SIZE / sizeof(u64)];
+	struct klog_entry *entry = (struct klog_entry *)scratch;
+	char strings[KLOG_MAX_STRINGS_SIZE];
+	size_t strings_len = 0;
+	va_list capture_args;
+
+	// Capture the raw arguments; if they do not fit, format the message now and store it as a string
+	va_copy(capture_args, args);
+	int nwords = __raw_capture_args(fmt, &capture_args, entry->words, KLOG_MAX_ARGS, strings, sizeof(strings),
+					&strings_len);
+	va_end(capture_args);
+
+	if (nwords < 0) {
+		nwords = 0;
+		strings_len = __raw_vsnprintf(strings, sizeof(strings), fmt, &args) + 1;
+		if (strings_len > sizeof(strings)) {
+			strings_len = sizeof(strings);
+		}
+		fmt = NULL;
+	}
 
-	__raw_vsnprintf(buf, KLOG_BUF_SIZE, fmt, &args);
-	snprintf(location, KLOG_LOCATION_SIZE, "%s:%s", func, line);
+	u32 size = sizeof(struct klog_entry) + nwords * sizeof(u64) + strings_len;
+	size = (size + KLOG_ENTRY_ALIGN - 1) & ~(KLOG_ENTRY_ALIGN - 1);
 
-	u32 timestamp = klog_get_timestamp();
-	struct klog_entry *entry = &klog_buffer[klog_write_index];
-	entry->timestamp = timestamp;
+	entry->size = size;
+	entry->timestamp = klog_get_timestamp();
 	entry->level = level;
-	strncpy(entry->message, buf, sizeof(entry->message) - 1);
-	strncpy(entry->location, location, sizeof(entry->location) - 1);
-	entry->message[sizeof(entry->message) - 1] = '\0';
-	entry->location[sizeof(entry->location) - 1] = '\0';
-	entry->cpu = cpu;
+	entry->cpu = get_cpu_id();
+	entry->nwords = nwords;
+	entry->reserved = 0;
+	entry->strings_len = strings_len;
+	entry->tid = current_task ? current_task->tid : 0;
+	entry->fmt = fmt;
+	entry->func = func;
+	entry->line = line;
+	memcpy((char *)klog_entry_strings(entry), strings, strings_len);
 
 	if (klog_destinations & KLOG_DEST_MEMORY) {
-		klog_write_index = (klog_write_index + 1) % KLOG_MAX_ENTRIES;
-		if (klog_count < KLOG_MAX_ENTRIES) {
-			klog_count++;
-		} else {
-			klog_read_index = (klog_read_index + 1) % KLOG_MAX_ENTRIES;
-		}
+		memcpy(klog_reserve(size), entry, size);
 	}
 
 	if (klog_destinations & KLOG_DEST_CONSOLE) {
-		klog_format_entry(entry, buf, KLOG_BUF_SIZE);
+		char buf[KLOG_BUF_SIZE];
+		klog_format_entry(entry, buf, sizeof(buf));
 		uart_printf(CONSOLE, KLOG_BUF_SIZE, buf);
 	}
 }
@@ -130,94 +204,91 @@ void klog_force(u8 level, const char *func, const char *line, const char *fmt, .
 	va_end(args);
 }
 
-int klog_read(struct klog_entry *entry)
+// Return the entry at *pos and advance past it, skipping padding; NULL once head is reached
+static struct klog_entry *klog_next_entry(u32 *pos)
 {
-	if (klog_count == 0 || !entry) {
-		return -1;
+	while (*pos != klog_head) {
+		struct klog_entry *entry = klog_entry_at(*pos);
+		*pos += entry->size;
+		if (entry->level != KLOG_PAD) {
+			return entry;
+		}
 	}
 
-	memcpy(entry, &klog_buffer[klog_read_index], sizeof(struct klog_entry));
-	klog_read_index = (klog_read_index + 1) % KLOG_MAX_ENTRIES;
-	klog_count--;
-
-	return 0;
+	return NULL;
 }
 
-int klog_read_formatted(char *buf, size_t size)
+static u32 klog_count_entries(u32 from)
 {
-	struct klog_entry entry;
-
-	if (klog_read(&entry) != 0) {
-		return -1;
+	u32 count = 0;
+	while (klog_next_entry(&from)) {
+		count++;
 	}
-
-	klog_format_entry(&entry, buf, size);
-
-	return 0;
+	return count;
 }
 
 void klog_clear(void)
 {
-	klog_write_index = 0;
-	klog_read_index = 0;
-	klog_count = 0;
+	klog_head = 0;
+	klog_tail = 0;
+	klog_read_pos = 0;
 }
 
-int klog_read_all_unread(struct klog_entry *entries, size_t max_entries, size_t *num_entries)
+/**
+ * Format unread log entries into a buffer and mark them read
+ *
+ * @param formatted_logs Buffer receiving the formatted entries
+ * @param size Size of formatted_logs
+ * @param num_entries In: maximum number of entries to read; out: number of entries read
+ * @return Number of bytes written
+ *
+ * An entry that does not fit in the remaining space is left unread for the next call.
+ */
+int klog_read_all_unread_formatted(char *formatted_logs, size_t size, size_t *num_entries)
 {
-	if (!entries || !num_entries || max_entries == 0) {
-		return -1;
-	}
-
-	if (klog_count == 0) {
-		*num_entries = 0;
+	if (!formatted_logs || !num_entries || size == 0) {
 		return 0;
 	}
 
+	char buf[KLOG_BUF_SIZE];
+	size_t total_len = 0;
 	size_t count = 0;
-	u32 current_read = klog_read_index;
+	u32 pos = klog_read_pos;
+	struct klog_entry *entry;
+
+	formatted_logs[0] = '\0';
+	while (count < *num_entries && (entry = klog_next_entry(&pos))) {
+		size_t len = klog_format_entry(entry, buf, sizeof(buf));
+		if (len >= sizeof(buf)) {
+			len = sizeof(buf) - 1;
+		}
+		if (total_len + len + 1 > size) {
+			break;
+		}
 
-	// Read entries until we either reach the write index or fill the buffer
-	while (count < klog_count && count < max_entries && current_read != klog_write_index) {
-		memcpy(&entries[count], &klog_buffer[current_read], sizeof(struct klog_entry));
-		current_read = (current_read + 1) % KLOG_MAX_ENTRIES;
+		memcpy(formatted_logs + total_len, buf, len + 1);
+		total_len += len;
+		klog_read_pos = pos;
 		count++;
 	}
 
-	klog_read_index = current_read;
-
 	*num_entries = count;
-	return 0;
+	return total_len;
 }
 
-struct klog_entry entries[1024];
-
-int klog_read_all_unread_formatted(char *formatted_logs, size_t size, size_t *num_entries)
+void klog_print_all_unread(void)
 {
-	if (klog_read_all_unread(entries, *num_entries, num_entries) != 0) {
-		return 0;
-	}
-
-	if (*num_entries == 0) {
-		return 0;
-	}
+	char buf[KLOG_BUF_SIZE];
+	struct klog_entry *entry;
+	bool printed = false;
 
-	size_t total_len = 0;
-	for (u32 i = 0; i < *num_entries; i++) {
-		size_t len = klog_format_entry(&entries[i], formatted_logs + total_len, size - total_len);
-		total_len += len;
+	while ((entry = klog_next_entry(&klog_read_pos))) {
+		klog_format_entry(entry, buf, sizeof(buf));
+		uart_puts(CONSOLE, buf);
+		printed = true;
 	}
 
-	return total_len;
-}
-
-void klog_print_all_unread(void)
-{
-	char klog_buffer[1024 * 100];
-	size_t num_entries = KLOG_MAX_ENTRIES;
-	int result = klog_read_all_unread_formatted(klog_buffer, sizeof(klog_buffer), &num_entries);
-	if (result > 0) {
-		uart_puts(CONSOLE, klog_buffer);
+	if (printed) {
 		uart_puts(CONSOLE, "\n\r");
 	}
 }
@@ -242,6 +313,7 @@ int klog_read_range_formatted(char **formatted_logs, size_t size, int start_idx,
 		return -1;
 	}
 
+	u32 klog_count = klog_count_entries(klog_tail);
 	if (klog_count == 0) {
 		*num_entries = 0;
 		return 0;
@@ -284,13 +356,15 @@ int klog_read_range_formatted(char **formatted_logs, size_t size, int start_idx,
 		count = *num_entries;
 	}
 
-	// Calculate the actual buffer indices
-	u32 start_buf_idx = (klog_write_index - klog_count + start_idx) % KLOG_MAX_ENTRIES;
+	// Entries are variable-sized, so walk from the oldest one to start_idx
+	u32 pos = klog_tail;
+	for (int i = 0; i < start_idx; i++) {
+		klog_next_entry(&pos);
+	}
 
 	// Read the entries
 	for (size_t i = 0; i < count; i++) {
-		u32 buf_idx = (start_buf_idx + i) % KLOG_MAX_ENTRIES;
-		klog_format_entry(&klog_buffer[buf_idx], formatted_logs[i], size);
+		klog_format_entry(klog_next_entry(&pos), formatted_logs[i], size);
 	}
 
 	*num_entries = count;
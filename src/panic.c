@@ -4,6 +4,7 @@
 #include "symbol.h"
 #include "uart.h"
 #include "timer/time.h"
+#include "trace.h"
 
 void do_panic(const char *func, const char *line, const char *fmt, ...)
 {
@@ -21,5 +22,11 @@ void do_panic(const char *func, const char *line, const char *fmt, ...)
 	dump_current_context(1);
 	uart_process_tx_buffers_blocking();
 
+#if KTRACE_ENABLED
+	klog_force_info("Last scheduler trace records:");
+	ktrace_print_recent(32);
+	uart_process_tx_buffers_blocking();
+#endif
+
 	asm volatile("b .");
 }
@@ -216,28 +216,57 @@ static void __buf_puts(char **p, const char *end, const char *buf, int *idx, int
 	}
 }
 
-static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index, const char **pfmt, va_list *p_args)
+// A parsed conversion specification, everything between '%' and the conversion character inclusive
+struct fmt_spec {
+	int flags;
+	int width;
+	int precision;
+	bool width_from_arg; // '*' width
+	bool precision_from_arg; // '*' precision
+	char conv;
+};
+
+// Kinds of argument a conversion consumes; long long and long are the same width on AArch64
+enum fmt_arg_kind {
+	FMT_ARG_NONE,
+	FMT_ARG_INT,
+	FMT_ARG_UINT,
+	FMT_ARG_LONG,
+	FMT_ARG_ULONG,
+	FMT_ARG_PTR,
+	FMT_ARG_STR,
+};
+
+// Where arguments come from: a live va_list, or words captured earlier by __raw_capture_args
+struct fmt_args {
+	va_list *va;
+	const u64 *words;
+	const char *strings; // Captured %s arguments are stored as offsets into this buffer
+};
+
+static void __parse_spec(const char **pfmt, struct fmt_spec *spec)
 {
-	char buf[buf_size];
 	const char *fmt = *pfmt;
-	int idx = index;
 	char ch;
-	int flags = 0;
-	int width = 0;
-	int precision = -1;
+
+	spec->flags = 0;
+	spec->width = 0;
+	spec->precision = -1;
+	spec->width_from_arg = false;
+	spec->precision_from_arg = false;
 
 	// Parse flags
 	while (1) {
 		ch = *(fmt++);
 		switch (ch) {
 		case '0':
-			flags |= FLAGS_ZERO;
+			spec->flags |= FLAGS_ZERO;
 			continue;
 		case '-':
-			flags |= FLAGS_LEFT;
+			spec->flags |= FLAGS_LEFT;
 			continue;
 		case '#':
-			flags |= FLAGS_PREFIX_0x;
+			spec->flags |= FLAGS_PREFIX_0x;
 			continue;
 		default:
 			break;
@@ -247,17 +276,13 @@ static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index
 
 	// Parse width
 	if (ch == '*') {
-		width = va_arg(*p_args, int);
-		if (width < 0) {
-			flags |= FLAGS_LEFT;
-			width = -width;
-		}
+		spec->width_from_arg = true;
 		ch = *(fmt++);
 	} else if (isdigit(ch)) {
-		width = ch - '0';
+		spec->width = ch - '0';
 		ch = *(fmt++);
 		while (isdigit(ch)) {
-			width = width * 10 + (ch - '0');
+			spec->width = spec->width * 10 + (ch - '0');
 			ch = *(fmt++);
 		}
 	}
@@ -266,18 +291,15 @@ static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index
 	if (ch == '.') {
 		ch = *(fmt++);
 		if (ch == '*') {
-			precision = va_arg(*p_args, int);
-			if (precision < 0) {
-				precision = -1; // Negative precision is ignored
-			}
+			spec->precision_from_arg = true;
 			ch = *(fmt++);
 		} else {
-			precision = 0;
+			spec->precision = 0;
 			if (isdigit(ch)) {
-				precision = ch - '0';
+				spec->precision = ch - '0';
 				ch = *(fmt++);
 				while (isdigit(ch)) {
-					precision = precision * 10 + (ch - '0');
+					spec->precision = spec->precision * 10 + (ch - '0');
 					ch = *(fmt++);
 				}
 			}
@@ -288,71 +310,165 @@ static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index
 	if (ch == 'l') {
 		ch = *(fmt++);
 		if (ch == 'l') {
-			flags |= FLAGS_LONG_LONG;
+			spec->flags |= FLAGS_LONG_LONG;
 			ch = *(fmt++);
 		} else {
-			flags |= FLAGS_LONG;
+			spec->flags |= FLAGS_LONG;
+		}
+	}
+
+	spec->conv = ch;
+	*pfmt = fmt;
+}
+
+static enum fmt_arg_kind __spec_arg_kind(const struct fmt_spec *spec)
+{
+	bool is_long = spec->flags & (FLAGS_LONG | FLAGS_LONG_LONG);
+
+	switch (spec->conv) {
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+		return is_long ? FMT_ARG_ULONG : FMT_ARG_UINT;
+	case 'd':
+	case 'i':
+		return is_long ? FMT_ARG_LONG : FMT_ARG_INT;
+	case 'b':
+		return FMT_ARG_UINT;
+	case 'c':
+		return FMT_ARG_INT;
+	case 's':
+		return FMT_ARG_STR;
+	case 'p':
+		return FMT_ARG_PTR;
+	default:
+		return FMT_ARG_NONE;
+	}
+}
+
+static u64 __fetch_arg(va_list *p_args, enum fmt_arg_kind kind)
+{
+	switch (kind) {
+	case FMT_ARG_INT:
+		return (u64)(i64)va_arg(*p_args, int);
+	case FMT_ARG_UINT:
+		return va_arg(*p_args, unsigned int);
+	case FMT_ARG_LONG:
+		return (u64)va_arg(*p_args, long long);
+	case FMT_ARG_ULONG:
+		return va_arg(*p_args, unsigned long long);
+	case FMT_ARG_PTR:
+		return (u64)(uintptr_t)va_arg(*p_args, void *);
+	case FMT_ARG_STR:
+		return (u64)(uintptr_t)va_arg(*p_args, char *);
+	default:
+		return 0;
+	}
+}
+
+static u64 __next_arg(struct fmt_args *args, enum fmt_arg_kind kind)
+{
+	if (args->va) {
+		return __fetch_arg(args->va, kind);
+	}
+
+	u64 word = *args->words++;
+	if (kind == FMT_ARG_STR) {
+		return (u64)(uintptr_t)(args->strings + word);
+	}
+	return word;
+}
+
+static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index, const char **pfmt,
+			struct fmt_args *args)
+{
+	char buf[buf_size];
+	int idx = index;
+	struct fmt_spec spec;
+
+	__parse_spec(pfmt, &spec);
+
+	int flags = spec.flags;
+	int width = spec.width;
+	int precision = spec.precision;
+
+	if (spec.width_from_arg) {
+		width = (int)__next_arg(args, FMT_ARG_INT);
+		if (width < 0) {
+			flags |= FLAGS_LEFT;
+			width = -width;
+		}
+	}
+
+	if (spec.precision_from_arg) {
+		precision = (int)__next_arg(args, FMT_ARG_INT);
+		if (precision < 0) {
+			precision = -1; // Negative precision is ignored
 		}
 	}
 
+	enum fmt_arg_kind kind = __spec_arg_kind(&spec);
+	u64 arg = kind != FMT_ARG_NONE ? __next_arg(args, kind) : 0;
+
 	// Handle format specifier
-	switch (ch) {
+	switch (spec.conv) {
 	case 'u':
 		if (flags & FLAGS_LONG_LONG) {
-			ui2a(va_arg(*p_args, unsigned long long), 10, buf, flags, precision);
+			ui2a((unsigned long long)arg, 10, buf, flags, precision);
 		} else if (flags & FLAGS_LONG) {
-			ui2a(va_arg(*p_args, unsigned long), 10, buf, flags, precision);
+			ui2a((unsigned long)arg, 10, buf, flags, precision);
 		} else {
-			ui2a(va_arg(*p_args, unsigned int), 10, buf, flags, precision);
+			ui2a((unsigned int)arg, 10, buf, flags, precision);
 		}
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case 'd':
 	case 'i':
 		if (flags & FLAGS_LONG_LONG) {
-			i2a(va_arg(*p_args, long long), buf, flags, precision);
+			i2a((long long)arg, buf, flags, precision);
 		} else if (flags & FLAGS_LONG) {
-			i2a(va_arg(*p_args, long), buf, flags, precision);
+			i2a((long)arg, buf, flags, precision);
 		} else {
-			i2a(va_arg(*p_args, int), buf, flags, precision);
+			i2a((int)arg, buf, flags, precision);
 		}
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case 'x':
 	case 'X':
 		if (flags & FLAGS_LONG_LONG) {
-			ui2a(va_arg(*p_args, unsigned long long), 16, buf, flags, precision);
+			ui2a((unsigned long long)arg, 16, buf, flags, precision);
 		} else if (flags & FLAGS_LONG) {
-			ui2a(va_arg(*p_args, unsigned long), 16, buf, flags, precision);
+			ui2a((unsigned long)arg, 16, buf, flags, precision);
 		} else {
-			ui2a(va_arg(*p_args, unsigned int), 16, buf, flags, precision);
+			ui2a((unsigned int)arg, 16, buf, flags, precision);
 		}
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case 'o':
 		if (flags & FLAGS_LONG_LONG) {
-			ui2a(va_arg(*p_args, unsigned long long), 8, buf, flags, precision);
+			ui2a((unsigned long long)arg, 8, buf, flags, precision);
 		} else if (flags & FLAGS_LONG) {
-			ui2a(va_arg(*p_args, unsigned long), 8, buf, flags, precision);
+			ui2a((unsigned long)arg, 8, buf, flags, precision);
 		} else {
-			ui2a(va_arg(*p_args, unsigned int), 8, buf, flags, precision);
+			ui2a((unsigned int)arg, 8, buf, flags, precision);
 		}
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case 'b':
-		ui2a(va_arg(*p_args, unsigned int), 2, buf, flags, precision);
+		ui2a((unsigned int)arg, 2, buf, flags, precision);
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case 'c':
-		__buf_putc(pstr, end, (char)va_arg(*p_args, int), &idx);
+		__buf_putc(pstr, end, (char)arg, &idx);
 		break;
 	case 's':
-		__buf_puts(pstr, end, va_arg(*p_args, char *), &idx, precision, width, flags);
+		__buf_puts(pstr, end, (char *)(uintptr_t)arg, &idx, precision, width, flags);
 		break;
 	case 'p':
 		flags |= FLAGS_PREFIX_0x;
 		precision = 8;
-		ui2a((unsigned long)va_arg(*p_args, void *), 16, buf, flags, precision);
+		ui2a((unsigned long)arg, 16, buf, flags, precision);
 		__buf_puts(pstr, end, buf, &idx, -1, width, flags);
 		break;
 	case '%':
@@ -362,12 +478,10 @@ static int __handle_fmt(char **pstr, const char *end, size_t buf_size, int index
 		break;
 	}
 
-	*pfmt = fmt;
 	return idx;
 }
 
-// format string to buffer with a size limit, return the number of characters written
-int __raw_vsnprintf(char *buf, size_t size, const char *fmt, va_list *p_args)
+static int __format(char *buf, size_t size, const char *fmt, struct fmt_args *args)
 {
 	if (!buf || !fmt || size == 0) {
 		return -1;
@@ -386,7 +500,7 @@ int __raw_vsnprintf(char *buf, size_t size, const char *fmt, va_list *p_args)
 			f++;
 		} else {
 			f++;
-			idx = __handle_fmt(&str, end, size, idx, &f, p_args);
+			idx = __handle_fmt(&str, end, size, idx, &f, args);
 		}
 	}
 
@@ -394,6 +508,83 @@ int __raw_vsnprintf(char *buf, size_t size, const char *fmt, va_list *p_args)
 	return idx;
 }
 
+// format string to buffer with a size limit, return the number of characters written
+int __raw_vsnprintf(char *buf, size_t size, const char *fmt, va_list *p_args)
+{
+	struct fmt_args args = { .va = p_args, .words = NULL, .strings = NULL };
+
+	return __format(buf, size, fmt, &args);
+}
+
+int __raw_capture_args(const char *fmt, va_list *p_args, u64 *words, int max_words, char *strings,
+		       size_t strings_size, size_t *strings_len)
+{
+	int nwords = 0;
+	size_t used = 0;
+	struct fmt_spec spec;
+
+	while (*fmt != '\0') {
+		if (*fmt++ != '%') {
+			continue;
+		}
+
+		__parse_spec(&fmt, &spec);
+
+		enum fmt_arg_kind kinds[3];
+		int nkinds = 0;
+
+		if (spec.width_from_arg) {
+			kinds[nkinds++] = FMT_ARG_INT;
+		}
+		if (spec.precision_from_arg) {
+			kinds[nkinds++] = FMT_ARG_INT;
+		}
+		if (__spec_arg_kind(&spec) != FMT_ARG_NONE) {
+			kinds[nkinds++] = __spec_arg_kind(&spec);
+		}
+
+		for (int i = 0; i < nkinds; i++) {
+			if (nwords >= max_words) {
+				return -1;
+			}
+
+			u64 arg = __fetch_arg(p_args, kinds[i]);
+
+			if (kinds[i] == FMT_ARG_STR) {
+				const char *str = (const char *)(uintptr_t)arg;
+				if (!str) {
+					str = "(null)";
+				}
+
+				// The whole string and its terminator must fit, otherwise the caller formats eagerly
+				size_t len = 0;
+				while (str[len]) {
+					len++;
+				}
+				if (len + 1 > strings_size - used) {
+					return -1;
+				}
+				arg = used;
+				for (size_t j = 0; j <= len; j++) {
+					strings[used++] = str[j];
+				}
+			}
+
+			words[nwords++] = arg;
+		}
+	}
+
+	*strings_len = used;
+	return nwords;
+}
+
+int __raw_snprintf_words(char *buf, size_t size, const char *fmt, const u64 *words, const char *strings)
+{
+	struct fmt_args args = { .va = NULL, .words = words, .strings = strings };
+
+	return __format(buf, size, fmt, &args);
+}
+
 int __attribute__((format(printf, 2, 3))) sprintf(char *buf, const char *fmt, ...)
 {
 	va_list args;
@@ -0,0 +1,193 @@
+#include "profile.h"
+#include "timer/time.h"
+#include "timer/hrtimer.h"
+#include "arch/registers.h"
+#include "symbol.h"
+#include "task.h"
+#include "string.h"
+#include "klog.h"
+
+// Distinct PCs kept per profile. Open addressing, a PC that finds no free slot within
+// PROFILE_MAX_PROBES is counted as dropped.
+#define PROFILE_SLOTS 4096
+#define PROFILE_MAX_PROBES 16
+
+typedef struct {
+	u64 addr;
+	u32 hits;
+} profile_slot_t;
+
+static profile_slot_t profile_pcs[PROFILE_SLOTS];
+// Scratch table used by profile_report to sum PCs per function
+static profile_slot_t profile_funcs[PROFILE_SLOTS];
+
+static hrtimer_t profile_timer;
+
+static u32 profile_period_us = PROFILE_DEFAULT_PERIOD_US;
+static u32 profile_samples = 0;
+static u32 profile_dropped = 0;
+static int profile_running = 0;
+
+static inline u32 profile_hash(u64 addr)
+{
+	// Instructions are 4-byte aligned
+	return (u32)((addr >> 2) * 0x9E3779B97F4A7C15ULL >> 52) & (PROFILE_SLOTS - 1);
+}
+
+static profile_slot_t *profile_slot(profile_slot_t *table, u64 addr)
+{
+	u32 index = profile_hash(addr);
+
+	for (int probe = 0; probe < PROFILE_MAX_PROBES; probe++) {
+		profile_slot_t *slot = &table[(index + probe) & (PROFILE_SLOTS - 1)];
+		if (slot->hits == 0) {
+			slot->addr = addr;
+			return slot;
+		}
+		if (slot->addr == addr) {
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+static void profile_sample(hrtimer_t *timer, u64 now)
+{
+	// Step from the previous sample point so the sampling rate does not drift with handler latency,
+	// unless the next sample point has already passed
+	u64 next = timer->expires + profile_period_us;
+	if (next <= now) {
+		next = now + profile_period_us;
+	}
+	hrtimer_start(timer, next);
+
+	if (!current_task) {
+		return;
+	}
+
+	profile_samples++;
+
+	profile_slot_t *slot = profile_slot(profile_pcs, REG_PC(current_task->context->regs));
+	if (slot) {
+		slot->hits++;
+	} else {
+		profile_dropped++;
+	}
+}
+
+void profile_init(void)
+{
+	memset(profile_pcs, 0, sizeof(profile_pcs));
+	hrtimer_init(&profile_timer, profile_sample);
+}
+
+int profile_start(u32 period_us)
+{
+	if (period_us == 0) {
+		period_us = PROFILE_DEFAULT_PERIOD_US;
+	}
+	if (period_us < PROFILE_MIN_PERIOD_US) {
+		klog_error("Profiler period %u us is below the minimum of %u us", period_us, PROFILE_MIN_PERIOD_US);
+		return -1;
+	}
+
+	profile_period_us = period_us;
+	hrtimer_start(&profile_timer, TIME_GET_TICK_64() + profile_period_us);
+	profile_running = 1;
+
+	klog_info("Profiler sampling every %u us", profile_period_us);
+	return 0;
+}
+
+void profile_stop(void)
+{
+	if (!profile_running) {
+		return;
+	}
+
+	hrtimer_cancel(&profile_timer);
+	profile_running = 0;
+
+	klog_info("Profiler stopped after %u samples (%u dropped)", profile_samples, profile_dropped);
+}
+
+void profile_reset(void)
+{
+	memset(profile_pcs, 0, sizeof(profile_pcs));
+	profile_samples = 0;
+	profile_dropped = 0;
+}
+
+// Sum the sampled PCs per function and keep the max_entries hottest, sorted by hits
+int profile_report(profile_report_t *report, u32 max_entries)
+{
+	if (!report) {
+		return -1;
+	}
+
+	if (max_entries == 0 || max_entries > PROFILE_REPORT_MAX_ENTRIES) {
+		max_entries = PROFILE_REPORT_MAX_ENTRIES;
+	}
+
+	memset(report, 0, sizeof(*report));
+	report->samples = profile_samples;
+	report->dropped = profile_dropped;
+	report->period_us = profile_period_us;
+	report->running = profile_running;
+
+	// There are never more functions than sampled PCs, only a long probe run can drop one here
+	memset(profile_funcs, 0, sizeof(profile_funcs));
+	for (int i = 0; i < PROFILE_SLOTS; i++) {
+		if (profile_pcs[i].hits == 0) {
+			continue;
+		}
+
+		const kernel_symbol_t *symbol = symbol_find(profile_pcs[i].addr);
+		u64 func = symbol ? symbol->addr : 0;
+
+		profile_slot_t *slot = profile_slot(profile_funcs, func);
+		if (!slot) {
+			report->dropped += profile_pcs[i].hits;
+			continue;
+		}
+		slot->hits += profile_pcs[i].hits;
+	}
+
+	for (int i = 0; i < PROFILE_SLOTS; i++) {
+		u32 hits = profile_funcs[i].hits;
+		if (hits == 0) {
+			continue;
+		}
+
+		report->functions++;
+
+		// Insertion into the sorted top list
+		u32 pos = report->count;
+		while (pos > 0 && report->entries[pos - 1].hits < hits) {
+			pos--;
+		}
+		if (pos >= max_entries) {
+			continue;
+		}
+
+		u32 last = report->count < max_entries ? report->count : max_entries - 1;
+		memmove(&report->entries[pos + 1], &report->entries[pos], (last - pos) * sizeof(profile_entry_t));
+		report->entries[pos].addr = profile_funcs[i].addr;
+		report->entries[pos].hits = hits;
+		report->entries[pos].reserved = 0;
+		if (report->count < max_entries) {
+			report->count++;
+		}
+	}
+
+	for (u32 i = 0; i < report->count; i++) {
+		profile_entry_t *entry = &report->entries[i];
+		const kernel_symbol_t *symbol = entry->addr ? symbol_find(entry->addr) : NULL;
+
+		strncpy(entry->name, symbol ? symbol->name : "unknown", PROFILE_NAME_LEN - 1);
+		entry->name[PROFILE_NAME_LEN - 1] = '\0';
+	}
+
+	return report->count;
+}
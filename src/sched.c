@@ -8,10 +8,13 @@
 #include "klog.h"
 #include "arch/registers.h"
 #include "context.h"
+#include "timer/time.h"
 #include "timer/timer.h"
 #include "uart.h"
 #include "idle.h"
 #include "panic.h"
+#include "trace.h"
+#include "irq_latency.h"
 #include <stddef.h>
 
 struct scheduler kernel_scheduler;
@@ -107,7 +110,7 @@ void sched_block_task(task_t *task, int block_reason)
 	task->block_reason = block_reason;
 	dlist_insert_tail(&kernel_scheduler.blocked_queue, &task->blocked_queue_node);
 
-	klog_debug("Blocked task %d", task->tid);
+	ktrace(KTRACE_SCHED_BLOCK, task->tid, block_reason, 0);
 }
 
 void sched_unblock_task(task_t *task)
@@ -117,41 +120,40 @@ void sched_unblock_task(task_t *task)
 
 	dlist_del(&task->blocked_queue_node);
 
+	ktrace(KTRACE_SCHED_UNBLOCK, task->tid, task->block_reason, 0);
+
 	task->state = TASK_STATE_READY;
 	task->block_reason = TASK_BLOCK_NONE;
-	task->wait_tid = -1;
+	task->cold->wait_tid = -1;
 	sched_enqueue_ready(task);
-
-	klog_debug("Unblocked task %d", task->tid);
 }
 
-void sched_unblock_waiting_tasks(int exited_tid, void (*callback)(task_t *task))
+void sched_unblock_waiting_tasks(task_t *exited_task, void (*callback)(task_t *task))
 {
-	klog_debug("Unblocking tasks waiting for TID %d to exit", exited_tid);
+	klog_debug("Unblocking tasks waiting for TID %d to exit", exited_task->tid);
 
-	task_t *task;
+	task_cold_t *waiter;
 	struct dlist_node *n;
 
-	dlist_for_each_entry_safe(task, n, &kernel_scheduler.blocked_queue, task_t, blocked_queue_node)
+	dlist_for_each_entry_safe(waiter, n, &exited_task->cold->waiters, task_cold_t, wait_node)
 	{
-		if (task->state != TASK_STATE_BLOCKED) {
-			continue;
-		}
+		task_t *task = waiter->task;
 
-		if (task->block_reason == TASK_BLOCK_WAIT_TID && task->wait_tid == exited_tid) {
-			klog_debug("Unblocking task %d that was waiting for TID %d", task->tid, exited_tid);
-			sched_unblock_task(task);
-			callback(task);
-		}
+		dlist_del(&waiter->wait_node);
+
+		klog_debug("Unblocking task %d that was waiting for TID %d", task->tid, exited_task->tid);
+		sched_unblock_task(task);
+		callback(task);
 	}
 }
 
-void sched_unblock_event_tasks(int event_id, int event_data)
+int sched_unblock_event_tasks(int event_id, int event_data)
 {
 	klog_debug("Unblocking tasks waiting for event %d", event_id);
 
 	task_t *task;
 	struct dlist_node *n;
+	int woken = 0;
 
 	dlist_for_each_entry_safe(task, n, &kernel_scheduler.blocked_queue, task_t, blocked_queue_node)
 	{
@@ -161,10 +163,15 @@ void sched_unblock_event_tasks(int event_id, int event_data)
 
 		if (task->block_reason == TASK_BLOCK_AWAIT_EVENT && task->event_id == event_id) {
 			klog_debug("Unblocking task %d that was waiting for event %d", task->tid, event_id);
-			REG_X0(task->context.regs) = event_data; // SYSCALL_AWAIT_EVENT return value set here
+			REG_X0(task->context->regs) = event_data; // SYSCALL_AWAIT_EVENT return value set here
+			ktrace(KTRACE_EVENT_DELIVER, task->tid, event_id, event_data);
+			irq_latency_mark_wakeup(task);
 			sched_unblock_task(task);
+			woken++;
 		}
 	}
+
+	return woken;
 }
 
 void sched_enqueue_ready(task_t *task)
@@ -193,12 +200,8 @@ void sched_enqueue_ready(task_t *task)
 		}
 	}
 
-	// klog_debug("Enqueuing task %d (priority %d)", task->tid, task->priority);
 	dlist_insert_tail(&kernel_scheduler.ready_queues[task->priority], &task->ready_queue_node);
-	// DLIST_PRINT(&kernel_scheduler.ready_queues[task->priority], task_t, ready_queue, "tid: %d", tid, 5);
-	// uart_process_tx_buffers_blocking();
-	int len = dlist_len(&kernel_scheduler.ready_queues[task->priority]);
-	klog_debug("Enqueued task %d (priority %d), ready queue length %d", task->tid, task->priority, len);
+	ktrace(KTRACE_SCHED_ENQUEUE, task->tid, task->priority, 0);
 
 	sched_set_priority_bit(task->priority);
 
@@ -221,15 +224,11 @@ task_t *sched_dequeue_ready(int priority)
 
 	dlist_del(&task->ready_queue_node);
 
-	// DLIST_PRINT(&kernel_scheduler.ready_queues[task->priority], task_t, ready_queue, "tid: %d", tid, 5);
-
 	if (dlist_is_empty(ready_queue)) {
 		sched_clear_priority_bit(priority);
 	}
 
-	int len = dlist_len(ready_queue);
-
-	klog_debug("Dequeued task %d (priority %d), ready queue length %d", task->tid, task->priority, len);
+	ktrace(KTRACE_SCHED_DEQUEUE, task->tid, task->priority, 0);
 
 	return task;
 }
@@ -265,7 +264,6 @@ task_t *sched_pick_next(void)
 	if (highest_priority < 0) {
 		return NULL;
 	}
-	klog_debug("Picking next task with highest priority %d", highest_priority);
 
 	// Get the first task at this priority
 	task_t *next_task = sched_dequeue_ready(highest_priority);
@@ -276,21 +274,50 @@ task_t *sched_pick_next(void)
 	return next_task;
 }
 
+static bool sched_preempting = false; // The next switch is forced by an interrupt
+
 void sched_yield(void)
 {
-	if (current_task && current_task->state == TASK_STATE_ACTIVE) {
-		klog_debug("Yielded by task %d (priority %d)", current_task->tid, current_task->priority);
-	}
+	sched_schedule();
+}
 
+void sched_preempt(void)
+{
+	sched_preempting = true;
 	sched_schedule();
 }
 
+// Charge the outgoing task for its slice and count the switch from both sides
+static inline void sched_account_switch(task_t *last, task_t *next, u64 now)
+{
+	bool preempted = sched_preempting;
+	sched_preempting = false;
+
+	if (last && last->state != TASK_STATE_TERMINATED) {
+		last->acct.run_time_us += now - last->acct.dispatch_time;
+	}
+
+	next->acct.dispatch_time = now;
+	if (next == last) {
+		return;
+	}
+
+	next->acct.dispatches++;
+	if (last && last->state != TASK_STATE_TERMINATED) {
+		if (preempted && last->state != TASK_STATE_BLOCKED) {
+			last->acct.preemptions++;
+		} else {
+			last->acct.voluntary_switches++;
+		}
+	}
+}
+
 void sched_schedule()
 {
-	task_dump();
-	if (current_task) {
-		task_t *last_scheduled_task = current_task;
+	task_t *last_scheduled_task = current_task;
+	u64 now = TIME_GET_TICK_US();
 
+	if (current_task) {
 		if (task_is_idle_task((struct task *)last_scheduled_task)) {
 			idle_stop_accounting();
 		}
@@ -318,11 +345,16 @@ void sched_schedule()
 		idle_start_accounting();
 	}
 
+	// Without a periodic tick, tasks sharing a priority would otherwise only rotate when one enters the kernel
+	if (!dlist_is_empty(&kernel_scheduler.ready_queues[next_task->priority])) {
+		time_request_slice();
+	}
+
+	sched_account_switch(last_scheduled_task, next_task, now);
+
 	next_task->state = TASK_STATE_ACTIVE;
 	current_task = next_task;
 
-	klog_debug("Scheduling task %d (priority %d)", next_task->tid, next_task->priority);
-
 	context_switch_to(next_task);
 }
 
@@ -330,14 +362,15 @@ extern void switch_to_user_mode(context_t *context);
 
 void context_switch_to(task_t *next_task)
 {
-	klog_debug("Switching to task %d (%s) (priority %d) (@%p in %s) (Kernel SP: %p, User SP: %p)", next_task->tid,
-		   symbol_lookup((uint64_t)next_task->entry_point), next_task->priority,
-		   REG_PC(next_task->context.regs), symbol_lookup((uint64_t)REG_PC(next_task->context.regs)), get_sp(),
-		   REG_SP(next_task->context.regs));
-	update_gpio_indicator(next_task->tid);
-
 	if (!next_task)
 		return;
 
-	switch_to_user_mode(&next_task->context);
+	// The PC is symbolised when the trace is read, not here
+	ktrace(KTRACE_SCHED_SWITCH, next_task->tid, next_task->priority, REG_PC(next_task->context->regs));
+	irq_latency_record_dispatch(next_task);
+#if KLOG_COMPILE_LEVEL >= KLOG_DEBUG
+	update_gpio_indicator(next_task->tid);
+#endif
+
+	switch_to_user_mode(next_task->context);
 }
@@ -54,40 +54,46 @@ void symbol_init(void)
 	test_uapp_symbol_resolution();
 }
 
-const char *symbol_lookup(uint64_t addr)
+const kernel_symbol_t *symbol_find(uint64_t addr)
 {
 	if (!symbol_table || symbol_count == 0) {
-		klog_error("Symbol table not initialized");
-		return "unknown";
+		return NULL;
 	}
 
 	// Binary search for the closest symbol (symbols are sorted by address)
 	int left = 0;
 	int right = symbol_count - 1;
 	int closest = -1;
-	uint64_t closest_addr = 0;
 
 	while (left <= right) {
 		int mid = left + (right - left) / 2;
 
 		if (symbol_table[mid].addr <= addr) {
-			if (closest == -1 || symbol_table[mid].addr > closest_addr) {
-				closest = mid;
-				closest_addr = symbol_table[mid].addr;
-			}
+			closest = mid;
 			left = mid + 1;
 		} else {
 			right = mid - 1;
 		}
 	}
 
-	if (closest != -1) {
-		uint64_t offset = addr - symbol_table[closest].addr;
+	return closest != -1 ? &symbol_table[closest] : NULL;
+}
+
+const char *symbol_lookup(uint64_t addr)
+{
+	if (!symbol_table || symbol_count == 0) {
+		klog_error("Symbol table not initialized");
+		return "unknown";
+	}
+
+	const kernel_symbol_t *symbol = symbol_find(addr);
+	if (symbol) {
+		uint64_t offset = addr - symbol->addr;
 		if (offset == 0) {
-			return symbol_table[closest].name;
+			return symbol->name;
 		} else {
 			static char buffer[128];
-			snprintf(buffer, sizeof(buffer), "%s+%#lx", symbol_table[closest].name, offset);
+			snprintf(buffer, sizeof(buffer), "%s+%#lx", symbol->name, offset);
 			return buffer;
 		}
 	}
@@ -9,6 +9,8 @@
 #include "printf.h"
 #include "string.h"
 #include "event.h"
+#include "trace.h"
+#include "ipc_latency.h"
 #include <stdarg.h>
 
 extern void _reboot(void);
@@ -28,7 +30,7 @@ char *syscall_name[SYSCALL_NUM] = {
 void handle_syscall(task_t *current_task)
 {
 	BUG_ON(current_task == NULL);
-	context_t *context = &current_task->context;
+	context_t *context = current_task->context;
 	u64 syscall_num = REG_X8(context->regs);
 
 	klog_debug("tid: %d, syscall_num = %#lx, syscall_name = %s", current_task->tid, syscall_num,
@@ -38,7 +40,14 @@ void handle_syscall(task_t *current_task)
 	case SYS_CREATE: {
 		u64 priority = REG_X0(context->regs);
 		u64 function_ptr = REG_X1(context->regs);
-		i64 result = (u64)syscall_create(current_task, (int)priority, (void (*)())function_ptr);
+		i64 result = (u64)syscall_create(current_task, (int)priority, (void (*)())function_ptr, TASK_STACK_SIZE);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_CREATE_WITH_STACK: {
+		u64 priority = REG_X0(context->regs);
+		u64 function_ptr = REG_X1(context->regs);
+		u64 stack_size = REG_X2(context->regs);
+		i64 result = syscall_create(current_task, (int)priority, (void (*)())function_ptr, (size_t)stack_size);
 		SYSCALL_SET_RESULT(current_task, result);
 	} break;
 	case SYS_MYTID: {
@@ -141,6 +150,82 @@ void handle_syscall(task_t *current_task)
 		i64 result = syscall_toggle_idle_display(current_task);
 		SYSCALL_SET_RESULT(current_task, result);
 	} break;
+	case SYS_RECEIVE_MANY: {
+		u64 tids_ptr = REG_X0(context->regs);
+		u64 msglens_ptr = REG_X1(context->regs);
+		u64 msgs_ptr = REG_X2(context->regs);
+		u64 msglen = REG_X3(context->regs);
+		u64 max_msgs = REG_X4(context->regs);
+		i64 result = syscall_receive_many(current_task, (int *)tids_ptr, (int *)msglens_ptr, (char *)msgs_ptr,
+						  (int)msglen, (int)max_msgs);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_TRACE_DUMP: {
+		u64 buffer_ptr = REG_X0(context->regs);
+		u64 buffer_size = REG_X1(context->regs);
+		i64 result = syscall_trace_dump(current_task, (void *)buffer_ptr, (int)buffer_size);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_GET_TASK_STATS: {
+		u64 tid = REG_X0(context->regs);
+		u64 stats_ptr = REG_X1(context->regs);
+		u64 max_tasks = REG_X2(context->regs);
+		i64 result = syscall_get_task_stats(current_task, (int)tid, (task_stats_t *)stats_ptr, (int)max_tasks);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_GET_IPC_LATENCY: {
+		u64 tid = REG_X0(context->regs);
+		u64 latency_ptr = REG_X1(context->regs);
+		u64 reset = REG_X2(context->regs);
+		i64 result = syscall_get_ipc_latency(current_task, (int)tid, (ipc_latency_t *)latency_ptr, (int)reset);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_PROFILE: {
+		u64 cmd = REG_X0(context->regs);
+		u64 arg = REG_X1(context->regs);
+		u64 report_ptr = REG_X2(context->regs);
+		i64 result = syscall_profile(current_task, (int)cmd, (int)arg, (profile_report_t *)report_ptr);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_GET_IRQ_LATENCY: {
+		u64 latency_ptr = REG_X0(context->regs);
+		u64 max_sources = REG_X1(context->regs);
+		u64 reset = REG_X2(context->regs);
+		i64 result =
+			syscall_get_irq_latency(current_task, (irq_latency_t *)latency_ptr, (int)max_sources, (int)reset);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_GET_CLOCK_TIME: {
+		u64 time_ptr = REG_X0(context->regs);
+		i64 result = syscall_get_clock_time(current_task, (clock_time_t *)time_ptr);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_REQUEST_TICK: {
+		u64 tick = REG_X0(context->regs);
+		i64 result = syscall_request_tick(current_task, (int)tick);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_SLEEP_US: {
+		u64 time_us = REG_X0(context->regs);
+		u64 absolute = REG_X1(context->regs);
+		i64 result = syscall_sleep_us(current_task, time_us, (int)absolute);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_CONSOLE_WRITE: {
+		u64 buf_ptr = REG_X0(context->regs);
+		u64 len = REG_X1(context->regs);
+		i64 result = syscall_console_write(current_task, (const char *)buf_ptr, (int)len);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
+	case SYS_REPLY_MANY: {
+		u64 tids_ptr = REG_X0(context->regs);
+		u64 replies_ptr = REG_X1(context->regs);
+		u64 rplen = REG_X2(context->regs);
+		u64 count = REG_X3(context->regs);
+		i64 result = syscall_reply_many(current_task, (const int *)tids_ptr, (const char *)replies_ptr,
+						(int)rplen, (int)count);
+		SYSCALL_SET_RESULT(current_task, result);
+	} break;
 	default:
 		klog_error("Unknown syscall number: %#lx", syscall_num);
 		break;
@@ -149,7 +234,7 @@ void handle_syscall(task_t *current_task)
 	// klog_debug("handle_syscall end");
 }
 
-i64 syscall_create(task_t *current_task, int priority, void (*function)())
+i64 syscall_create(task_t *current_task, int priority, void (*function)(), size_t stack_size)
 {
 	i64 ret = 0;
 	if (!is_valid_priority(priority)) {
@@ -159,14 +244,17 @@ i64 syscall_create(task_t *current_task, int priority, void (*function)())
 	}
 
 	if (ret == 0) {
-		task_t *new_task = task_create(function, priority);
+		task_t *new_task = task_create(function, priority, stack_size);
 		if (new_task) {
 			sched_add_task(new_task);
 			ret = new_task->tid;
+		} else {
+			// Out of task descriptors or stacks
+			ret = -2;
 		}
 	}
-	klog_debug("[t:%d p:%d] syscall_create: priority = %d, function = %p -> %d", current_task->tid,
-		   current_task->priority, priority, function, ret);
+	klog_debug("[t:%d p:%d] syscall_create: priority = %d, function = %p, stack_size = %d -> %d",
+		   current_task->tid, current_task->priority, priority, function, (int)stack_size, ret);
 	return ret;
 }
 
@@ -179,7 +267,7 @@ i64 syscall_mytid(task_t *current_task)
 
 i64 syscall_myparenttid(task_t *current_task)
 {
-	int parent_tid = current_task ? current_task->parent_tid : 0;
+	int parent_tid = current_task ? current_task->cold->parent_tid : 0;
 	klog_debug("[t:%d p:%d] syscall_myparenttid: %d", current_task->tid, current_task->priority, parent_tid);
 	return parent_tid;
 }
@@ -199,9 +287,7 @@ void syscall_exit(task_t *current_task)
 {
 	klog_debug("[t:%d p:%d] syscall_exit", current_task->tid, current_task->priority);
 	if (current_task) {
-		int exiting_tid = current_task->tid;
-
-		sched_unblock_waiting_tasks(exiting_tid, __syscall_unblock_waiting_tasks);
+		sched_unblock_waiting_tasks(current_task, __syscall_unblock_waiting_tasks);
 
 		task_destroy(current_task);
 		current_task = NULL;
@@ -233,6 +319,8 @@ static i64 __syscall_receive_finish(task_t *receiver, int msglen)
 	receiver->ipc_receive_ptr = NULL;
 	receiver->ipc_receive_max_len = 0;
 	receiver->ipc_receive_tid = NULL;
+	receiver->ipc_receive_len = NULL;
+	receiver->ipc_receive_many = false;
 	sched_unblock_task(receiver);
 	SYSCALL_SET_RESULT(receiver, msglen);
 	return 0;
@@ -248,6 +336,10 @@ i64 syscall_send(task_t *current_task, int tid, const char *msg, int msglen, cha
 		return -1; // Invalid TID
 	}
 
+	ktrace(KTRACE_IPC_SEND, current_task->tid, tid, msglen);
+	current_task->acct.sends++;
+	ipc_latency_stamp(current_task->ipc_send_time);
+
 	// Store message data in sender task for later retrieval
 	current_task->ipc_send_ptr = (char *)msg;
 	current_task->ipc_send_len = msglen;
@@ -262,8 +354,19 @@ i64 syscall_send(task_t *current_task, int tid, const char *msg, int msglen, cha
 		int copy_len = min(msglen, (int)receiver->ipc_receive_max_len);
 		memcpy(receiver->ipc_receive_ptr, msg, copy_len);
 		*receiver->ipc_receive_tid = current_task->tid;
-
-		__syscall_receive_finish(receiver, msglen); // Return actual message size, not truncated
+		ktrace(KTRACE_IPC_RECEIVE, receiver->tid, current_task->tid, msglen);
+		receiver->acct.receives++;
+		ipc_latency_record_queue(receiver->tid, current_task->ipc_send_time);
+		ipc_latency_stamp(current_task->ipc_receive_time);
+
+		if (receiver->ipc_receive_many) {
+			if (receiver->ipc_receive_len) {
+				*receiver->ipc_receive_len = msglen;
+			}
+			__syscall_receive_finish(receiver, 1); // ReceiveMany returns the number of messages
+		} else {
+			__syscall_receive_finish(receiver, msglen); // Return actual message size, not truncated
+		}
 	} else {
 		klog_debug("[t:%d p:%d] syscall_send: receiver not ready, queuing sender", current_task->tid,
 			   current_task->priority);
@@ -279,6 +382,24 @@ i64 syscall_send(task_t *current_task, int tid, const char *msg, int msglen, cha
 	return -2;
 }
 
+static int __syscall_receive_dequeue(task_t *current_task, int *tid, char *msg, int msglen)
+{
+	struct dlist_node *next_sender_node = dlist_first(&current_task->ipc_sender_queue);
+	task_t *next_sender = dlist_entry(next_sender_node, task_t, ipc_sender_node);
+	dlist_del(next_sender_node);
+
+	*tid = next_sender->tid;
+	ktrace(KTRACE_IPC_RECEIVE, current_task->tid, next_sender->tid, next_sender->ipc_send_len);
+	current_task->acct.receives++;
+	ipc_latency_record_queue(current_task->tid, next_sender->ipc_send_time);
+	ipc_latency_stamp(next_sender->ipc_receive_time);
+
+	int copy_len = min((int)next_sender->ipc_send_len, msglen);
+	memcpy(msg, next_sender->ipc_send_ptr, copy_len);
+
+	return (int)next_sender->ipc_send_len;
+}
+
 i64 syscall_receive(task_t *current_task, int *tid, char *msg, int msglen)
 {
 	if (dlist_is_empty(&current_task->ipc_sender_queue)) {
@@ -297,16 +418,7 @@ i64 syscall_receive(task_t *current_task, int *tid, char *msg, int msglen)
 	} else {
 		klog_debug("[t:%d p:%d] syscall_receive: sender found, processing message", current_task->tid,
 			   current_task->priority);
-		struct dlist_node *next_sender_node = dlist_first(&current_task->ipc_sender_queue);
-		task_t *next_sender = dlist_entry(next_sender_node, task_t, ipc_sender_node);
-		dlist_del(next_sender_node);
-
-		*tid = next_sender->tid;
-
-		int copy_len = min((int)next_sender->ipc_send_len, msglen);
-		memcpy(msg, next_sender->ipc_send_ptr, copy_len);
-
-		return (i64)next_sender->ipc_send_len;
+		return __syscall_receive_dequeue(current_task, tid, msg, msglen);
 	}
 }
 
@@ -319,17 +431,48 @@ i64 syscall_receive_nonblock(task_t *current_task, int *tid, char *msg, int msgl
 	} else {
 		klog_debug("[t:%d p:%d] syscall_receive_nonblock: sender found, processing message", current_task->tid,
 			   current_task->priority);
-		struct dlist_node *next_sender_node = dlist_first(&current_task->ipc_sender_queue);
-		task_t *next_sender = dlist_entry(next_sender_node, task_t, ipc_sender_node);
-		dlist_del(next_sender_node);
+		return __syscall_receive_dequeue(current_task, tid, msg, msglen);
+	}
+}
+
+i64 syscall_receive_many(task_t *current_task, int *tids, int *msglens, char *msgs, int msglen, int max_msgs)
+{
+	if (!tids || !msgs || msglen < 0 || max_msgs <= 0) {
+		klog_error("[t:%d p:%d] syscall_receive_many: invalid parameters", current_task->tid,
+			   current_task->priority);
+		return -1;
+	}
+
+	if (dlist_is_empty(&current_task->ipc_sender_queue)) {
+		klog_debug("[t:%d p:%d] syscall_receive_many: no sender, blocking task", current_task->tid,
+			   current_task->priority);
+		// The first sender delivers directly into slot 0, as with a plain Receive
+		current_task->ipc_receive_ptr = msgs;
+		current_task->ipc_receive_max_len = msglen;
+		current_task->ipc_receive_tid = tids;
+		current_task->ipc_receive_len = msglens;
+		current_task->ipc_receive_many = true;
 
-		*tid = next_sender->tid;
+		sched_block_task(current_task, TASK_BLOCK_IPC_RECEIVE);
+		sched_schedule();
 
-		int copy_len = min((int)next_sender->ipc_send_len, msglen);
-		memcpy(msg, next_sender->ipc_send_ptr, copy_len);
+		// This should never be reached as the task is blocked
+		panic("syscall_receive_many: task resumed unexpectedly");
+		return -2;
+	}
 
-		return (i64)next_sender->ipc_send_len;
+	int count = 0;
+	while (count < max_msgs && !dlist_is_empty(&current_task->ipc_sender_queue)) {
+		int len = __syscall_receive_dequeue(current_task, &tids[count], msgs + (size_t)count * msglen, msglen);
+		if (msglens) {
+			msglens[count] = len;
+		}
+		count++;
 	}
+
+	klog_debug("[t:%d p:%d] syscall_receive_many: drained %d senders", current_task->tid, current_task->priority,
+		   count);
+	return count;
 }
 
 i64 syscall_reply(task_t *current_task, int tid, const char *reply, int rplen)
@@ -351,11 +494,33 @@ i64 syscall_reply(task_t *current_task, int tid, const char *reply, int rplen)
 	klog_debug("[t:%d p:%d] syscall_reply: copying %d bytes (requested %d) to task %d", current_task->tid,
 		   current_task->priority, copy_len, rplen, tid);
 	memcpy(sender->ipc_reply_ptr, reply, copy_len);
+	ktrace(KTRACE_IPC_REPLY, current_task->tid, tid, rplen);
+	ipc_latency_record_service(current_task->tid, sender->ipc_receive_time);
 
 	__syscall_send_finish(sender, rplen); // Pass original size for truncation detection
 	return copy_len; // Return actual bytes copied
 }
 
+i64 syscall_reply_many(task_t *current_task, const int *tids, const char *replies, int rplen, int count)
+{
+	if (!tids || !replies || rplen < 0 || count <= 0) {
+		klog_error("[t:%d p:%d] syscall_reply_many: invalid parameters", current_task->tid,
+			   current_task->priority);
+		return -1;
+	}
+
+	int replied = 0;
+	for (int i = 0; i < count; i++) {
+		if (syscall_reply(current_task, tids[i], replies + (size_t)i * rplen, rplen) >= 0) {
+			replied++;
+		}
+	}
+
+	klog_debug("[t:%d p:%d] syscall_reply_many: replied to %d of %d senders", current_task->tid,
+		   current_task->priority, replied, count);
+	return replied;
+}
+
 i64 __noreturn syscall_panic(task_t *current_task, const char *msg)
 {
 	if (!msg) {
@@ -394,7 +559,8 @@ i64 syscall_wait_tid(task_t *current_task, int tid)
 		return -2;
 	}
 
-	current_task->wait_tid = tid;
+	current_task->cold->wait_tid = tid;
+	dlist_insert_tail(&target_task->cold->waiters, &current_task->cold->wait_node);
 	sched_block_task(current_task, TASK_BLOCK_WAIT_TID);
 	sched_schedule();
 
@@ -412,7 +578,15 @@ i64 syscall_await_event(task_t *current_task, int event_id)
 		return EVENT_ERROR;
 	}
 
+	if (event_id == EVENT_TIMER_TICK) {
+		int tick = time_take_pending_tick();
+		if (tick >= 0) {
+			return tick;
+		}
+	}
+
 	current_task->event_id = event_id;
+	ktrace(KTRACE_AWAIT_EVENT, current_task->tid, event_id, 0);
 
 	sched_block_task(current_task, TASK_BLOCK_AWAIT_EVENT);
 	sched_schedule();
@@ -440,13 +614,181 @@ i64 syscall_get_unread_klogs(task_t *current_task, char *buffer, int buffer_size
 		return -1;
 	}
 
-	int result = klog_read_all_unread_formatted(buffer, buffer_size, (size_t *)num_entries);
+	size_t entries = *num_entries > 0 ? (size_t)*num_entries : 0;
+	int result = klog_read_all_unread_formatted(buffer, buffer_size, &entries);
+	*num_entries = entries;
 
 	klog_debug("[t:%d p:%d] syscall_get_unread_klogs: returning %d entries, %d bytes", current_task->tid,
 		   current_task->priority, *num_entries, result);
 	return result; // Return bytes written
 }
 
+i64 syscall_trace_dump(task_t *current_task, void *buffer, int buffer_size)
+{
+	klog_debug("[t:%d p:%d] syscall_trace_dump: buffer=%p, buffer_size=%d", current_task->tid,
+		   current_task->priority, buffer, buffer_size);
+
+	if (!buffer) {
+		ktrace_dump_console(buffer_size > 0 ? (u32)buffer_size : 0);
+		return 0;
+	}
+
+	if (buffer_size <= 0) {
+		klog_error("[t:%d p:%d] syscall_trace_dump: invalid buffer size %d", current_task->tid,
+			   current_task->priority, buffer_size);
+		return -1;
+	}
+
+	return ktrace_dump(buffer, (size_t)buffer_size);
+}
+
+i64 syscall_get_task_stats(task_t *current_task, int tid, task_stats_t *stats, int max_tasks)
+{
+	klog_debug("[t:%d p:%d] syscall_get_task_stats: tid=%d, stats=%p, max_tasks=%d", current_task->tid,
+		   current_task->priority, tid, stats, max_tasks);
+
+	if (!stats || max_tasks <= 0) {
+		klog_error("[t:%d p:%d] syscall_get_task_stats: invalid parameters", current_task->tid,
+			   current_task->priority);
+		return -1;
+	}
+
+	return task_get_stats(tid, stats, max_tasks);
+}
+
+i64 syscall_get_ipc_latency(task_t *current_task, int tid, ipc_latency_t *latency, int reset)
+{
+	klog_debug("[t:%d p:%d] syscall_get_ipc_latency: tid=%d, latency=%p, reset=%d", current_task->tid,
+		   current_task->priority, tid, latency, reset);
+
+	if (latency && ipc_latency_get(tid, latency) < 0) {
+		klog_error("[t:%d p:%d] syscall_get_ipc_latency: invalid TID %d", current_task->tid,
+			   current_task->priority, tid);
+		return -1;
+	}
+
+	if (reset) {
+		return ipc_latency_reset(tid);
+	}
+
+	return latency ? 0 : -1;
+}
+
+i64 syscall_profile(task_t *current_task, int cmd, int arg, profile_report_t *report)
+{
+	klog_debug("[t:%d p:%d] syscall_profile: cmd=%d, arg=%d, report=%p", current_task->tid, current_task->priority,
+		   cmd, arg, report);
+
+	if (arg < 0) {
+		klog_error("[t:%d p:%d] syscall_profile: invalid argument %d", current_task->tid, current_task->priority,
+			   arg);
+		return -1;
+	}
+
+	switch (cmd) {
+	case PROFILE_START:
+		return profile_start((u32)arg);
+	case PROFILE_STOP:
+		profile_stop();
+		return 0;
+	case PROFILE_RESET:
+		profile_reset();
+		return 0;
+	case PROFILE_REPORT:
+		if (!report) {
+			klog_error("[t:%d p:%d] syscall_profile: NULL report", current_task->tid, current_task->priority);
+			return -1;
+		}
+		return profile_report(report, (u32)arg);
+	default:
+		klog_error("[t:%d p:%d] syscall_profile: unknown command %d", current_task->tid, current_task->priority,
+			   cmd);
+		return -1;
+	}
+}
+
+i64 syscall_get_irq_latency(task_t *current_task, irq_latency_t *latency, int max_sources, int reset)
+{
+	klog_debug("[t:%d p:%d] syscall_get_irq_latency: latency=%p, max_sources=%d, reset=%d", current_task->tid,
+		   current_task->priority, latency, max_sources, reset);
+
+	int result = 0;
+	if (latency) {
+		result = irq_latency_get(latency, max_sources);
+		if (result < 0) {
+			klog_error("[t:%d p:%d] syscall_get_irq_latency: invalid max_sources %d", current_task->tid,
+				   current_task->priority, max_sources);
+			return -1;
+		}
+	} else if (!reset) {
+		return -1;
+	}
+
+	if (reset) {
+		irq_latency_reset();
+	}
+
+	return result;
+}
+
+i64 syscall_get_clock_time(task_t *current_task, clock_time_t *time)
+{
+	if (!time) {
+		klog_error("[t:%d p:%d] syscall_get_clock_time: NULL time", current_task->tid, current_task->priority);
+		return -1;
+	}
+
+	time_get_clock(time);
+	return 0;
+}
+
+i64 syscall_request_tick(task_t *current_task, int tick)
+{
+	klog_debug("[t:%d p:%d] syscall_request_tick: tick=%d", current_task->tid, current_task->priority, tick);
+
+	if (tick < 0) {
+		klog_error("[t:%d p:%d] syscall_request_tick: negative tick %d", current_task->tid,
+			   current_task->priority, tick);
+		return -1;
+	}
+
+	time_request_tick((u32)tick);
+	return time_get_tick_count();
+}
+
+i64 syscall_sleep_us(task_t *current_task, u64 time_us, int absolute)
+{
+	klog_debug("[t:%d p:%d] syscall_sleep_us: time_us=%llu, absolute=%d", current_task->tid,
+		   current_task->priority, time_us, absolute);
+
+	u64 now = TIME_GET_TICK_64();
+	u64 expires = absolute ? time_monotonic_us_to_tick(time_us) : now + time_us;
+
+	if (expires <= now) {
+		return 0;
+	}
+
+	hrtimer_start(&current_task->cold->sleep_timer, expires);
+
+	// task_sleep_expired sets the return value and unblocks the task
+	sched_block_task(current_task, TASK_BLOCK_TIMER);
+	sched_schedule();
+
+	panic("syscall_sleep_us: task resumed unexpectedly");
+	return -2;
+}
+
+i64 syscall_console_write(task_t *current_task, const char *buf, int len)
+{
+	klog_debug("[t:%d p:%d] syscall_console_write: len=%d", current_task->tid, current_task->priority, len);
+
+	if (len < 0) {
+		return -1;
+	}
+
+	return (i64)uart_putl_nonblock(CONSOLE, buf, (size_t)len);
+}
+
 i64 syscall_get_task_info(task_t *current_task, char *buffer, int buffer_size)
 {
 	klog_debug("[t:%d p:%d] syscall_get_task_info: buffer=%p, buffer_size=%d", current_task->tid,
@@ -477,20 +819,23 @@ void __noreturn syscall_reboot(task_t *current_task)
 	UNREACHABLE();
 }
 
-static void __syscall_kill_children(task_t *current_task, int parent_tid)
+static void __syscall_kill_children(task_t *current_task, task_t *parent)
 {
-	// We need to iterate through all tasks to find children
-	for (int i = 1; i < MAX_TASKS; i++) {
-		task_t *task = task_get_by_id(i);
-		if (task && task->parent_tid == parent_tid && task->state != TASK_STATE_TERMINATED) {
-			klog_debug("[t:%d p:%d] syscall_kill: killing child task %d (parent %d)", current_task->tid,
-				   current_task->priority, i, parent_tid);
+	task_cold_t *child_cold;
+	struct dlist_node *n;
 
-			__syscall_kill_children(current_task, i);
+	// task_destroy unlinks each child from the parent's list, so iterate safely
+	dlist_for_each_entry_safe(child_cold, n, &parent->cold->children, task_cold_t, child_node)
+	{
+		task_t *child = child_cold->task;
 
-			sched_unblock_waiting_tasks(i, __syscall_unblock_waiting_tasks);
-			task_destroy(task);
-		}
+		klog_debug("[t:%d p:%d] syscall_kill: killing child task %d (parent %d)", current_task->tid,
+			   current_task->priority, child->tid, parent->tid);
+
+		__syscall_kill_children(current_task, child);
+
+		sched_unblock_waiting_tasks(child, __syscall_unblock_waiting_tasks);
+		task_destroy(child);
 	}
 }
 
@@ -522,11 +867,11 @@ i64 syscall_kill(task_t *current_task, int tid, int kill_children)
 	if (kill_children) {
 		klog_debug("[t:%d p:%d] syscall_kill: killing children of task %d", current_task->tid,
 			   current_task->priority, tid);
-		__syscall_kill_children(current_task, tid);
+		__syscall_kill_children(current_task, target_task);
 	}
 
 	// Unblock any tasks waiting for the target task
-	sched_unblock_waiting_tasks(tid, __syscall_unblock_waiting_tasks);
+	sched_unblock_waiting_tasks(target_task, __syscall_unblock_waiting_tasks);
 
 	// Terminate the target task
 	task_destroy(target_task);
@@ -8,19 +8,34 @@
 #include "symbol.h"
 #include "params.h"
 #include "printf.h"
+#include "timer/time.h"
+#include "ipc_latency.h"
+#include "irq_latency.h"
 #include "types.h"
 #include <stddef.h>
 
 // External stack area symbols
 extern char __user_stacks_start[];
-char *__user_stacks_end = (char *)__user_stacks_start + (MAX_TASKS * TASK_STACK_SIZE);
+static char *const __user_small_stacks_start = (char *)__user_stacks_start + (MAX_TASK_STACKS * TASK_STACK_SIZE);
+char *__user_stacks_end =
+	(char *)__user_stacks_start + (MAX_TASK_STACKS * TASK_STACK_SIZE) + (MAX_TASKS * TASK_SMALL_STACK_SIZE);
 
-// Task table
+#define TID_BITMAP_WORDS ((MAX_TASKS + 31) / 32)
+#define STACK_BITMAP_WORDS ((MAX_TASK_STACKS + 31) / 32)
+
+// Task table, split into hot scheduling/IPC fields, register contexts and cold data
 static task_t task_table[MAX_TASKS];
+static context_t task_context_table[MAX_TASKS];
+static task_cold_t task_cold_table[MAX_TASKS];
 static bool task_id_used[MAX_TASKS];
 
-// Stack allocation bitmap
-static bool stack_allocated[MAX_TASKS];
+// Free TID bitmap (bit set = free) with a summary word marking which bitmap words have a free bit,
+// so allocation is two find-first-set operations regardless of table size
+static u32 tid_free_bitmap[TID_BITMAP_WORDS];
+static u32 tid_free_summary;
+
+// Free full-size stack bitmap (bit set = free); small stacks are indexed by TID
+static u32 stack_free_bitmap[STACK_BITMAP_WORDS];
 
 void task_init(void)
 {
@@ -30,13 +45,33 @@ void task_init(void)
 		task_table[i].tid = -1;
 		task_table[i].state = TASK_STATE_TERMINATED;
 		task_table[i].block_reason = TASK_BLOCK_NONE;
-		task_table[i].wait_tid = -1;
+		task_table[i].context = &task_context_table[i];
+		task_table[i].cold = &task_cold_table[i];
+		task_cold_table[i].task = &task_table[i];
+		task_cold_table[i].wait_tid = -1;
 		task_id_used[i] = false;
-		stack_allocated[i] = false;
 
 		dlist_init_node(&task_table[i].ready_queue_node);
 		dlist_init_node(&task_table[i].blocked_queue_node);
 		dlist_init(&task_table[i].ipc_sender_queue);
+		dlist_init_node(&task_table[i].ipc_sender_node);
+		dlist_init(&task_cold_table[i].waiters);
+		dlist_init_node(&task_cold_table[i].wait_node);
+		dlist_init(&task_cold_table[i].children);
+		dlist_init_node(&task_cold_table[i].child_node);
+	}
+
+	memset(tid_free_bitmap, 0, sizeof(tid_free_bitmap));
+	tid_free_summary = 0;
+
+	// TID 0 is never handed out
+	for (i = 1; i < MAX_TASKS; i++) {
+		task_free_tid(i);
+	}
+
+	memset(stack_free_bitmap, 0, sizeof(stack_free_bitmap));
+	for (i = 0; i < MAX_TASK_STACKS; i++) {
+		set_bit(stack_free_bitmap, i);
 	}
 
 	klog_info("Task system initialized");
@@ -44,19 +79,29 @@ void task_init(void)
 
 int task_alloc_tid(void)
 {
-	for (int i = 1; i < MAX_TASKS; i++) {
-		if (!task_id_used[i]) {
-			task_id_used[i] = true;
-			return i;
-		}
+	if (tid_free_summary == 0) {
+		return -1;
 	}
-	return -1;
+
+	// Lowest free TID first, so boot-time TIDs (e.g. the name server) stay fixed
+	int word = ffs_u32(tid_free_summary) - 1;
+	int tid = word * 32 + ffs_u32(tid_free_bitmap[word]) - 1;
+
+	clear_bit(tid_free_bitmap, tid);
+	if (tid_free_bitmap[word] == 0) {
+		clear_bit(&tid_free_summary, word);
+	}
+
+	task_id_used[tid] = true;
+	return tid;
 }
 
 void task_free_tid(int tid)
 {
 	if (tid > 0 && tid < MAX_TASKS) {
 		task_id_used[tid] = false;
+		set_bit(tid_free_bitmap, tid);
+		set_bit(&tid_free_summary, tid / 32);
 	}
 }
 
@@ -68,27 +113,41 @@ task_t *task_get_by_id(int tid)
 	return &task_table[tid];
 }
 
-void *task_alloc_stack(int task_id)
+void *task_alloc_stack(int task_id, size_t stack_size)
 {
 	if (task_id < 0 || task_id >= MAX_TASKS) {
 		return NULL;
 	}
 
-	if (stack_allocated[task_id]) {
-		klog_error("Stack already allocated for task %d", task_id);
+	if (stack_size > TASK_STACK_SIZE) {
+		klog_error("Stack size %d too large for task %d", (int)stack_size, task_id);
 		return NULL;
 	}
 
-	void *stack_base = __user_stacks_start + (task_id * TASK_STACK_SIZE);
+	void *stack_base;
 
-	if (stack_base + TASK_STACK_SIZE > (void *)__user_stacks_end) {
-		klog_error("Stack allocation out of bounds for task %d", task_id);
-		return NULL;
-	}
+	if (stack_size <= TASK_SMALL_STACK_SIZE) {
+		stack_base = __user_small_stacks_start + (task_id * TASK_SMALL_STACK_SIZE);
+	} else {
+		int slot = -1;
+
+		for (int word = 0; word < STACK_BITMAP_WORDS; word++) {
+			if (stack_free_bitmap[word] != 0) {
+				slot = word * 32 + ffs_u32(stack_free_bitmap[word]) - 1;
+				break;
+			}
+		}
 
-	stack_allocated[task_id] = true;
+		if (slot < 0) {
+			klog_error("No full-size stacks left for task %d", task_id);
+			return NULL;
+		}
+
+		clear_bit(stack_free_bitmap, slot);
+		stack_base = __user_stacks_start + (slot * TASK_STACK_SIZE);
+	}
 
-	klog_debug("Allocated stack for task %d at %p (size: %d bytes)", task_id, stack_base, TASK_STACK_SIZE);
+	klog_debug("Allocated stack for task %d at %p (size: %d bytes)", task_id, stack_base, (int)stack_size);
 
 	return stack_base;
 }
@@ -98,32 +157,52 @@ void task_free_stack(void *stack_base)
 	if (!stack_base)
 		return;
 
+	// Small stacks belong to their TID and need no bookkeeping
+	if ((char *)stack_base >= __user_small_stacks_start)
+		return;
+
 	ptrdiff_t offset = (char *)stack_base - __user_stacks_start;
-	int task_id = offset / TASK_STACK_SIZE;
+	int slot = offset / TASK_STACK_SIZE;
 
-	if (task_id >= 0 && task_id < MAX_TASKS) {
-		stack_allocated[task_id] = false;
-		klog_debug("Freed stack for task %d", task_id);
+	if (slot >= 0 && slot < MAX_TASK_STACKS) {
+		set_bit(stack_free_bitmap, slot);
+		klog_debug("Freed stack slot %d", slot);
 	}
 }
 
 void task_setup_stack(task_t *task, void (*entry_point)(void))
 {
-	if (!task || !task->stack_base)
+	if (!task || !task->cold->stack_base)
 		return;
 
 	// Stack grows downward
-	task->stack_top = (char *)task->stack_base + task->stack_size;
+	task->cold->stack_top = (char *)task->cold->stack_base + task->cold->stack_size;
+
+	memset(task->context, 0, sizeof(context_t));
+
+	klog_debug("Set up stack for task %d: base=%p, top=%p, entry=%p", task->tid, task->cold->stack_base,
+		   task->cold->stack_top, entry_point);
+}
+
+// hrtimer callback ending a SleepUs, in IRQ context. The syscall returns how late the wakeup was.
+static void task_sleep_expired(hrtimer_t *timer, u64 now)
+{
+	task_cold_t *cold = (task_cold_t *)((char *)timer - offsetof(task_cold_t, sleep_timer));
+	task_t *task = cold->task;
 
-	memset(&task->context, 0, sizeof(context_t));
+	if (task->state != TASK_STATE_BLOCKED || task->block_reason != TASK_BLOCK_TIMER) {
+		return;
+	}
 
-	klog_debug("Set up stack for task %d: base=%p, top=%p, entry=%p", task->tid, task->stack_base, task->stack_top,
-		   entry_point);
+	u64 late_us = TICK_TO_US(now - timer->expires);
+	REG_X0(task->context->regs) = late_us > 0x7FFFFFFF ? 0x7FFFFFFF : late_us;
+	irq_latency_mark_wakeup(task);
+	sched_unblock_task(task);
 }
 
-task_t *task_create(void (*entry_point)(void), int priority)
+task_t *task_create(void (*entry_point)(void), int priority, size_t stack_size)
 {
-	if (!entry_point || priority < 0 || priority >= MAX_PRIORITIES) {
+	if (!entry_point || priority < 0 || priority >= MAX_PRIORITIES || stack_size > TASK_STACK_SIZE) {
 		klog_error("Invalid task parameters");
 		return NULL;
 	}
@@ -136,32 +215,50 @@ task_t *task_create(void (*entry_point)(void), int priority)
 
 	task_t *task = &task_table[tid];
 
-	void *stack_base = task_alloc_stack(tid);
+	// Round up to a whole stack class
+	stack_size = stack_size <= TASK_SMALL_STACK_SIZE ? TASK_SMALL_STACK_SIZE : TASK_STACK_SIZE;
+
+	void *stack_base = task_alloc_stack(tid, stack_size);
 	if (!stack_base) {
 		task_free_tid(tid);
 		klog_error("Failed to allocate stack for task %d", tid);
 		return NULL;
 	}
 
-	memset(stack_base, 0, TASK_STACK_SIZE);
+	memset(stack_base, 0, stack_size);
 
 	task->tid = tid;
-	task->parent_tid = current_task ? current_task->tid : 0;
+	task->cold->parent_tid = current_task ? current_task->tid : 0;
 	task->priority = priority;
 	task->state = TASK_STATE_READY;
 	task->block_reason = TASK_BLOCK_NONE;
-	task->wait_tid = -1;
-	task->entry_point = entry_point;
-	task->stack_base = stack_base;
-	task->stack_size = TASK_STACK_SIZE;
+	task->cold->wait_tid = -1;
+	task->ipc_receive_len = NULL;
+	task->ipc_receive_many = false;
+	memset(&task->acct, 0, sizeof(task->acct));
+	task->irq_wake_time = 0;
+	ipc_latency_reset(tid);
+	task->cold->entry_point = entry_point;
+	task->cold->stack_base = stack_base;
+	task->cold->stack_size = stack_size;
+	hrtimer_init(&task->cold->sleep_timer, task_sleep_expired);
 
 	task_setup_stack(task, entry_point);
 
 	dlist_init_node(&task->ready_queue_node);
 	dlist_init_node(&task->blocked_queue_node);
 	dlist_init(&task->ipc_sender_queue);
+	dlist_init_node(&task->ipc_sender_node);
+	dlist_init(&task->cold->waiters);
+	dlist_init_node(&task->cold->wait_node);
+	dlist_init(&task->cold->children);
+	dlist_init_node(&task->cold->child_node);
+
+	if (current_task) {
+		dlist_insert_tail(&current_task->cold->children, &task->cold->child_node);
+	}
 
-	context_init(&task->context, task->stack_top, entry_point);
+	context_init(task->context, task->cold->stack_top, entry_point);
 
 	klog_debug("Created task %d (priority %d) with entry point %p", tid, priority, entry_point);
 
@@ -175,9 +272,23 @@ void task_destroy(task_t *task)
 
 	klog_debug("Destroying task %d", task->tid);
 
+	hrtimer_cancel(&task->cold->sleep_timer);
 	sched_remove_task(task);
 
-	task_free_stack(task->stack_base);
+	// A task killed while queued to send must not stay on the receiver's sender queue
+	dlist_del(&task->ipc_sender_node);
+
+	// Detach from the task tree; surviving children become orphans
+	dlist_del(&task->cold->wait_node);
+	dlist_del(&task->cold->child_node);
+
+	struct dlist_node *pos, *n;
+	dlist_for_each_safe(pos, n, &task->cold->children)
+	{
+		dlist_del(pos);
+	}
+
+	task_free_stack(task->cold->stack_base);
 	task_free_tid(task->tid);
 
 	task->tid = -1;
@@ -243,9 +354,9 @@ void task_dump(void)
 					klog_debug(
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s, awaiting_event=%s",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason),
 						event_id_to_string(task_table[i].event_id));
 					break;
@@ -253,20 +364,20 @@ void task_dump(void)
 					klog_debug(
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s, wait_tid=%d",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason),
-						task_table[i].wait_tid);
+						task_cold_table[i].wait_tid);
 					break;
 				case TASK_BLOCK_IPC_RECEIVE:
 				case TASK_BLOCK_IPC_REPLY:
 					klog_debug(
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason));
 					break;
 				case TASK_BLOCK_TIMER:
@@ -274,9 +385,9 @@ void task_dump(void)
 					klog_debug(
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason));
 					break;
 				}
@@ -284,8 +395,8 @@ void task_dump(void)
 				klog_debug(
 					"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d",
 					i, task_state_to_string(task_table[i].state), task_table[i].priority,
-					task_table[i].entry_point, symbol_lookup((uint64_t)task_table[i].entry_point),
-					task_table[i].tid, task_table[i].parent_tid);
+					task_cold_table[i].entry_point, symbol_lookup((uint64_t)task_cold_table[i].entry_point),
+					task_table[i].tid, task_cold_table[i].parent_tid);
 			}
 		}
 	}
@@ -325,9 +436,9 @@ int task_format_info(char *buffer, int buffer_size)
 						buffer + offset, remaining,
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s, awaiting_event=%s\n",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason),
 						event_id_to_string(task_table[i].event_id));
 					break;
@@ -336,11 +447,11 @@ int task_format_info(char *buffer, int buffer_size)
 						buffer + offset, remaining,
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s, wait_tid=%d\n",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason),
-						task_table[i].wait_tid);
+						task_cold_table[i].wait_tid);
 					break;
 				case TASK_BLOCK_IPC_RECEIVE:
 				case TASK_BLOCK_IPC_REPLY:
@@ -350,9 +461,9 @@ int task_format_info(char *buffer, int buffer_size)
 						buffer + offset, remaining,
 						"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d, block_reason=%s\n",
 						i, task_state_to_string(task_table[i].state), task_table[i].priority,
-						task_table[i].entry_point,
-						symbol_lookup((uint64_t)task_table[i].entry_point), task_table[i].tid,
-						task_table[i].parent_tid,
+						task_cold_table[i].entry_point,
+						symbol_lookup((uint64_t)task_cold_table[i].entry_point), task_table[i].tid,
+						task_cold_table[i].parent_tid,
 						task_block_reason_to_string(task_table[i].block_reason));
 					break;
 				}
@@ -361,8 +472,8 @@ int task_format_info(char *buffer, int buffer_size)
 					buffer + offset, remaining,
 					"Task %d: state=%s, priority=%d, entry_point=%p in %s, tid=%d, parent_tid=%d\n",
 					i, task_state_to_string(task_table[i].state), task_table[i].priority,
-					task_table[i].entry_point, symbol_lookup((uint64_t)task_table[i].entry_point),
-					task_table[i].tid, task_table[i].parent_tid);
+					task_cold_table[i].entry_point, symbol_lookup((uint64_t)task_cold_table[i].entry_point),
+					task_table[i].tid, task_cold_table[i].parent_tid);
 			}
 
 			if (written >= remaining)
@@ -374,3 +485,55 @@ int task_format_info(char *buffer, int buffer_size)
 
 	return offset; // Return total bytes written
 }
+
+static void task_fill_stats(task_t *task, task_stats_t *stats)
+{
+	stats->tid = task->tid;
+	stats->parent_tid = task->cold->parent_tid;
+	stats->priority = task->priority;
+	stats->reserved = 0;
+	stats->run_time_us = task->acct.run_time_us;
+	stats->dispatches = task->acct.dispatches;
+	stats->voluntary_switches = task->acct.voluntary_switches;
+	stats->preemptions = task->acct.preemptions;
+	stats->sends = task->acct.sends;
+	stats->receives = task->acct.receives;
+	stats->reserved2 = 0;
+
+	// The running task has not been charged for its current slice yet
+	if (task == current_task) {
+		stats->run_time_us += TIME_GET_TICK_US() - task->acct.dispatch_time;
+	}
+
+	strncpy(stats->name, symbol_lookup((uint64_t)task->cold->entry_point), TASK_STATS_NAME_SIZE - 1);
+	stats->name[TASK_STATS_NAME_SIZE - 1] = '\0';
+}
+
+/**
+ * Copy the accounting counters of one task, or of every live task when tid is -1
+ *
+ * @return Number of entries written to stats, or -1 if tid does not name a live task
+ */
+int task_get_stats(int tid, task_stats_t *stats, int max_tasks)
+{
+	if (!stats || max_tasks <= 0) {
+		return -1;
+	}
+
+	if (tid != -1) {
+		if (tid < 0 || tid >= MAX_TASKS || !task_id_used[tid]) {
+			return -1;
+		}
+		task_fill_stats(&task_table[tid], stats);
+		return 1;
+	}
+
+	int count = 0;
+	for (int i = 0; i < MAX_TASKS && count < max_tasks; i++) {
+		if (task_id_used[i]) {
+			task_fill_stats(&task_table[i], &stats[count++]);
+		}
+	}
+
+	return count;
+}
@@ -0,0 +1,111 @@
+#include "timer/hrtimer.h"
+#include "timer/time.h"
+#include "interrupt.h"
+#include "arch/interrupts.h"
+#include "irq_latency.h"
+#include "klog.h"
+
+static DLIST_HEAD(hrtimer_pending);
+
+// The compare only matches on equality with CLO, so an expiry that is due or too close to reach in time
+// is armed just ahead of the counter instead. Expiries over 2^32 us away match early when CLO wraps and
+// are re-armed by the handler.
+static void hrtimer_arm(void)
+{
+	if (dlist_is_empty(&hrtimer_pending)) {
+		return;
+	}
+
+	hrtimer_t *next = dlist_entry(dlist_first(&hrtimer_pending), hrtimer_t, node);
+	u64 earliest = TIME_GET_TICK_64() + TIME_TICK_MIN_LEAD_US;
+
+	SYSTEM_TIMER_REG(C3) = (u32)(next->expires > earliest ? next->expires : earliest);
+}
+
+static void hrtimer_handler(u32 irq, void *data)
+{
+	(void)irq;
+	(void)data;
+
+	// Latency from the compare that actually matched. The head's expiry can be stale after a cancel, earlier
+	// than C3 when it was armed just ahead of the counter, or far off when CLO wrapped.
+	irq_latency_source(IRQ_LATENCY_HRTIMER, irq_latency_timer_event(SYSTEM_TIMER_REG(C3)));
+	SYSTEM_TIMER_REG(CS) = (1 << 3);
+
+	if (dlist_is_empty(&hrtimer_pending)) {
+		return;
+	}
+
+	u64 now = TIME_GET_TICK_64();
+	while (!dlist_is_empty(&hrtimer_pending)) {
+		hrtimer_t *timer = dlist_entry(dlist_first(&hrtimer_pending), hrtimer_t, node);
+		if (timer->expires > now) {
+			break;
+		}
+
+		dlist_del(&timer->node);
+		timer->active = false;
+		timer->callback(timer, now);
+	}
+
+	hrtimer_arm();
+}
+
+void hrtimer_subsystem_init(void)
+{
+	dlist_init(&hrtimer_pending);
+
+	if (interrupt_register_handler(IRQ_SYSTEM_TIMER_3, hrtimer_handler, NULL) < 0) {
+		klog_error("Failed to register high-resolution timer interrupt handler");
+		return;
+	}
+
+	interrupt_set_type(IRQ_SYSTEM_TIMER_3, IRQ_TYPE_LEVEL_HIGH);
+	interrupt_set_priority(IRQ_SYSTEM_TIMER_3, IRQ_PRIORITY_SYSTEM_TIMER);
+	SYSTEM_TIMER_REG(CS) = (1 << 3);
+	interrupt_enable(IRQ_SYSTEM_TIMER_3);
+}
+
+void hrtimer_init(hrtimer_t *timer, hrtimer_callback_fn callback)
+{
+	dlist_init_node(&timer->node);
+	timer->callback = callback;
+	timer->expires = 0;
+	timer->active = false;
+}
+
+void hrtimer_start(hrtimer_t *timer, u64 expires)
+{
+	if (timer->active) {
+		dlist_del(&timer->node);
+	}
+
+	timer->expires = expires;
+	timer->active = true;
+
+	// Insert in order of expiry, after timers with the same expiry
+	struct dlist_node *pos;
+	dlist_for_each(pos, &hrtimer_pending)
+	{
+		hrtimer_t *t = dlist_entry(pos, hrtimer_t, node);
+		if (expires < t->expires) {
+			break;
+		}
+	}
+	dlist_insert(pos->prev, &timer->node);
+
+	if (dlist_first(&hrtimer_pending) == &timer->node) {
+		hrtimer_arm();
+	}
+}
+
+void hrtimer_cancel(hrtimer_t *timer)
+{
+	if (!timer->active) {
+		return;
+	}
+
+	// C3 stays armed for the old head, the handler then finds nothing due and re-arms
+	dlist_del(&timer->node);
+	timer->active = false;
+}
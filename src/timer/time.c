@@ -7,41 +7,130 @@
 #include "event.h"
 #include "klog.h"
 #include "uart.h"
+#include "irq_latency.h"
 
 static u64 time_last_tick = 0;
 static u64 time_boot_tick = 0;
-static u32 timer_tick_count = 0;
+
+// The tick is tickless: tick N is the instant timer_tick_base + N * TIME_TICK_US of the free-running
+// counter, and C1 is only armed for the earliest tick a task asked for with time_request_tick. Tick
+// numbers come from the counter, so they stay exact however few interrupts are taken.
+static u64 timer_tick_base = 0;
+static u32 timer_wakeup_tick = TIME_NO_TICK; // Earliest requested tick, C1 is armed for it
+static u32 timer_slice_tick = TIME_NO_TICK; // Round-robin preemption point, C1 is armed for it if earlier
+static int timer_pending_tick = -1; // Tick that fired while nobody awaited EVENT_TIMER_TICK
+static u32 timer_missed_ticks = 0;
+static u32 timer_max_late_us = 0;
+
+static inline u64 time_tick_deadline(u32 tick)
+{
+	return timer_tick_base + (u64)tick * TIME_TICK_US;
+}
+
+u32 time_get_tick_count(void)
+{
+	return (u32)((TIME_GET_TICK_64() - timer_tick_base) / TIME_TICK_US);
+}
+
+// Arm C1 for the earlier of the requested tick and the slice end. The compare only matches on equality
+// with CLO, so a deadline that is due or too close to reach in time is armed just ahead of the counter instead.
+static void time_arm_wakeup(void)
+{
+	u32 tick = timer_wakeup_tick < timer_slice_tick ? timer_wakeup_tick : timer_slice_tick;
+	if (tick == TIME_NO_TICK) {
+		return;
+	}
+
+	u64 deadline = time_tick_deadline(tick);
+	u64 earliest = TIME_GET_TICK_64() + TIME_TICK_MIN_LEAD_US;
+
+	SYSTEM_TIMER_REG(C1) = (u32)(deadline > earliest ? deadline : earliest);
+}
+
+void time_request_tick(u32 tick)
+{
+	if (tick >= timer_wakeup_tick) {
+		return;
+	}
+
+	timer_wakeup_tick = tick;
+	time_arm_wakeup();
+}
+
+// Called by the scheduler while other tasks are ready at the dispatched task's priority. The slice ends on
+// the 10ms tick grid, as it did when every tick interrupted.
+void time_request_slice(void)
+{
+	if (timer_slice_tick != TIME_NO_TICK) {
+		return;
+	}
+
+	timer_slice_tick = time_get_tick_count() + 1;
+	if (timer_slice_tick < timer_wakeup_tick) {
+		time_arm_wakeup();
+	}
+}
+
+int time_take_pending_tick(void)
+{
+	int tick = timer_pending_tick;
+	timer_pending_tick = -1;
+	return tick;
+}
 
 static void timer_tick_handler(u32 irq, void *data)
 {
 	(void)data;
-	timer_tick_count++;
-
-	klog_debug("Timer tick interrupt %u (count: %u)", irq, timer_tick_count);
+	irq_latency_source(IRQ_LATENCY_TIMER_TICK, irq_latency_timer_event(SYSTEM_TIMER_REG(C1)));
 
 	SYSTEM_TIMER_REG(CS) = (1 << 1);
 
-	u32 current_time = SYSTEM_TIMER_REG(CLO);
-	SYSTEM_TIMER_REG(C1) = current_time + 10000;
+	u32 tick = time_get_tick_count();
+
+	// The interrupt itself ends the slice: irq_el0_handler preempts the running task on the way out
+	if (tick >= timer_slice_tick) {
+		timer_slice_tick = TIME_NO_TICK;
+	}
+
+	if (tick < timer_wakeup_tick) {
+		// Only the slice ended, or a request over 2^32 us away matched when CLO wrapped
+		time_arm_wakeup();
+		return;
+	}
+
+	u64 late_us = TIME_GET_TICK_64() - time_tick_deadline(timer_wakeup_tick);
+	if (late_us > timer_max_late_us) {
+		timer_max_late_us = (u32)late_us;
+	}
+	timer_missed_ticks += (u32)(late_us / TIME_TICK_US);
+	timer_wakeup_tick = TIME_NO_TICK;
+	time_arm_wakeup();
+
+	klog_debug("Timer tick interrupt %u (tick: %u, late: %u us)", irq, tick, (u32)late_us);
 
-	event_unblock_waiting_tasks(EVENT_TIMER_TICK, timer_tick_count);
+	// Keep the tick for the next AwaitEvent when its waiter is still busy with the previous one, so a
+	// requested wakeup is never lost
+	if (event_unblock_waiting_tasks(EVENT_TIMER_TICK, tick) == 0) {
+		timer_pending_tick = tick;
+	}
 }
 
 void time_setup_timer_tick(void)
 {
-	u32 current_time = SYSTEM_TIMER_REG(CLO);
-
 	if (interrupt_register_handler(IRQ_SYSTEM_TIMER_1, timer_tick_handler, NULL) == 0) {
 		interrupt_set_type(IRQ_SYSTEM_TIMER_1, IRQ_TYPE_LEVEL_HIGH);
+		interrupt_set_priority(IRQ_SYSTEM_TIMER_1, IRQ_PRIORITY_SYSTEM_TIMER);
 
 		interrupt_enable(IRQ_SYSTEM_TIMER_1);
 
 		SYSTEM_TIMER_REG(CS) = (1 << 1);
 
-		current_time = SYSTEM_TIMER_REG(CLO);
-		SYSTEM_TIMER_REG(C1) = current_time + 10000;
+		timer_tick_base = TIME_GET_TICK_64();
+		timer_wakeup_tick = TIME_NO_TICK;
+		timer_slice_tick = TIME_NO_TICK;
 
-		klog_info("Timer C1 interrupt configured for 10ms intervals (IRQ %u)", IRQ_SYSTEM_TIMER_1);
+		klog_info("Timer C1 interrupt configured for tickless %u us ticks (IRQ %u)", TIME_TICK_US,
+			  IRQ_SYSTEM_TIMER_1);
 	} else {
 		klog_error("Failed to register timer tick interrupt handler");
 	}
@@ -68,6 +157,25 @@ u64 time_get_boot_time_tick(void)
 	return TIME_GET_TICK_64() - time_boot_tick;
 }
 
+u64 time_get_monotonic_us(void)
+{
+	return TICK_TO_US(TIME_GET_TICK_64() - time_boot_tick);
+}
+
+// System timer count at a time_get_monotonic_us value
+u64 time_monotonic_us_to_tick(u64 time_us)
+{
+	return time_boot_tick + time_us * (TIME_FREQ / 1000000);
+}
+
+void time_get_clock(clock_time_t *clock)
+{
+	clock->time_us = time_get_monotonic_us();
+	clock->ticks = time_get_tick_count();
+	clock->missed_ticks = timer_missed_ticks;
+	clock->max_late_us = timer_max_late_us;
+}
+
 // format time to string, the buffer must be large enough to hold the string
 int time_format_time(char *buf, u64 tick, u32 style)
 {
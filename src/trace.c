@@ -0,0 +1,181 @@
+#include "trace.h"
+#include "klog.h"
+#include "symbol.h"
+#include "uart.h"
+
+// With tracing compiled out nothing records, so the ring shrinks to a single unused slot
+#if KTRACE_ENABLED
+#define KTRACE_RING_SIZE KTRACE_MAX_RECORDS
+#else
+#define KTRACE_RING_SIZE 1
+#endif
+
+static struct ktrace_record ktrace_ring[KTRACE_RING_SIZE];
+static u32 ktrace_head; // Total records written; the ring holds the last KTRACE_RING_SIZE
+
+// The generic timer is a system register read, far cheaper than the memory-mapped system timer
+static inline u32 ktrace_timestamp(void)
+{
+	u64 count;
+	asm volatile("mrs %0, cntpct_el0" : "=r"(count));
+	return (u32)count;
+}
+
+static inline u32 ktrace_timer_freq(void)
+{
+	u64 freq;
+	asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+	return (u32)freq;
+}
+
+void ktrace_record(u16 event, u16 tid, u32 arg0, u32 arg1)
+{
+	struct ktrace_record *record = &ktrace_ring[ktrace_head & (KTRACE_RING_SIZE - 1)];
+
+	record->timestamp = ktrace_timestamp();
+	record->event = event;
+	record->tid = tid;
+	record->arg0 = arg0;
+	record->arg1 = arg1;
+
+	ktrace_head++;
+}
+
+// Copy out the most recent records, oldest first
+int ktrace_read(struct ktrace_record *records, int max_records)
+{
+	u32 available = ktrace_head < KTRACE_RING_SIZE ? ktrace_head : KTRACE_RING_SIZE;
+	u32 count = (u32)max_records < available ? (u32)max_records : available;
+	u32 start = ktrace_head - count;
+
+	for (u32 i = 0; i < count; i++) {
+		records[i] = ktrace_ring[(start + i) & (KTRACE_RING_SIZE - 1)];
+	}
+
+	return (int)count;
+}
+
+/**
+ * Write a binary dump of the ring: a ktrace_dump_header followed by as many of the most recent records
+ * as fit, oldest first. scripts/ktrace_to_perfetto.py converts it to a timeline.
+ *
+ * @return Bytes written, or -1 if the buffer cannot hold the header
+ */
+int ktrace_dump(void *buffer, size_t size)
+{
+	if (!buffer || size < sizeof(struct ktrace_dump_header)) {
+		return -1;
+	}
+
+	struct ktrace_dump_header *header = buffer;
+	struct ktrace_record *records = (struct ktrace_record *)(header + 1);
+	int max_records = (size - sizeof(*header)) / sizeof(struct ktrace_record);
+	int count = ktrace_read(records, max_records);
+
+	header->magic = KTRACE_DUMP_MAGIC;
+	header->version = KTRACE_DUMP_VERSION;
+	header->record_size = sizeof(struct ktrace_record);
+	header->timer_freq = ktrace_timer_freq();
+	header->count = count;
+	header->dropped = ktrace_head - count;
+	header->reserved = 0;
+
+	return sizeof(*header) + count * sizeof(struct ktrace_record);
+}
+
+static void ktrace_dump_hex(const u8 *bytes, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+
+	for (size_t i = 0; i < len; i++) {
+		uart_putc_direct(CONSOLE, hex[bytes[i] >> 4]);
+		uart_putc_direct(CONSOLE, hex[bytes[i] & 0xf]);
+	}
+}
+
+// Write the most recent max_records records (0 for the whole ring) to the console as hex, one record per line
+// between KTRACE-BEGIN and KTRACE-END markers, so it can be cut out of a serial capture. Bypasses the UART
+// buffers with IRQs masked throughout; it is meant for panics and debugging sessions, not for a running system.
+void ktrace_dump_console(u32 max_records)
+{
+	struct ktrace_dump_header header;
+	struct ktrace_record record;
+
+	u32 available = ktrace_head < KTRACE_RING_SIZE ? ktrace_head : KTRACE_RING_SIZE;
+	if (max_records && max_records < available) {
+		available = max_records;
+	}
+	header.magic = KTRACE_DUMP_MAGIC;
+	header.version = KTRACE_DUMP_VERSION;
+	header.record_size = sizeof(struct ktrace_record);
+	header.timer_freq = ktrace_timer_freq();
+	header.count = available;
+	header.dropped = ktrace_head - available;
+	header.reserved = 0;
+
+	uart_process_tx_buffers_blocking();
+	uart_puts(CONSOLE, "\r\nKTRACE-BEGIN\r\n");
+	uart_process_tx_buffers_blocking();
+
+	ktrace_dump_hex((const u8 *)&header, sizeof(header));
+	for (u32 i = ktrace_head - available; i != ktrace_head; i++) {
+		record = ktrace_ring[i & (KTRACE_RING_SIZE - 1)];
+		uart_putc_direct(CONSOLE, '\r');
+		uart_putc_direct(CONSOLE, '\n');
+		ktrace_dump_hex((const u8 *)&record, sizeof(record));
+	}
+
+	uart_puts(CONSOLE, "\r\nKTRACE-END\r\n");
+	uart_process_tx_buffers_blocking();
+}
+
+const char *ktrace_event_to_string(u16 event)
+{
+	switch (event) {
+	case KTRACE_SCHED_ENQUEUE:
+		return "ENQUEUE";
+	case KTRACE_SCHED_DEQUEUE:
+		return "DEQUEUE";
+	case KTRACE_SCHED_BLOCK:
+		return "BLOCK";
+	case KTRACE_SCHED_UNBLOCK:
+		return "UNBLOCK";
+	case KTRACE_SCHED_SWITCH:
+		return "SWITCH";
+	case KTRACE_IRQ_ENTER:
+		return "IRQ_ENTER";
+	case KTRACE_IRQ_EXIT:
+		return "IRQ_EXIT";
+	case KTRACE_IPC_SEND:
+		return "SEND";
+	case KTRACE_IPC_RECEIVE:
+		return "RECEIVE";
+	case KTRACE_IPC_REPLY:
+		return "REPLY";
+	case KTRACE_AWAIT_EVENT:
+		return "AWAIT_EVENT";
+	case KTRACE_EVENT_DELIVER:
+		return "EVENT_DELIVER";
+	}
+	return "UNKNOWN";
+}
+
+// Formatting only happens here, on the way out
+void ktrace_print_recent(int count)
+{
+	u32 available = ktrace_head < KTRACE_RING_SIZE ? ktrace_head : KTRACE_RING_SIZE;
+	u32 n = (u32)count < available ? (u32)count : available;
+
+	for (u32 i = ktrace_head - n; i != ktrace_head; i++) {
+		struct ktrace_record *record = &ktrace_ring[i & (KTRACE_RING_SIZE - 1)];
+
+		if (record->event == KTRACE_SCHED_SWITCH) {
+			klog_force_info("%u: %s tid=%u priority=%u pc=%#x in %s", record->timestamp,
+					ktrace_event_to_string(record->event), record->tid, record->arg0, record->arg1,
+					symbol_lookup((uint64_t)record->arg1));
+		} else {
+			klog_force_info("%u: %s tid=%u arg0=%u arg1=%u", record->timestamp,
+					ktrace_event_to_string(record->event), record->tid, record->arg0, record->arg1);
+		}
+	}
+}
@@ -69,10 +69,40 @@ static void wake_expired_tasks(clock_server_state_t *state)
 	}
 }
 
+// The kernel counts ticks from the free-running timer, so the time is read rather than accumulated
+static void update_time(clock_server_state_t *state)
+{
+	clock_time_t now;
+
+	if (GetClockTime(&now) == 0) {
+		state->current_time_tick = (int)now.ticks;
+	}
+}
+
+// Wake the delays that are due and have the kernel interrupt at the next one. Nothing is requested while
+// no task is delayed, so an idle system takes no timer interrupts.
+static void schedule_wakeups(clock_server_state_t *state)
+{
+	update_time(state);
+	wake_expired_tasks(state);
+
+	if (dlist_is_empty(&state->delay_list)) {
+		return;
+	}
+
+	delayed_task_t *next = dlist_entry(dlist_first(&state->delay_list), delayed_task_t, node);
+	if (state->requested_tick < 0 || next->wake_time_tick < state->requested_tick) {
+		state->requested_tick = next->wake_time_tick;
+		RequestTick(next->wake_time_tick);
+	}
+}
+
 static void process_request(clock_server_state_t *state, int sender_tid, clock_request_t *request)
 {
 	clock_reply_t reply;
 
+	update_time(state);
+
 	switch (request->type) {
 	case CLOCK_TIME:
 		reply.time_tick = state->current_time_tick;
@@ -90,6 +120,8 @@ static void process_request(clock_server_state_t *state, int sender_tid, clock_r
 			if (result < 0) {
 				reply.time_tick = result; // Error code
 				Reply(sender_tid, (const char *)&reply, sizeof(reply));
+			} else {
+				schedule_wakeups(state);
 			}
 		}
 		break;
@@ -105,14 +137,17 @@ static void process_request(clock_server_state_t *state, int sender_tid, clock_r
 			if (result < 0) {
 				reply.time_tick = result; // Error code
 				Reply(sender_tid, (const char *)&reply, sizeof(reply));
+			} else {
+				schedule_wakeups(state);
 			}
 		}
 		break;
 
 	case CLOCK_TICK_NOTIFY:
-		state->current_time_tick++;
-		wake_expired_tasks(state);
+		// The kernel dropped the request it just delivered
+		state->requested_tick = -1;
 		Reply(sender_tid, (const char *)&reply, sizeof(reply));
+		schedule_wakeups(state);
 		break;
 
 	default:
@@ -129,12 +164,13 @@ void clock_server_main(void)
 	int sender_tid;
 
 	state.current_time_tick = 0;
+	state.requested_tick = -1;
 	dlist_init(&state.delay_list);
 	init_task_pool(&state);
 
 	RegisterAs(CLOCK_SERVER_NAME);
 
-	Create(CLOCK_SERVER_PRIORITY - 1, clock_notifier_main);
+	CreateWithStack(CLOCK_SERVER_PRIORITY - 1, clock_notifier_main, TASK_SMALL_STACK_SIZE);
 
 	for (;;) {
 		int result = Receive(&sender_tid, (char *)&request, sizeof(request));
@@ -164,6 +200,7 @@ void clock_notifier_main(void)
 			continue;
 		}
 
+		notify_msg.ticks = result; // Ticks since boot
 		Send(clock_server_tid, (const char *)&notify_msg, sizeof(notify_msg), (char *)&reply, sizeof(reply));
 	}
 }
@@ -17,6 +17,7 @@ typedef struct delayed_task {
 
 typedef struct {
 	int current_time_tick;
+	int requested_tick; // Tick the kernel will next deliver EVENT_TIMER_TICK at, -1 for none
 	struct dlist_node delay_list;
 	delayed_task_t task_pool[MAX_DELAYED_TASKS];
 	int free_tasks[MAX_DELAYED_TASKS];
@@ -52,6 +52,17 @@ typedef struct io_server_state {
 	struct dlist_node marklin_tx_queue;
 } io_server_state_t;
 
+// What the notifiers send: an io_request_t cut off after its notify member, so they can run on a small stack
+// instead of holding a full request with its 1MB putn buffer. type, channel and notify sit at the same
+// offsets as in io_request_t.
+typedef struct {
+	io_request_type_t type;
+	int channel;
+	struct {
+		int channel;
+	} notify;
+} io_notify_request_t;
+
 void io_server_task(void);
 void io_rx_notifier_task(void);
 void io_tx_notifier_task(void);
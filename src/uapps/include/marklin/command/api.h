@@ -10,13 +10,14 @@ typedef enum {
 
 typedef enum marklin_cmd_priority_enum marklin_cmd_priority_t;
 
-marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks);
-marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks);
+// gap_us is how long the command line stays quiet after this command, in microseconds (0 for the default)
+marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us);
+marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us);
 
 // Priority-aware command scheduling
-marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks,
+marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us,
 						    marklin_cmd_priority_t priority, u8 train_id);
-marklin_error_t Marklin_ScheduleCommandBlockingWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks,
+marklin_error_t Marklin_ScheduleCommandBlockingWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us,
 							    marklin_cmd_priority_t priority, u8 train_id);
 
 // Convenience function for emergency stops
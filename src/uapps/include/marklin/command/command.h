@@ -22,7 +22,7 @@ typedef struct {
 	marklin_cmd_type_t cmd_type;
 	u8 cmd;
 	u8 param;
-	i32 gap_ticks;
+	i32 gap_us;
 	marklin_cmd_priority_t priority;
 	u8 train_id;
 	u64 timestamp;
@@ -47,7 +47,7 @@ typedef struct {
 	marklin_error_t error;
 	union {
 		struct {
-			i32 next_delay_ticks;
+			i32 next_delay_us;
 		} timer;
 	};
 } marklin_cmd_reply_t;
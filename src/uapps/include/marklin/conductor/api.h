@@ -86,6 +86,15 @@ marklin_error_t Marklin_GetNextSensors(const track_node *current_location, train
 marklin_error_t Marklin_GetNextTwoSensors(const track_node *current_location, train_direction_t direction,
 					  const track_node **sensors, kinematic_distance_t *distances, u8 *count);
 
+// Same as Marklin_GetNextTwoSensors, and remember the sensors found as the ones train_id expects next:
+// their triggers are then published with the train id as key, see Marklin_MsgQueue_SubscribeKeyed
+marklin_error_t Marklin_ExpectNextTwoSensors(u8 train_id, const track_node *current_location,
+					     train_direction_t direction, const track_node **sensors,
+					     kinematic_distance_t *distances, u8 *count);
+
+// Forget the sensors train_id expects next, e.g. once it no longer knows where it is
+marklin_error_t Marklin_ClearExpectedSensors(u8 train_id);
+
 // Calculate actual distance between two track nodes following current switch states
 // from: Starting track node
 // to: Destination track node
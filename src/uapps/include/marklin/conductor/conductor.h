@@ -11,8 +11,10 @@
 #include "marklin/train/kinematics.h"
 #include "marklin/conductor/sensor.h"
 #include "marklin/conductor/block.h"
+#include "marklin/conductor/next_sensor.h"
 #include "marklin/error.h"
 #include "marklin/topology/api.h"
+#include "marklin/controller/api.h"
 
 #define MARKLIN_CONDUCTOR_TASK_PRIORITY 4
 
@@ -77,6 +79,7 @@ typedef struct {
 			const track_node **sensors;
 			kinematic_distance_t *distances;
 			u8 *count;
+			u8 train_id; // Nonzero: remember the result as this train's expected sensors
 		} get_next_two_sensors;
 		struct {
 			const track_node *from;
@@ -167,6 +170,14 @@ typedef struct {
 	marklin_sensor_state_t state; // Current sensor state
 } sensor_lookup_entry_t;
 
+// Sensors a train expects to trigger next, routing their triggers to it
+#define MAX_SENSOR_EXPECTATIONS MARKLIN_MAX_SPAWNED_TRAINS // One per spawned train
+typedef struct {
+	u8 train_id; // 0 = free slot
+	u8 count;
+	const track_node *sensors[2];
+} sensor_expectation_t;
+
 // Switch lookup entry
 typedef struct {
 	const track_node *switch_node; // Pointer to the switch track node (NODE_BRANCH)
@@ -190,11 +201,15 @@ typedef struct conductor_task_data_struct {
 	// Sensor lookup table
 	sensor_lookup_entry_t sensor_lookup[MARKLIN_SENSOR_BANK_COUNT * 16];
 	int sensor_count;
+	sensor_expectation_t sensor_expectations[MAX_SENSOR_EXPECTATIONS];
 
 	// Switch lookup table
 	switch_lookup_entry_t switch_lookup[MARKLIN_SWITCH_MAX_COUNT];
 	int switch_count;
 
+	// Next two sensors ahead of every node, follows the switch lookup table
+	next_sensor_table_t next_sensors;
+
 	// Track blocks for reservation system
 	track_block_t track_blocks[MAX_TRACK_BLOCKS];
 	int track_block_count;
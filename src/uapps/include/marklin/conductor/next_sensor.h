@@ -0,0 +1,42 @@
+#ifndef MARKLIN_CONDUCTOR_NEXT_SENSOR_H
+#define MARKLIN_CONDUCTOR_NEXT_SENSOR_H
+
+#include "types.h"
+#include "marklin/common/track_node.h"
+#include "marklin/train/kinematics.h"
+
+// Longest walk from a node to the sensor ahead of it
+#define NEXT_SENSOR_MAX_HOPS 50
+
+// First sensor ahead of a track node, following the current switch directions
+typedef struct {
+	const track_node *sensor; // NULL if no sensor is reachable
+	kinematic_distance_t distance; // mm from the node to the sensor
+} next_sensor_entry_t;
+
+// Next sensor of every track node, updated as switches change. Each direction of travel is its own node
+// (node->reverse), so one entry per node covers both; the sensor after that is the next sensor's own entry.
+typedef struct {
+	const track_node *track_nodes;
+	int track_size;
+	track_direction branch_directions[TRACK_MAX]; // Indexed by node, only meaningful for branches
+	next_sensor_entry_t entries[TRACK_MAX];
+	u16 visit_marks[TRACK_MAX]; // Scratch for finding the entries a switch change affects
+	u16 visit_generation;
+} next_sensor_table_t;
+
+// Build the table for a track with every switch straight
+void next_sensor_table_init(next_sensor_table_t *table, const track_node *track_nodes, int track_size);
+
+// Recompute every entry from the current switch directions
+void next_sensor_table_rebuild(next_sensor_table_t *table);
+
+// Record a switch direction and recompute only the entries whose walk can pass the branch.
+// Returns the number of entries recomputed.
+int next_sensor_table_set_switch(next_sensor_table_t *table, const track_node *branch, track_direction direction);
+
+// Up to two sensors ahead of node with their distances from it in mm. Returns how many were found.
+u8 next_sensor_table_lookup(const next_sensor_table_t *table, const track_node *node, const track_node **sensors,
+			    kinematic_distance_t *distances);
+
+#endif /* MARKLIN_CONDUCTOR_NEXT_SENSOR_H */
@@ -18,6 +18,7 @@
 
 void conductor_consume_sensor_data(u16 *sensor_data, u32 tick);
 u32 sensor_get_states(marklin_sensor_state_t *sensors, u32 count);
+void sensor_set_expected(u8 train_id, const track_node *const *sensors, u8 count);
 
 marklin_error_t sensor_set_reset_mode(u8 reset_on);
 
@@ -11,6 +11,7 @@
 #define MARKLIN_CONTROLLER_SERVER_NAME "marklin_controller"
 #define MARKLIN_MAX_TRAINS_IN_SNAPSHOT 16
 #define MARKLIN_MAX_SWITCHES_IN_SNAPSHOT 32
+#define MARKLIN_MAX_SPAWNED_TRAINS 16
 
 typedef enum {
 	MARKLIN_REQ_SPAWN_TRAIN,
@@ -49,15 +50,20 @@ typedef struct {
 	train_status_t status;
 	const track_node *next_sensor_1;
 	const track_node *next_sensor_2;
+	u32 position_reports_missed; // Position reports the controller skipped over by a sequence gap
+	u32 version; // Controller version at which this record last changed
 } marklin_train_snapshot_t;
 
 typedef struct {
 	u8 switch_id;
 	track_direction direction;
 	u64 last_changed_tick;
+	u32 version; // Controller version at which this record last changed
 } marklin_switch_snapshot_t;
 
 typedef struct {
+	u32 version; // Controller version the records are current to, 0 for an empty snapshot
+	u32 last_update_bytes; // Bytes the controller replied with on the last update
 	u8 active_train_count;
 	marklin_train_snapshot_t trains[MARKLIN_MAX_TRAINS_IN_SNAPSHOT];
 	u8 active_switch_count;
@@ -71,6 +77,8 @@ marklin_error_t Marklin_ControllerSwitchCommand(u8 switch_id, track_direction di
 marklin_error_t Marklin_ControllerGetSelfTrainInfo(marklin_train_spawn_info_t *info);
 marklin_error_t Marklin_ControllerTrainCommand(u8 train_id, const marklin_train_command_t *command);
 marklin_error_t Marklin_ControllerGetSystemSnapshot(marklin_system_snapshot_t *snapshot);
+// Copy in only the records changed since snapshot->version; start from a zeroed snapshot
+marklin_error_t Marklin_ControllerUpdateSystemSnapshot(marklin_system_snapshot_t *snapshot);
 marklin_error_t Marklin_ControllerStopAllTrains(void);
 marklin_error_t Marklin_ControllerSetAllSwitches(track_direction direction);
 marklin_error_t Marklin_ControllerStartDemo(void);
@@ -10,7 +10,16 @@
 #include "marklin/train2/api.h"
 
 #define MARKLIN_CONTROLLER_PRIORITY 5
-#define MARKLIN_MAX_SPAWNED_TRAINS 16
+
+// Records changed since the requested version, packed: train_count trains followed by switch_count switches
+typedef struct {
+	u32 version;
+	u8 full; // Every record is included and replaces what the caller has
+	u8 train_count;
+	u8 switch_count;
+	u8 records[MARKLIN_MAX_TRAINS_IN_SNAPSHOT * sizeof(marklin_train_snapshot_t) +
+		   MARKLIN_MAX_SWITCHES_IN_SNAPSHOT * sizeof(marklin_switch_snapshot_t)] __attribute__((aligned(8)));
+} marklin_system_snapshot_delta_t;
 
 typedef struct {
 	marklin_request_type_t type;
@@ -35,6 +44,10 @@ typedef struct {
 		struct {
 			marklin_track_type_t track_type;
 		} system_reset;
+
+		struct {
+			u32 since_version;
+		} system_snapshot;
 	};
 } marklin_request_t;
 
@@ -49,7 +62,7 @@ typedef struct {
 
 		marklin_train_spawn_info_t train_info;
 
-		marklin_system_snapshot_t system_snapshot;
+		marklin_system_snapshot_delta_t snapshot_delta;
 	};
 } marklin_reply_t;
 
@@ -80,6 +93,9 @@ typedef struct {
 	train_status_t status;
 	const track_node *next_sensor_1;
 	const track_node *next_sensor_2;
+	u32 position_sequence; // Sequence number of the last position report, 0 before the first
+	u32 position_reports_missed; // Reports skipped over by a sequence gap
+	u32 version; // Snapshot version of the last change
 } spawned_train_entry_t;
 
 // Switch state tracking
@@ -88,6 +104,7 @@ typedef struct {
 	u8 switch_id;
 	track_direction direction;
 	u64 last_changed_tick;
+	u32 version; // Snapshot version of the last change
 } controller_switch_entry_t;
 
 typedef struct {
@@ -102,6 +119,10 @@ typedef struct {
 	// Track switch states
 	struct dlist_node tracked_switches;
 	int tracked_switch_count;
+
+	// Every train and switch change bumps the version and stamps the record with it
+	u32 snapshot_version;
+	u32 snapshot_base_version; // Records were last cleared at this version
 } marklin_system_t;
 
 extern marklin_system_t marklin_system;
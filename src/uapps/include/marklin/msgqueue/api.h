@@ -7,12 +7,14 @@
 #define MARKLIN_MSGQUEUE_SERVER_NAME "marklin_msgqueue_server"
 #define MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS 32
 #define MARKLIN_MSGQUEUE_MAX_DATA_SIZE (4096 - sizeof(marklin_msgqueue_event_type_t) - sizeof(u32))
+#define MARKLIN_MSGQUEUE_NO_KEY 0xFFFF // Key of plain publishes, never coalesced
 
 typedef enum {
 	MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE,
 	MARKLIN_MSGQUEUE_EVENT_TYPE_TRAIN_POSITION,
 	MARKLIN_MSGQUEUE_EVENT_TYPE_SWITCH_STATE,
 	MARKLIN_MSGQUEUE_EVENT_TYPE_BLOCK_RESERVATION,
+	MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT,
 } marklin_msgqueue_event_type_t;
 
 typedef struct {
@@ -27,6 +29,11 @@ typedef struct {
 	u32 subscription_id;
 } marklin_msgqueue_subscription_t;
 
+typedef struct {
+	u32 coalesced; // Undelivered messages overwritten in place by a newer one with the same key
+	u32 dropped; // Messages not queued because the queue or its share of the payload pool was full
+} marklin_msgqueue_subscription_stats_t;
+
 #define MARKLIN_MSGQUEUE_CAST_TO(type, msg) (((msg)->data_size == sizeof(type)) ? (type *)(msg)->data : NULL)
 
 #define MARKLIN_MSGQUEUE_CAST_FROM(type, msg, data_ptr)                   \
@@ -56,6 +63,28 @@ marklin_error_t Marklin_MsgQueue_Publish(marklin_msgqueue_event_type_t event_typ
 #define Marklin_MsgQueue_PublishTyped(event_type, data_ptr) \
 	Marklin_MsgQueue_Publish(event_type, data_ptr, sizeof(*(data_ptr)))
 
+/**
+ * Publish a message with a key. On a coalescing topic (TRAIN_POSITION) a subscriber keeps only the newest
+ * undelivered message per key: an older one still queued is overwritten in place instead of queueing another.
+ * Subscribers that subscribed with a key only get the messages published with that key.
+ * @param event_type The type of event to publish
+ * @param key What the message is the latest value of, e.g. the train id; below MARKLIN_MSGQUEUE_NO_KEY
+ * @param data Pointer to the data to publish
+ * @param data_size Size of the data in bytes
+ * @return MARKLIN_ERROR_OK on success, error code otherwise
+ */
+marklin_error_t Marklin_MsgQueue_PublishKeyed(marklin_msgqueue_event_type_t event_type, u16 key, const void *data,
+					      u32 data_size);
+
+/**
+ * Publish a typed message with a key (convenience macro)
+ * @param event_type The type of event to publish
+ * @param key What the message is the latest value of
+ * @param data_ptr Pointer to the typed data
+ */
+#define Marklin_MsgQueue_PublishKeyedTyped(event_type, key, data_ptr) \
+	Marklin_MsgQueue_PublishKeyed(event_type, key, data_ptr, sizeof(*(data_ptr)))
+
 // Subscriber API
 
 /**
@@ -67,6 +96,17 @@ marklin_error_t Marklin_MsgQueue_Publish(marklin_msgqueue_event_type_t event_typ
 marklin_error_t Marklin_MsgQueue_Subscribe(marklin_msgqueue_event_type_t event_type,
 					   marklin_msgqueue_subscription_t *subscription);
 
+/**
+ * Subscribe to the messages of an event type published with one key, e.g. the sensor triggers attributed to
+ * one train. Plain publishes and other keys are not delivered. Subscribing again changes the key.
+ * @param event_type The type of event to subscribe to
+ * @param key Key to filter on, below MARKLIN_MSGQUEUE_NO_KEY
+ * @param subscription Output parameter for the subscription handle
+ * @return MARKLIN_ERROR_OK on success, error code otherwise
+ */
+marklin_error_t Marklin_MsgQueue_SubscribeKeyed(marklin_msgqueue_event_type_t event_type, u16 key,
+						marklin_msgqueue_subscription_t *subscription);
+
 /**
  * Unsubscribe from messages of a specific event type
  * @param subscription The subscription handle to cancel
@@ -74,11 +114,20 @@ marklin_error_t Marklin_MsgQueue_Subscribe(marklin_msgqueue_event_type_t event_t
  */
 marklin_error_t Marklin_MsgQueue_Unsubscribe(const marklin_msgqueue_subscription_t *subscription);
 
+/**
+ * Read how many messages a subscription lost to coalescing and to a full queue or pool share since it was created
+ * @param subscription The subscription handle
+ * @param stats Output counters
+ * @return MARKLIN_ERROR_OK on success, error code otherwise
+ */
+marklin_error_t Marklin_MsgQueue_GetSubscriptionStats(const marklin_msgqueue_subscription_t *subscription,
+						      marklin_msgqueue_subscription_stats_t *stats);
+
 /**
  * Wait for and receive a message for subscribed events
  * @param message Output buffer for the received message
  * @param timeout_ticks Maximum time to wait for a message (0 for infinite)
- * @return MARKLIN_ERROR_OK on success, error code otherwise
+ * @return MARKLIN_ERROR_OK on success, MARKLIN_ERROR_TIMEOUT if nothing arrived in time, error code otherwise
  */
 marklin_error_t Marklin_MsgQueue_Receive(marklin_msgqueue_message_t *message, u32 timeout_ticks);
 
@@ -95,4 +144,55 @@ marklin_error_t Marklin_MsgQueue_ReceiveNonBlock(marklin_msgqueue_message_t *mes
  */
 int Marklin_MsgQueue_GetPendingCount(void);
 
+// Multiplexed wait
+
+typedef enum {
+	MARKLIN_MSGQUEUE_WAIT_MESSAGE, // A task sent to the waiter directly and must be replied to
+	MARKLIN_MSGQUEUE_WAIT_EVENT, // A message arrived for one of the waiter's subscriptions
+	MARKLIN_MSGQUEUE_WAIT_DEADLINE, // The deadline passed first
+} marklin_msgqueue_wait_source_t;
+
+typedef enum {
+	MARKLIN_MSGQUEUE_COURIER_STARTING, // Not heard from yet
+	MARKLIN_MSGQUEUE_COURIER_IDLE, // Blocked in Send, waiting for the next deadline
+	MARKLIN_MSGQUEUE_COURIER_WAITING, // Blocked in the message queue on the waiter's behalf
+} marklin_msgqueue_courier_state_t;
+
+typedef struct {
+	int courier_tid;
+	marklin_msgqueue_courier_state_t courier_state;
+	u32 armed_deadline_tick; // Deadline the waiting courier was given, 0 for none
+} marklin_msgqueue_waiter_t;
+
+/**
+ * Set up a multiplexed wait for the calling task. Creates a courier task at the caller's priority that
+ * receives the caller's subscribed messages and forwards them to it.
+ * @param waiter Waiter to initialise, used only by the calling task
+ * @return MARKLIN_ERROR_OK on success, error code otherwise
+ */
+marklin_error_t Marklin_MsgQueue_WaiterInit(marklin_msgqueue_waiter_t *waiter);
+
+/**
+ * Tear down a waiter before the calling task exits: kills its courier and drops the receive it was blocked in
+ * @param waiter Waiter set up by Marklin_MsgQueue_WaiterInit
+ * @return MARKLIN_ERROR_OK on success, error code otherwise
+ */
+marklin_error_t Marklin_MsgQueue_WaiterDestroy(marklin_msgqueue_waiter_t *waiter);
+
+/**
+ * Block until a task sends to the caller, a message arrives for one of its subscriptions or the deadline
+ * passes, whichever comes first. A deadline earlier than the one the courier is already waiting towards
+ * re-arms it.
+ * @param waiter Waiter set up by Marklin_MsgQueue_WaiterInit
+ * @param deadline_tick Clock tick to give up at, 0 to wait without a deadline
+ * @param sender_tid Output sender of a direct message
+ * @param msg Output buffer for a direct message
+ * @param msglen Size of msg; set to the full length of a direct message, which may exceed it
+ * @param event Output buffer for a subscribed message, also used to receive direct messages
+ * @return The marklin_msgqueue_wait_source_t that ended the wait, or a negative error code, including one the
+ *         courier's receive failed with
+ */
+int Marklin_MsgQueue_Wait(marklin_msgqueue_waiter_t *waiter, u32 deadline_tick, int *sender_tid, void *msg,
+			  int *msglen, marklin_msgqueue_message_t *event);
+
 #endif /* MARKLIN_MSGQUEUE_API_H */
@@ -1,12 +1,29 @@
 #ifndef MARKLIN_MSGQUEUE_H
 #define MARKLIN_MSGQUEUE_H
 
+#include <stddef.h>
 #include "types.h"
 #include "marklin/error.h"
 #include "marklin/msgqueue/api.h"
 
 #define MARKLIN_MSGQUEUE_SERVER_TASK_PRIORITY 4
 #define MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER 128
+// Published payloads are stored once, in a pool shared by all subscribers, in three size classes
+#define MARKLIN_MSGQUEUE_POOL_SMALL_DATA_SIZE 64
+#define MARKLIN_MSGQUEUE_POOL_SMALL_MESSAGES 512
+#define MARKLIN_MSGQUEUE_POOL_MEDIUM_DATA_SIZE 512
+#define MARKLIN_MSGQUEUE_POOL_MEDIUM_MESSAGES 64
+#define MARKLIN_MSGQUEUE_POOL_LARGE_MESSAGES 8
+#define MARKLIN_MSGQUEUE_POOL_CLASSES 3
+// One subscriber's queue may hold at most 1/SHARE of a class, so a slow subscriber drops its own messages
+// instead of draining the pool for everyone
+#define MARKLIN_MSGQUEUE_POOL_SUBSCRIBER_SHARE 4
+#define MARKLIN_MSGQUEUE_POOL_MESSAGES                                                \
+	(MARKLIN_MSGQUEUE_POOL_SMALL_MESSAGES + MARKLIN_MSGQUEUE_POOL_MEDIUM_MESSAGES + \
+	 MARKLIN_MSGQUEUE_POOL_LARGE_MESSAGES)
+#define MARKLIN_MSGQUEUE_RECEIVE_BATCH 8 // Max queued requests drained per ReceiveMany
+// Longest the timer task sleeps, bounding how late a deadline added while it sleeps can fire
+#define MARKLIN_MSGQUEUE_TIMER_MAX_SLEEP_TICKS 2
 
 typedef enum {
 	MARKLIN_MSGQUEUE_REQ_PUBLISH,
@@ -15,12 +32,17 @@ typedef enum {
 	MARKLIN_MSGQUEUE_REQ_RECEIVE,
 	MARKLIN_MSGQUEUE_REQ_RECEIVE_NONBLOCK,
 	MARKLIN_MSGQUEUE_REQ_GET_PENDING_COUNT,
+	MARKLIN_MSGQUEUE_REQ_TIMER, // From the server's own timer task
+	MARKLIN_MSGQUEUE_REQ_GET_STATS,
+	MARKLIN_MSGQUEUE_REQ_REARM, // Bring the deadline of a receive waiting on the sender's behalf forward
+	MARKLIN_MSGQUEUE_REQ_CANCEL_RECEIVE, // Drop a receive waiting on the sender's behalf, its courier is gone
 } marklin_msgqueue_request_type_t;
 
 typedef struct {
-	marklin_msgqueue_message_t message;
+	u16 message; // Index into the payload pool
+	u16 key; // Coalescing key, MARKLIN_MSGQUEUE_NO_KEY if none
 	u32 sequence_number;
-} marklin_msgqueue_internal_message_t;
+} marklin_msgqueue_queue_entry_t;
 
 typedef struct {
 	int tid;
@@ -28,9 +50,15 @@ typedef struct {
 	u32 subscription_id;
 	int is_active;
 	int pending_messages;
-	marklin_msgqueue_internal_message_t message_queue[MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER];
+	marklin_msgqueue_queue_entry_t message_queue[MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER];
 	int queue_head;
 	int queue_tail;
+	int next_in_topic; // Next subscriber to the same event type, -1 at the end
+	int next_for_task; // Next subscription of the same task, -1 at the end
+	u16 filter_key; // Only messages published with this key, MARKLIN_MSGQUEUE_NO_KEY for every message
+	u16 pool_records[MARKLIN_MSGQUEUE_POOL_CLASSES]; // Queued entries referring to each pool size class
+	u32 coalesced;
+	u32 dropped;
 } marklin_msgqueue_subscriber_info_t;
 
 typedef struct {
@@ -39,18 +67,28 @@ typedef struct {
 		struct {
 			marklin_msgqueue_event_type_t event_type;
 			u32 data_size;
+			u32 key;
 			u8 data[MARKLIN_MSGQUEUE_MAX_DATA_SIZE];
 		} publish;
 		struct {
 			marklin_msgqueue_event_type_t event_type;
+			u32 filter_key;
 		} subscribe;
 		struct {
 			marklin_msgqueue_event_type_t event_type;
 			u32 subscription_id;
 		} unsubscribe;
+		struct {
+			marklin_msgqueue_event_type_t event_type;
+			u32 subscription_id;
+		} stats;
 		struct {
 			u32 timeout_ticks;
+			int subscriber_tid; // Whose subscriptions to receive from, -1 for the sender's own
 		} receive;
+		struct {
+			u32 deadline_tick;
+		} rearm;
 	};
 } marklin_msgqueue_request_t;
 
@@ -66,9 +104,17 @@ typedef struct {
 		struct {
 			int pending_count;
 		} pending_count;
+		struct {
+			u32 wake_tick;
+		} timer;
+		marklin_msgqueue_subscription_stats_t stats;
 	};
 } marklin_msgqueue_reply_t;
 
+// Requests and replies go over IPC trimmed to the payload they carry
+#define MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE offsetof(marklin_msgqueue_request_t, publish.data)
+#define MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE offsetof(marklin_msgqueue_reply_t, receive.message.data)
+
 void marklin_msgqueue_server_task(void);
 
 #endif /* MARKLIN_MSGQUEUE_H */
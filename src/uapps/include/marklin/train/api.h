@@ -40,6 +40,7 @@ typedef struct {
 	train_status_t status;
 	const track_node *next_sensor_1;
 	const track_node *next_sensor_2;
+	u32 sequence; // Per-train report number, a gap means reports were coalesced or dropped
 } marklin_train_position_data_t;
 
 typedef enum {
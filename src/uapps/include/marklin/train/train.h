@@ -77,7 +77,7 @@ typedef struct {
 } kinematic_model_collection_t;
 
 #define MARKLIN_TRAIN_CMD_DELAY_MS 150
-#define MARKLIN_TRAIN_CMD_DELAY_TICKS (MARKLIN_TRAIN_CMD_DELAY_MS / 10)
+#define MARKLIN_TRAIN_CMD_DELAY_US (MARKLIN_TRAIN_CMD_DELAY_MS * 1000)
 #define MARKLIN_TRAIN_MAX_SPEED 14
 #define MARKLIN_REVERSE_CMD 15
 #define MARKLIN_HEADLIGHT_ON_CMD 16
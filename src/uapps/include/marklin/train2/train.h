@@ -46,13 +46,18 @@ typedef struct {
 } kinematic_model_collection_t;
 
 #define MARKLIN_TRAIN_CMD_DELAY_MS 150
-#define MARKLIN_TRAIN_CMD_DELAY_TICKS (MARKLIN_TRAIN_CMD_DELAY_MS / 10)
+#define MARKLIN_TRAIN_CMD_DELAY_US (MARKLIN_TRAIN_CMD_DELAY_MS * 1000)
 
 // Path retry constants for deadlock/blocking scenarios
 #define TRAIN_PATH_RETRY_INITIAL_DELAY_MS 1000   // 1 second initial delay
 #define TRAIN_PATH_RETRY_MAX_DELAY_MS 8000       // 8 second maximum delay
 #define TRAIN_PATH_RETRY_MAX_ATTEMPTS 5          // Maximum retry attempts before giving up
 #define TRAIN_PATH_RETRY_BACKOFF_MULTIPLIER 2    // Exponential backoff multiplier
+// Position reports are published only on change: a different sensor, speed, state or target, an offset at
+// least this far from the last report, or the last report being this old
+#define TRAIN_POSITION_REPORT_MIN_DELTA_MM 10
+#define TRAIN_POSITION_REPORT_MAX_STALE_TICKS 100
+
 #define MARKLIN_TRAIN_MAX_SPEED 14
 #define MARKLIN_REVERSE_CMD 15
 #define MARKLIN_HEADLIGHT_ON_CMD 16
@@ -246,11 +251,15 @@ struct train_task_data {
 	// Timing
 	u64 last_path_request_tick;
 	u64 last_position_report_tick;
+	marklin_train_position_data_t last_position_report;
+	u32 position_reports; // Published, also the sequence number of the last report
+	u32 position_reports_suppressed; // Skipped as unchanged since the last report
 	u64 last_path_continuation_tick;
 
 	// Sensor tracking
 	marklin_msgqueue_subscription_t sensor_subscription;
 	bool sensor_subscription_active;
+	marklin_msgqueue_waiter_t waiter; // Commands, sensor updates and the loop deadline
 	u64 last_sensor_trigger_tick;
 
 	// Path management state machine (now in state_machine context)
@@ -311,6 +320,9 @@ typedef struct train_task_data train_task_data_t;
 
 void marklin_train_task(void);
 
+bool train_position_report_due(const marklin_train_position_data_t *last, const marklin_train_position_data_t *position,
+			       u64 last_tick, u64 now_tick);
+
 // Train movement control
 marklin_error_t train_set_speed(train_task_data_t *data, u8 speed);
 marklin_error_t train_set_headlight(train_task_data_t *data, marklin_train_headlight_t headlight);
@@ -7,7 +7,8 @@
 #define TUI_PANEL_STATUS 0
 #define TUI_PANEL_TRACK 1
 #define TUI_PANEL_INPUT 2
-#define TUI_PANEL_COUNT 3
+#define TUI_PANEL_TOP 3
+#define TUI_PANEL_COUNT 4
 
 #define TUI_SCREEN_WIDTH 130
 #define TUI_SCREEN_HEIGHT 50
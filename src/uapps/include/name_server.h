@@ -2,9 +2,7 @@
 #define __UAPPS_NAME_SERVER_H__
 
 #include "name.h"
-#include "params.h"
-
-#define MAX_REGISTRATIONS MAX_TASKS
+#define MAX_REGISTRATIONS 64 // Registered names, not tasks; keeps WhoIs scans short
 #define NAME_SERVER_PRIORITY 5
 
 void name_task();
@@ -0,0 +1,46 @@
+#ifndef __UAPPS_PERF_H__
+#define __UAPPS_PERF_H__
+
+#include "types.h"
+#include "srr_perf.h"
+
+// Runs above the servers so a test can set up all of its tasks before any of them run
+#define PERF_TASK_PRIORITY 3
+
+// Perf test selected with -DPERF_TEST=<name> ("ALL" runs every test in order)
+#ifndef PERF_TEST
+#define PERF_TEST "ALL"
+#endif
+
+// KLOG_LEVEL from the CMake cache, reported by tests whose cost depends on kernel tracing
+#ifndef PERF_KLOG_LEVEL
+#define PERF_KLOG_LEVEL "AUTO"
+#endif
+
+void perf_main(void);
+
+// Start the Marklin message queue server once, shared by all msgqueue tests
+void perf_start_msgqueue_server(void);
+
+// Start the Marklin topology server once, shared by the tests that load a track
+void perf_start_topology_server(void);
+
+void msgqueue_fanin_perf_main(void);
+void msgqueue_publish_perf_main(void);
+void msgqueue_fanout_perf_main(void);
+void msgqueue_topics_perf_main(void);
+void msgqueue_idle_perf_main(void);
+void msgqueue_coalesce_perf_main(void);
+void train_wait_perf_main(void);
+void sensor_routing_perf_main(void);
+void train_position_delta_perf_main(void);
+void next_sensor_perf_main(void);
+void task_teardown_perf_main(void);
+void task_churn_perf_main(void);
+void ctx_switch_perf_main(void);
+void profile_perf_main(void);
+void tick_drift_perf_main(void);
+void idle_rate_perf_main(void);
+void irq_nesting_perf_main(void);
+
+#endif /* __UAPPS_PERF_H__ */
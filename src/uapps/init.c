@@ -11,6 +11,9 @@
 #include "io_server.h"
 #include "io_test.h"
 #include "klog.h"
+#ifdef PERF_TEST
+#include "perf.h"
+#endif
 
 #define LOG_MODULE "INIT"
 #define LOG_LEVEL LOG_LEVEL_INFO
@@ -28,15 +31,19 @@ int __noreturn __attribute__((section(".text.entry"))) main()
 {
 	init_bss();
 
-	Create(MAX_PRIORITIES - 1, idle_task_main);
+	CreateWithStack(MAX_PRIORITIES - 1, idle_task_main, TASK_SMALL_STACK_SIZE);
 
-	Create(NAME_SERVER_PRIORITY, name_task);
+	CreateWithStack(NAME_SERVER_PRIORITY, name_task, TASK_SMALL_STACK_SIZE);
 
 	Create(IO_SERVER_PRIORITY, io_server_task);
 
-	Create(CLOCK_SERVER_PRIORITY, clock_server_main);
+	CreateWithStack(CLOCK_SERVER_PRIORITY, clock_server_main, TASK_SMALL_STACK_SIZE);
 
+#ifdef PERF_TEST
+	Create(PERF_TASK_PRIORITY, perf_main);
+#else
 	Create(MARKLIN_CONTROLLER_PRIORITY, marklin_controller_task);
+#endif
 
 	// Create(10, io_test_task);
 
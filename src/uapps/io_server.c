@@ -445,8 +445,8 @@ void io_server_task(void)
 
 	RegisterAs(IO_SERVER_NAME);
 
-	Create(IO_SERVER_PRIORITY - 1, io_rx_notifier_task);
-	Create(IO_SERVER_PRIORITY - 1, io_tx_notifier_task);
+	CreateWithStack(IO_SERVER_PRIORITY - 1, io_rx_notifier_task, TASK_SMALL_STACK_SIZE);
+	CreateWithStack(IO_SERVER_PRIORITY - 1, io_tx_notifier_task, TASK_SMALL_STACK_SIZE);
 
 	klog_info("IO Server started");
 
@@ -510,7 +510,7 @@ void io_server_task(void)
 void io_rx_notifier_task(void)
 {
 	int io_tid = WhoIs(IO_SERVER_NAME);
-	io_request_t request;
+	io_notify_request_t request;
 	io_reply_t reply;
 
 	klog_info("IO RX Notifier task started");
@@ -532,7 +532,7 @@ void io_rx_notifier_task(void)
 void io_tx_notifier_task(void)
 {
 	int io_tid = WhoIs(IO_SERVER_NAME);
-	io_request_t request;
+	io_notify_request_t request;
 	io_reply_t reply;
 
 	klog_info("IO TX Notifier task started");
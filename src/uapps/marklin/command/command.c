@@ -17,7 +17,7 @@
 // #########################################################
 int cmd_server_tid = -1;
 
-marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks)
+marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us)
 {
 	if (cmd_server_tid < 0) {
 		cmd_server_tid = WhoIs(MARKLIN_CMD_SERVER_NAME);
@@ -33,7 +33,7 @@ marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 para
 	request.schedule_cmd.cmd_type = type;
 	request.schedule_cmd.cmd = cmd;
 	request.schedule_cmd.param = param;
-	request.schedule_cmd.gap_ticks = gap_ticks;
+	request.schedule_cmd.gap_us = gap_us;
 	request.schedule_cmd.priority = MARKLIN_CMD_PRIORITY_MEDIUM;
 	request.schedule_cmd.train_id = 0;
 	request.schedule_cmd.is_blocking = 0;
@@ -47,7 +47,7 @@ marklin_error_t Marklin_ScheduleCommand(marklin_cmd_type_t type, u8 cmd, u8 para
 	return reply.error;
 }
 
-marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks)
+marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us)
 {
 	if (cmd == 0) {
 		return MARKLIN_ERROR_INVALID_ARGUMENT;
@@ -67,7 +67,7 @@ marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd,
 	request.schedule_cmd.cmd_type = type;
 	request.schedule_cmd.cmd = cmd;
 	request.schedule_cmd.param = param;
-	request.schedule_cmd.gap_ticks = gap_ticks;
+	request.schedule_cmd.gap_us = gap_us;
 	request.schedule_cmd.priority = MARKLIN_CMD_PRIORITY_MEDIUM; // Default priority
 	request.schedule_cmd.train_id = 0; // Unknown train
 	request.schedule_cmd.is_blocking = 1;
@@ -81,7 +81,7 @@ marklin_error_t Marklin_ScheduleCommandBlocking(marklin_cmd_type_t type, u8 cmd,
 	return reply.error;
 }
 
-marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks,
+marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us,
 						    marklin_cmd_priority_t priority, u8 train_id)
 {
 	if (cmd_server_tid < 0) {
@@ -98,7 +98,7 @@ marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8
 	request.schedule_cmd.cmd_type = type;
 	request.schedule_cmd.cmd = cmd;
 	request.schedule_cmd.param = param;
-	request.schedule_cmd.gap_ticks = gap_ticks;
+	request.schedule_cmd.gap_us = gap_us;
 	request.schedule_cmd.priority = priority;
 	request.schedule_cmd.train_id = train_id;
 	request.schedule_cmd.is_blocking = 0;
@@ -112,7 +112,7 @@ marklin_error_t Marklin_ScheduleCommandWithPriority(marklin_cmd_type_t type, u8
 	return reply.error;
 }
 
-marklin_error_t Marklin_ScheduleCommandBlockingWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_ticks,
+marklin_error_t Marklin_ScheduleCommandBlockingWithPriority(marklin_cmd_type_t type, u8 cmd, u8 param, i32 gap_us,
 							    marklin_cmd_priority_t priority, u8 train_id)
 {
 	if (cmd == 0) {
@@ -133,7 +133,7 @@ marklin_error_t Marklin_ScheduleCommandBlockingWithPriority(marklin_cmd_type_t t
 	request.schedule_cmd.cmd_type = type;
 	request.schedule_cmd.cmd = cmd;
 	request.schedule_cmd.param = param;
-	request.schedule_cmd.gap_ticks = gap_ticks;
+	request.schedule_cmd.gap_us = gap_us;
 	request.schedule_cmd.priority = priority;
 	request.schedule_cmd.train_id = train_id;
 	request.schedule_cmd.is_blocking = 1;
@@ -162,7 +162,7 @@ marklin_error_t Marklin_ScheduleEmergencyStop(u8 train_id)
 #include "log.h"
 
 #define MAX_QUEUED_COMMANDS 128
-#define DEFAULT_GAP_TICKS 1 // Default gap between commands 20ms
+#define DEFAULT_GAP_US 10000 // Gap after a command that does not ask for one
 
 // Command comparison function for priority queue (min-heap)
 // Returns: <0 if a has higher priority than b, >0 if b has higher priority than a, 0 if equal
@@ -274,19 +274,51 @@ static void marklin_send_command_to_uart(const marklin_cmd_t *cmd)
 	}
 }
 
+// The timer task while it is parked on an empty queue, -1 while it waits out a gap
+static int parked_timer_tid = -1;
+
+// Write the next queued command and send the timer task off to wait out its gap
+static void cmd_send_next(int timer_tid)
+{
+	marklin_cmd_t cmd;
+	marklin_cmd_reply_t reply;
+
+	reply.error = MARKLIN_ERROR_OK;
+	reply.timer.next_delay_us = DEFAULT_GAP_US;
+
+	if (cmd_queue_dequeue(&cmd) == MARKLIN_ERROR_OK) {
+		marklin_send_command_to_uart(&cmd);
+		if (cmd.gap_us > 0) {
+			reply.timer.next_delay_us = cmd.gap_us;
+		}
+	}
+
+	Reply(timer_tid, (const char *)&reply, sizeof(reply));
+}
+
+// A command was queued: a parked timer task has no gap left to wait out, so it goes out right away
+static void cmd_wake_timer(void)
+{
+	if (parked_timer_tid >= 0) {
+		int timer_tid = parked_timer_tid;
+		parked_timer_tid = -1;
+		cmd_send_next(timer_tid);
+	}
+}
+
 void __noreturn marklin_cmd_server_task(void)
 {
 	int sender_tid;
 	marklin_cmd_request_t request;
 	marklin_cmd_reply_t reply;
-	marklin_cmd_t current_cmd;
 
 	cmd_queue_init();
 
 	RegisterAs(MARKLIN_CMD_SERVER_NAME);
 
 	cmd_server_tid = MyTid();
-	timer_task_tid = Create(MARKLIN_CMD_TIMER_TASK_PRIORITY, marklin_cmd_timer_task);
+	timer_task_tid =
+		CreateWithStack(MARKLIN_CMD_TIMER_TASK_PRIORITY, marklin_cmd_timer_task, TASK_SMALL_STACK_SIZE);
 
 	klog_info("Command server task started");
 
@@ -303,6 +335,9 @@ void __noreturn marklin_cmd_server_task(void)
 		case MARKLIN_CMD_REQ_SCHEDULE:
 			reply.error = cmd_queue_enqueue(&request.schedule_cmd);
 			Reply(sender_tid, (const char *)&reply, sizeof(reply));
+			if (reply.error == MARKLIN_ERROR_OK) {
+				cmd_wake_timer();
+			}
 			break;
 
 		case MARKLIN_CMD_REQ_SCHEDULE_BLOCKING:
@@ -311,28 +346,18 @@ void __noreturn marklin_cmd_server_task(void)
 
 			if (reply.error != MARKLIN_ERROR_OK) {
 				Reply(sender_tid, (const char *)&reply, sizeof(reply));
+			} else {
+				cmd_wake_timer();
 			}
 			break;
 
 		case MARKLIN_CMD_REQ_TIMER_READY:
-			if (!cmd_queue_is_empty()) {
-				marklin_error_t queue_result = cmd_queue_dequeue(&current_cmd);
-
-				if (queue_result == MARKLIN_ERROR_OK) {
-					marklin_send_command_to_uart(&current_cmd);
-					if (current_cmd.gap_ticks <= 0) {
-						reply.timer.next_delay_ticks = DEFAULT_GAP_TICKS;
-					} else {
-						reply.timer.next_delay_ticks = current_cmd.gap_ticks;
-					}
-				} else {
-					reply.timer.next_delay_ticks = DEFAULT_GAP_TICKS;
-				}
+			// Nothing to send: leave the timer task blocked until a command is queued instead of polling
+			if (cmd_queue_is_empty()) {
+				parked_timer_tid = sender_tid;
 			} else {
-				reply.timer.next_delay_ticks = DEFAULT_GAP_TICKS;
+				cmd_send_next(sender_tid);
 			}
-
-			Reply(sender_tid, (const char *)&reply, sizeof(reply));
 			break;
 
 		default:
@@ -345,30 +370,49 @@ void __noreturn marklin_cmd_server_task(void)
 	UNREACHABLE();
 }
 
+// Commands between pacing reports
+#define CMD_PACING_REPORT_INTERVAL 1024
+
 void __noreturn marklin_cmd_timer_task(void)
 {
 	marklin_cmd_request_t request;
 	marklin_cmd_reply_t reply = { 0 };
-	i32 next_delay = DEFAULT_GAP_TICKS;
-	int clock_tid;
+	i32 next_delay_us = DEFAULT_GAP_US;
+	clock_time_t now;
+	u32 paced = 0;
+	u64 late_total_us = 0;
+	u32 late_max_us = 0;
 
 	RegisterAs(MARKLIN_CMD_TIMER_NAME);
 
 	cmd_server_tid = WhoIs(MARKLIN_CMD_SERVER_NAME);
 
-	clock_tid = WhoIs(CLOCK_SERVER_NAME);
-
 	request.type = MARKLIN_CMD_REQ_TIMER_READY;
 
 	for (;;) {
 		int result =
 			Send(cmd_server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
 		if (result >= 0 && reply.error == MARKLIN_ERROR_OK) {
-			next_delay = reply.timer.next_delay_ticks;
+			next_delay_us = reply.timer.next_delay_us;
 		} else {
-			next_delay = DEFAULT_GAP_TICKS;
+			next_delay_us = DEFAULT_GAP_US;
+		}
+
+		// Time the gap from the command just written rather than rounding it to clock ticks
+		GetClockTime(&now);
+		int late_us = DelayUntilUs(now.time_us + (u64)next_delay_us);
+
+		late_total_us += late_us;
+		if ((u32)late_us > late_max_us) {
+			late_max_us = late_us;
+		}
+		if (++paced == CMD_PACING_REPORT_INTERVAL) {
+			log_info("Command pacing: %u gaps, mean %u us late, max %u us late", paced,
+				 (u32)(late_total_us / paced), late_max_us);
+			paced = 0;
+			late_total_us = 0;
+			late_max_us = 0;
 		}
-		Delay(clock_tid, next_delay);
 	}
 
 	UNREACHABLE();
@@ -424,6 +424,13 @@ marklin_error_t Marklin_GetNextSensors(const track_node *current_location, train
 
 marklin_error_t Marklin_GetNextTwoSensors(const track_node *current_location, train_direction_t direction,
 					  const track_node **sensors, kinematic_distance_t *distances, u8 *count)
+{
+	return Marklin_ExpectNextTwoSensors(0, current_location, direction, sensors, distances, count);
+}
+
+marklin_error_t Marklin_ExpectNextTwoSensors(u8 train_id, const track_node *current_location,
+					     train_direction_t direction, const track_node **sensors,
+					     kinematic_distance_t *distances, u8 *count)
 {
 	if (!current_location || !sensors || !distances || !count) {
 		return MARKLIN_ERROR_INVALID_ARGUMENT;
@@ -443,6 +450,35 @@ marklin_error_t Marklin_GetNextTwoSensors(const track_node *current_location, tr
 	request.get_next_two_sensors.sensors = sensors;
 	request.get_next_two_sensors.distances = distances;
 	request.get_next_two_sensors.count = count;
+	request.get_next_two_sensors.train_id = train_id;
+
+	int result = Send(conductor_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+
+	if (result < 0) {
+		return MARKLIN_ERROR_COMMUNICATION;
+	}
+
+	return reply.error;
+}
+
+marklin_error_t Marklin_ClearExpectedSensors(u8 train_id)
+{
+	if (train_id == 0) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	int conductor_tid = WhoIs(MARKLIN_CONDUCTOR_SERVER_NAME);
+	if (conductor_tid < 0) {
+		return MARKLIN_ERROR_NOT_FOUND;
+	}
+
+	marklin_conductor_request_t request;
+	marklin_conductor_reply_t reply;
+
+	// No location: nothing to calculate, only the expectation is dropped
+	request.type = MARKLIN_CONDUCTOR_REQ_GET_NEXT_TWO_SENSORS;
+	request.get_next_two_sensors.current_location = NULL;
+	request.get_next_two_sensors.train_id = train_id;
 
 	int result = Send(conductor_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
 
@@ -666,8 +702,6 @@ static marklin_error_t conductor_calculate_next_two_sensors(const track_node *cu
 							    train_direction_t direction, const track_node **sensors,
 							    kinematic_distance_t *distances, u8 *count);
 
-static const track_node *conductor_find_next_sensor_on_edge(const track_node *start_node);
-
 // Track distance calculation
 static marklin_error_t conductor_calculate_track_distance(const track_node *from, const track_node *to, u8 train_id,
 							  kinematic_distance_t *raw_distance,
@@ -700,6 +734,7 @@ void conductor_init_sensor_lookup(conductor_task_data_t *data)
 {
 	// Clear the lookup table
 	memset(data->sensor_lookup, 0, sizeof(data->sensor_lookup));
+	memset(data->sensor_expectations, 0, sizeof(data->sensor_expectations));
 	data->sensor_count = 0;
 
 	// Iterate through all track nodes and collect sensors
@@ -788,6 +823,7 @@ static void conductor_init_task_data(conductor_task_data_t *data)
 
 	conductor_init_sensor_lookup(data);
 	conductor_init_switch_lookup(data);
+	next_sensor_table_init(&data->next_sensors, data->track_nodes, data->track_size);
 
 	conductor_init_blocks(data);
 
@@ -807,42 +843,6 @@ static void conductor_init_task_data(conductor_task_data_t *data)
 // # Next Sensor Calculation
 // ############################################################################
 
-static const track_node *conductor_find_next_sensor_on_edge(const track_node *start_node)
-{
-	if (!start_node) {
-		return NULL;
-	}
-
-	const track_node *next_node = start_node;
-	int max_hops = 50;
-
-	while (next_node && max_hops-- > 0) {
-		if (next_node->type == NODE_SENSOR && next_node != start_node) {
-			return next_node;
-		}
-
-		switch (next_node->type) {
-		case NODE_BRANCH: {
-			switch_lookup_entry_t *switch_entry = conductor_get_switch_lookup_entry(next_node->num);
-			if (!switch_entry) {
-				Panic("Switch: Switch lookup entry returns NULL for switch %d", next_node->num);
-			}
-			track_direction switch_dir = switch_entry->state.direction;
-			log_info("Find next sensor from %s: Next node: %s, following switch %d, direction: %d",
-				 start_node->name, next_node->name, next_node->num, switch_dir);
-			next_node = next_node->edge[switch_dir].dest;
-			break;
-		}
-		case NODE_SENSOR:
-		default:
-			next_node = next_node->edge[DIR_AHEAD].dest;
-			break;
-		}
-	}
-
-	return NULL;
-}
-
 static marklin_error_t conductor_calculate_next_sensors(const track_node *current_location, train_direction_t direction,
 							const track_node **expected_sensor,
 							kinematic_distance_t *expected_distance)
@@ -862,13 +862,11 @@ static marklin_error_t conductor_calculate_next_sensors(const track_node *curren
 		return MARKLIN_ERROR_INVALID_ARGUMENT;
 	}
 
-	const track_node *next_sensor = conductor_find_next_sensor_on_edge(current_node);
-
-	if (next_sensor) {
-		*expected_sensor = next_sensor;
-		kinematic_distance_t dummy_effective_distance;
-		conductor_calculate_track_distance(current_node, next_sensor, 0, expected_distance,
-						   &dummy_effective_distance);
+	const track_node *sensors[2];
+	kinematic_distance_t distances[2];
+	if (next_sensor_table_lookup(&g_conductor_data->next_sensors, current_node, sensors, distances) > 0) {
+		*expected_sensor = sensors[0];
+		*expected_distance = distances[0];
 	}
 
 	return MARKLIN_ERROR_OK;
@@ -897,25 +895,8 @@ static marklin_error_t conductor_calculate_next_two_sensors(const track_node *cu
 		return MARKLIN_ERROR_INVALID_ARGUMENT;
 	}
 
-	// Find first sensor
-	const track_node *first_sensor = conductor_find_next_sensor_on_edge(current_node);
-	if (!first_sensor) {
-		return MARKLIN_ERROR_OK; // No sensors found, count stays 0
-	}
-
-	sensors[0] = first_sensor;
-	kinematic_distance_t dummy_effective_distance;
-	conductor_calculate_track_distance(current_node, first_sensor, 0, &distances[0], &dummy_effective_distance);
-	*count = 1;
-
-	// Find second sensor by continuing from the first sensor
-	const track_node *second_sensor = conductor_find_next_sensor_on_edge(first_sensor);
-	if (second_sensor) {
-		sensors[1] = second_sensor;
-		conductor_calculate_track_distance(current_node, second_sensor, 0, &distances[1],
-						   &dummy_effective_distance);
-		*count = 2;
-	}
+	// Precomputed for the current switch directions, the second sensor is the first one's next
+	*count = next_sensor_table_lookup(&g_conductor_data->next_sensors, current_node, sensors, distances);
 
 	return MARKLIN_ERROR_OK;
 }
@@ -1617,7 +1598,7 @@ void __noreturn marklin_conductor_task(void)
 		Panic("Command server not found");
 	}
 
-	Create(MARKLIN_SENSOR_TASK_PRIORITY, sensor_timer_task);
+	CreateWithStack(MARKLIN_SENSOR_TASK_PRIORITY, sensor_timer_task, TASK_SMALL_STACK_SIZE);
 
 	conductor_main_loop(&conductor_data);
 
@@ -1744,11 +1725,23 @@ static void conductor_process_request(conductor_task_data_t *data, int sender_ti
 		break;
 	}
 	case MARKLIN_CONDUCTOR_REQ_GET_NEXT_TWO_SENSORS: {
+		u8 train_id = request->get_next_two_sensors.train_id;
+
+		if (!request->get_next_two_sensors.current_location && train_id) {
+			sensor_set_expected(train_id, NULL, 0);
+			reply.error = MARKLIN_ERROR_OK;
+			break;
+		}
+
 		reply.error = conductor_calculate_next_two_sensors(request->get_next_two_sensors.current_location,
 								   request->get_next_two_sensors.direction,
 								   request->get_next_two_sensors.sensors,
 								   request->get_next_two_sensors.distances,
 								   request->get_next_two_sensors.count);
+		if (train_id) {
+			sensor_set_expected(train_id, request->get_next_two_sensors.sensors,
+					    reply.error == MARKLIN_ERROR_OK ? *request->get_next_two_sensors.count : 0);
+		}
 		break;
 	}
 	case MARKLIN_CONDUCTOR_REQ_CALCULATE_DISTANCE: {
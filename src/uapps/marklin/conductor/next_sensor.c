@@ -0,0 +1,150 @@
+#include "marklin/conductor/next_sensor.h"
+#include "string.h"
+
+static inline int next_sensor_index(const next_sensor_table_t *table, const track_node *node)
+{
+	return (int)(node - table->track_nodes);
+}
+
+static inline bool next_sensor_on_track(const next_sensor_table_t *table, const track_node *node)
+{
+	return node && node >= table->track_nodes && node < table->track_nodes + table->track_size;
+}
+
+// Walk ahead to the first sensor other than the starting node
+static void next_sensor_compute(next_sensor_table_t *table, int index)
+{
+	const track_node *start = &table->track_nodes[index];
+	const track_node *node = start;
+	next_sensor_entry_t *entry = &table->entries[index];
+	kinematic_distance_t distance = 0;
+
+	entry->sensor = NULL;
+	entry->distance = 0;
+
+	for (int hops = 0; node && hops < NEXT_SENSOR_MAX_HOPS; hops++) {
+		if (node->type == NODE_SENSOR && node != start) {
+			entry->sensor = node;
+			entry->distance = distance;
+			return;
+		}
+
+		track_direction dir = DIR_AHEAD;
+		if (node->type == NODE_BRANCH) {
+			dir = table->branch_directions[next_sensor_index(table, node)];
+		}
+
+		distance += node->edge[dir].dist;
+		node = node->edge[dir].dest;
+	}
+}
+
+void next_sensor_table_init(next_sensor_table_t *table, const track_node *track_nodes, int track_size)
+{
+	memset(table, 0, sizeof(*table));
+	table->track_nodes = track_nodes;
+	table->track_size = track_size < TRACK_MAX ? track_size : TRACK_MAX;
+
+	for (int i = 0; i < table->track_size; i++) {
+		table->branch_directions[i] = DIR_STRAIGHT;
+	}
+
+	next_sensor_table_rebuild(table);
+}
+
+void next_sensor_table_rebuild(next_sensor_table_t *table)
+{
+	for (int i = 0; i < table->track_size; i++) {
+		next_sensor_compute(table, i);
+	}
+}
+
+int next_sensor_table_set_switch(next_sensor_table_t *table, const track_node *branch, track_direction direction)
+{
+	if (!next_sensor_on_track(table, branch) || branch->type != NODE_BRANCH) {
+		return 0;
+	}
+
+	int index = next_sensor_index(table, branch);
+	if (table->branch_directions[index] == direction) {
+		return 0;
+	}
+	table->branch_directions[index] = direction;
+
+	u16 generation = ++table->visit_generation;
+	if (generation == 0) {
+		memset(table->visit_marks, 0, sizeof(table->visit_marks));
+		generation = table->visit_generation = 1;
+	}
+
+	// Walk backwards from the branch over every edge: those are the nodes whose walk can reach it. A sensor
+	// ends the walks of the nodes behind it, so the search stops there. The nodes leading into a node are
+	// the reverses of the nodes following its reverse.
+	const track_node *stack[TRACK_MAX];
+	int depth = 0;
+	int recomputed = 0;
+
+	stack[depth++] = branch;
+	table->visit_marks[index] = generation;
+
+	while (depth > 0) {
+		const track_node *node = stack[--depth];
+
+		next_sensor_compute(table, next_sensor_index(table, node));
+		recomputed++;
+
+		if (node->type == NODE_SENSOR || !node->reverse) {
+			continue;
+		}
+
+		const track_node *reverse = node->reverse;
+		int edges = reverse->type == NODE_BRANCH ? 2 : 1;
+		for (int e = 0; e < edges; e++) {
+			const track_node *ahead = reverse->edge[e].dest;
+			if (!ahead || !next_sensor_on_track(table, ahead->reverse)) {
+				continue;
+			}
+
+			const track_node *behind = ahead->reverse;
+			int behind_index = next_sensor_index(table, behind);
+			if (table->visit_marks[behind_index] == generation) {
+				continue;
+			}
+
+			table->visit_marks[behind_index] = generation;
+			stack[depth++] = behind;
+		}
+	}
+
+	return recomputed;
+}
+
+u8 next_sensor_table_lookup(const next_sensor_table_t *table, const track_node *node, const track_node **sensors,
+			    kinematic_distance_t *distances)
+{
+	sensors[0] = NULL;
+	sensors[1] = NULL;
+	distances[0] = 0;
+	distances[1] = 0;
+
+	if (!next_sensor_on_track(table, node)) {
+		return 0;
+	}
+
+	const next_sensor_entry_t *first = &table->entries[next_sensor_index(table, node)];
+	if (!first->sensor) {
+		return 0;
+	}
+
+	sensors[0] = first->sensor;
+	distances[0] = first->distance;
+
+	const next_sensor_entry_t *second = &table->entries[next_sensor_index(table, first->sensor)];
+	if (!second->sensor) {
+		return 1;
+	}
+
+	sensors[1] = second->sensor;
+	distances[1] = first->distance + second->distance;
+	return 2;
+}
@@ -29,6 +29,8 @@ static u8 sensor_reverse_bits(u8 byte);
 static sensor_lookup_entry_t *sensor_get_lookup_entry(u8 bank, u8 sensor_id);
 static void sensor_publish_update(sensor_lookup_entry_t *entry, u8 sensor_triggered);
 static bool sensor_is_blacklisted(u8 bank, u8 sensor_id);
+static bool sensor_train_holds_block(u8 train_id, const track_node *sensor_node);
+static u8 sensor_attribute_trigger(const track_node *sensor_node);
 
 // Sensor timer task helpers
 static void sensor_consume_response(int conductor_tid);
@@ -71,6 +73,65 @@ static sensor_lookup_entry_t *sensor_get_lookup_entry(u8 bank, u8 sensor_id)
 	return NULL;
 }
 
+static bool sensor_train_holds_block(u8 train_id, const track_node *sensor_node)
+{
+	for (int i = 0; i < g_conductor_data->track_block_count; i++) {
+		track_block_t *block = &g_conductor_data->track_blocks[i];
+		if (block->owner_train_id != train_id) {
+			continue;
+		}
+
+		if (conductor_is_boundary_sensor(sensor_node, block)) {
+			return true;
+		}
+
+		for (u32 j = 0; j < block->internal_sensor_count; j++) {
+			if (block->internal_sensors[j] == sensor_node) {
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+// The train expecting this sensor next, 0 if none does. When several do, prefer one holding a block the
+// sensor bounds or lies in, then one expecting it as its very next sensor.
+static u8 sensor_attribute_trigger(const track_node *sensor_node)
+{
+	u8 candidates[MAX_SENSOR_EXPECTATIONS];
+	u8 positions[MAX_SENSOR_EXPECTATIONS];
+	int candidate_count = 0;
+
+	for (int i = 0; i < MAX_SENSOR_EXPECTATIONS; i++) {
+		sensor_expectation_t *expectation = &g_conductor_data->sensor_expectations[i];
+		for (u8 j = 0; j < expectation->count; j++) {
+			if (expectation->sensors[j] == sensor_node) {
+				candidates[candidate_count] = expectation->train_id;
+				positions[candidate_count] = j;
+				candidate_count++;
+				break;
+			}
+		}
+	}
+
+	if (candidate_count <= 1) {
+		return candidate_count ? candidates[0] : 0;
+	}
+
+	u8 train_id = 0;
+	int best_score = -1;
+	for (int i = 0; i < candidate_count; i++) {
+		int score = (sensor_train_holds_block(candidates[i], sensor_node) ? 2 : 0) + (positions[i] == 0 ? 1 : 0);
+		if (score > best_score) {
+			best_score = score;
+			train_id = candidates[i];
+		}
+	}
+
+	return train_id;
+}
+
 static void sensor_publish_update(sensor_lookup_entry_t *entry, u8 sensor_triggered)
 {
 	marklin_sensor_state_t update_data = { .bank = entry->state.bank,
@@ -78,7 +139,17 @@ static void sensor_publish_update(sensor_lookup_entry_t *entry, u8 sensor_trigge
 					       .triggered = sensor_triggered,
 					       .last_triggered_tick = entry->state.last_triggered_tick };
 
-	Marklin_MsgQueue_PublishTyped(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &update_data);
+	// A trigger goes to the train expecting it. Releases and unattributed triggers only reach the subscribers
+	// that take every sensor update.
+	u16 key = MARKLIN_MSGQUEUE_NO_KEY;
+	if (sensor_triggered) {
+		u8 train_id = sensor_attribute_trigger(entry->sensor_node);
+		if (train_id) {
+			key = train_id;
+		}
+	}
+
+	Marklin_MsgQueue_PublishKeyedTyped(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, key, &update_data);
 }
 
 // ############################################################################
@@ -111,6 +182,39 @@ u32 sensor_get_states(marklin_sensor_state_t *sensors, u32 count)
 	return found_count;
 }
 
+void sensor_set_expected(u8 train_id, const track_node *const *sensors, u8 count)
+{
+	if (!g_conductor_data || train_id == 0) {
+		return;
+	}
+
+	sensor_expectation_t *slot = NULL;
+	for (int i = 0; i < MAX_SENSOR_EXPECTATIONS; i++) {
+		sensor_expectation_t *expectation = &g_conductor_data->sensor_expectations[i];
+		if (expectation->train_id == train_id) {
+			slot = expectation;
+			break;
+		}
+		if (!slot && expectation->train_id == 0) {
+			slot = expectation;
+		}
+	}
+
+	if (!slot) {
+		return;
+	}
+
+	if (count > 2) {
+		count = 2;
+	}
+
+	slot->train_id = count ? train_id : 0;
+	slot->count = count;
+	for (u8 i = 0; i < 2; i++) {
+		slot->sensors[i] = i < count ? sensors[i] : NULL;
+	}
+}
+
 void conductor_consume_sensor_data(u16 *sensor_data, u32 tick)
 {
 	if (!g_conductor_data)
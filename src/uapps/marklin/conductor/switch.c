@@ -50,6 +50,7 @@ void conductor_consume_switch_update(u8 switch_id, track_direction direction, u3
 
 	entry->state.direction = direction;
 	entry->state.last_changed_tick = tick;
+	next_sensor_table_set_switch(&g_conductor_data->next_sensors, entry->switch_node, direction);
 	switch_publish_update(entry);
 }
 
@@ -75,8 +76,8 @@ marklin_error_t switch_set_direction(u8 switch_id, track_direction direction, u8
 	// Schedule the switch command
 	marklin_error_t result = Marklin_ScheduleCommand(MARKLIN_CMD_TYPE_WITH_PARAM, cmd, switch_id,
 							 disengage_solenoid == 1 ?
-								 MS_TO_TICK(MARKLIN_SOLENOID_DEACTIVATE_MS) :
-								 MS_TO_TICK(MARKLIN_SWITCH_CMD_DELAY_MS));
+								 MARKLIN_SOLENOID_DEACTIVATE_MS * 1000 :
+								 MARKLIN_SWITCH_CMD_DELAY_MS * 1000);
 	if (result != MARKLIN_ERROR_OK) {
 		Panic("Switch: Failed to schedule switch command for switch %d", switch_id);
 		return result;
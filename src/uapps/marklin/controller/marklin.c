@@ -142,16 +142,31 @@ marklin_error_t Marklin_ControllerTrainCommand(u8 train_id, const marklin_train_
 }
 
 marklin_error_t Marklin_ControllerGetSystemSnapshot(marklin_system_snapshot_t *snapshot)
+{
+	if (!snapshot) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	memset(snapshot, 0, sizeof(*snapshot));
+	return Marklin_ControllerUpdateSystemSnapshot(snapshot);
+}
+
+marklin_error_t Marklin_ControllerUpdateSystemSnapshot(marklin_system_snapshot_t *snapshot)
 {
 	int server_tid = get_marklin_controller_tid();
 	if (server_tid <= 0) {
 		return MARKLIN_ERROR_NOT_FOUND;
 	}
 
+	if (!snapshot) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
 	marklin_request_t request;
 	marklin_reply_t reply;
 
 	request.type = MARKLIN_REQ_GET_SYSTEM_SNAPSHOT;
+	request.system_snapshot.since_version = snapshot->version;
 
 	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
 
@@ -159,11 +174,53 @@ marklin_error_t Marklin_ControllerGetSystemSnapshot(marklin_system_snapshot_t *s
 		return MARKLIN_ERROR_COMMUNICATION;
 	}
 
-	if (reply.error == MARKLIN_ERROR_OK) {
-		*snapshot = reply.system_snapshot;
+	if (reply.error != MARKLIN_ERROR_OK) {
+		return reply.error;
 	}
 
-	return reply.error;
+	const marklin_system_snapshot_delta_t *delta = &reply.snapshot_delta;
+	const marklin_train_snapshot_t *trains = (const marklin_train_snapshot_t *)delta->records;
+	const marklin_switch_snapshot_t *switches = (const marklin_switch_snapshot_t *)(trains + delta->train_count);
+
+	if (delta->full) {
+		snapshot->active_train_count = 0;
+		snapshot->active_switch_count = 0;
+	}
+
+	// Replace changed records in place, new ones go at the end as in the controller's lists
+	for (int i = 0; i < delta->train_count; i++) {
+		int slot = 0;
+		while (slot < snapshot->active_train_count && snapshot->trains[slot].train_id != trains[i].train_id) {
+			slot++;
+		}
+		if (slot == snapshot->active_train_count) {
+			if (slot >= MARKLIN_MAX_TRAINS_IN_SNAPSHOT) {
+				continue;
+			}
+			snapshot->active_train_count++;
+		}
+		snapshot->trains[slot] = trains[i];
+	}
+
+	for (int i = 0; i < delta->switch_count; i++) {
+		int slot = 0;
+		while (slot < snapshot->active_switch_count &&
+		       snapshot->switches[slot].switch_id != switches[i].switch_id) {
+			slot++;
+		}
+		if (slot == snapshot->active_switch_count) {
+			if (slot >= MARKLIN_MAX_SWITCHES_IN_SNAPSHOT) {
+				continue;
+			}
+			snapshot->active_switch_count++;
+		}
+		snapshot->switches[slot] = switches[i];
+	}
+
+	snapshot->version = delta->version;
+	snapshot->last_update_bytes = result;
+
+	return MARKLIN_ERROR_OK;
 }
 
 marklin_error_t Marklin_ControllerStopAllTrains(void)
@@ -294,7 +351,7 @@ static void __marklin_stop_all_possible_trains(void)
 		u8 cmd = 0 + 16;
 		u8 param = all_possible_trains[i];
 		Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, cmd, param,
-						    MARKLIN_TRAIN_CMD_DELAY_TICKS, MARKLIN_CMD_PRIORITY_MEDIUM, param);
+						    MARKLIN_TRAIN_CMD_DELAY_US, MARKLIN_CMD_PRIORITY_MEDIUM, param);
 	}
 }
 
@@ -319,7 +376,8 @@ void __marklin_init(marklin_track_type_t track_type)
 	log_info("Initializing track type %d", track_type);
 
 	// Create topology server for track initialization
-	Create(MARKLIN_TOPOLOGY_SERVER_TASK_PRIORITY, marklin_topology_server_task);
+	CreateWithStack(MARKLIN_TOPOLOGY_SERVER_TASK_PRIORITY, marklin_topology_server_task,
+			TASK_SMALL_STACK_SIZE);
 
 	Delay(clock_server_tid, 100); // Wait for topology server to be ready
 
@@ -398,6 +456,11 @@ static spawned_train_entry_t *__marklin_find_spawned_train_by_tid(int task_tid)
 	return NULL;
 }
 
+static u32 __marklin_next_snapshot_version(void)
+{
+	return ++marklin_system.snapshot_version;
+}
+
 static controller_switch_entry_t *__marklin_find_switch(u8 switch_id)
 {
 	struct dlist_node *node;
@@ -411,6 +474,14 @@ static controller_switch_entry_t *__marklin_find_switch(u8 switch_id)
 	return NULL;
 }
 
+// Every change to a tracked switch goes through here so delta snapshots see it
+static void __marklin_update_switch(controller_switch_entry_t *entry, track_direction direction, u64 tick)
+{
+	entry->direction = direction;
+	entry->last_changed_tick = tick;
+	entry->version = __marklin_next_snapshot_version();
+}
+
 static controller_switch_entry_t *__marklin_add_switch(u8 switch_id, track_direction direction, u64 tick)
 {
 	if (marklin_system.tracked_switch_count >= MARKLIN_MAX_SWITCHES_IN_SNAPSHOT) {
@@ -420,8 +491,7 @@ static controller_switch_entry_t *__marklin_add_switch(u8 switch_id, track_direc
 
 	controller_switch_entry_t *entry = &controller_switch_entries[marklin_system.tracked_switch_count];
 	entry->switch_id = switch_id;
-	entry->direction = direction;
-	entry->last_changed_tick = tick;
+	__marklin_update_switch(entry, direction, tick);
 
 	dlist_insert_tail(&marklin_system.tracked_switches, &entry->list);
 	marklin_system.tracked_switch_count++;
@@ -444,9 +514,9 @@ static void __marklin_process_switch_update(const marklin_msgqueue_message_t *me
 	if (!entry) {
 		entry = __marklin_add_switch(switch_update->switch_id, switch_update->direction,
 					     switch_update->last_changed_tick);
-	} else {
-		entry->direction = switch_update->direction;
-		entry->last_changed_tick = switch_update->last_changed_tick;
+	} else if (entry->direction != switch_update->direction ||
+		   entry->last_changed_tick != switch_update->last_changed_tick) {
+		__marklin_update_switch(entry, switch_update->direction, switch_update->last_changed_tick);
 		log_debug("Updated switch %d to direction %d", switch_update->switch_id, switch_update->direction);
 	}
 }
@@ -484,6 +554,13 @@ static void __marklin_process_position_update(const marklin_msgqueue_message_t *
 	entry->next_sensor_1 = position_update->next_sensor_1;
 	entry->next_sensor_2 = position_update->next_sensor_2;
 
+	// Position reports coalesce while the controller is behind, a gap just means it got the newest one
+	if (entry->position_sequence && position_update->sequence > entry->position_sequence + 1) {
+		entry->position_reports_missed += position_update->sequence - entry->position_sequence - 1;
+	}
+	entry->position_sequence = position_update->sequence;
+	entry->version = __marklin_next_snapshot_version();
+
 	log_debug("Controller: Updated train %d position to %p, speed %d, direction %d, headlight %d, destination %s",
 		  position_update->train_id, position_update->current_location, position_update->current_speed,
 		  position_update->direction, position_update->headlight,
@@ -518,6 +595,9 @@ marklin_error_t __marklin_spawn_train(u8 train_id, const track_node *init_locati
 	entry->location_offset_mm = 0;
 	entry->destination_offset_mm = 0;
 	entry->status = TRAIN_STATUS_IDLE;
+	entry->position_sequence = 0;
+	entry->position_reports_missed = 0;
+	entry->version = __marklin_next_snapshot_version();
 
 	dlist_insert_tail(&marklin_system.spawned_trains, &entry->list);
 	marklin_system.spawned_train_count++;
@@ -569,22 +649,35 @@ marklin_error_t __marklin_get_self_train_info(marklin_train_spawn_info_t *info,
 	return MARKLIN_ERROR_OK;
 }
 
-marklin_error_t __marklin_get_system_snapshot(marklin_system_snapshot_t *snapshot)
+// Fill delta with the records changed after since_version, or all of them if the caller's copy predates the
+// last reset. Returns the number of record bytes written.
+static u32 __marklin_get_system_snapshot(u32 since_version, marklin_system_snapshot_delta_t *delta)
 {
-	snapshot->active_train_count = 0;
-	snapshot->active_switch_count = 0;
+	delta->version = marklin_system.snapshot_version;
+	delta->full = since_version < marklin_system.snapshot_base_version ||
+		      since_version > marklin_system.snapshot_version;
+	delta->train_count = 0;
+	delta->switch_count = 0;
+
+	if (delta->full) {
+		since_version = 0;
+	}
 
 	// Populate train data
 	struct dlist_node *node;
-	memset(snapshot, 0, sizeof(marklin_system_snapshot_t));
+	marklin_train_snapshot_t *trains = (marklin_train_snapshot_t *)delta->records;
 	dlist_for_each(node, &marklin_system.spawned_trains)
 	{
-		if (snapshot->active_train_count >= MARKLIN_MAX_TRAINS_IN_SNAPSHOT) {
+		if (delta->train_count >= MARKLIN_MAX_TRAINS_IN_SNAPSHOT) {
 			break;
 		}
 
 		spawned_train_entry_t *entry = dlist_entry(node, spawned_train_entry_t, list);
-		marklin_train_snapshot_t *train_snapshot = &snapshot->trains[snapshot->active_train_count];
+		if (entry->version <= since_version) {
+			continue;
+		}
+
+		marklin_train_snapshot_t *train_snapshot = &trains[delta->train_count];
 
 		train_snapshot->train_id = entry->train_id;
 		train_snapshot->current_location = entry->current_location;
@@ -601,27 +694,36 @@ marklin_error_t __marklin_get_system_snapshot(marklin_system_snapshot_t *snapsho
 		train_snapshot->status = entry->status;
 		train_snapshot->next_sensor_1 = entry->next_sensor_1;
 		train_snapshot->next_sensor_2 = entry->next_sensor_2;
+		train_snapshot->position_reports_missed = entry->position_reports_missed;
+		train_snapshot->version = entry->version;
 
-		snapshot->active_train_count++;
+		delta->train_count++;
 	}
 
+	marklin_switch_snapshot_t *switches = (marklin_switch_snapshot_t *)(trains + delta->train_count);
 	dlist_for_each(node, &marklin_system.tracked_switches)
 	{
-		if (snapshot->active_switch_count >= MARKLIN_MAX_SWITCHES_IN_SNAPSHOT) {
+		if (delta->switch_count >= MARKLIN_MAX_SWITCHES_IN_SNAPSHOT) {
 			break;
 		}
 
 		controller_switch_entry_t *entry = dlist_entry(node, controller_switch_entry_t, list);
-		marklin_switch_snapshot_t *switch_snapshot = &snapshot->switches[snapshot->active_switch_count];
+		if (entry->version <= since_version) {
+			continue;
+		}
+
+		marklin_switch_snapshot_t *switch_snapshot = &switches[delta->switch_count];
 
 		switch_snapshot->switch_id = entry->switch_id;
 		switch_snapshot->direction = entry->direction;
 		switch_snapshot->last_changed_tick = entry->last_changed_tick;
+		switch_snapshot->version = entry->version;
 
-		snapshot->active_switch_count++;
+		delta->switch_count++;
 	}
 
-	return MARKLIN_ERROR_OK;
+	return delta->train_count * sizeof(marklin_train_snapshot_t) +
+	       delta->switch_count * sizeof(marklin_switch_snapshot_t);
 }
 
 marklin_error_t __marklin_send_train_command(u8 train_id, const marklin_train_command_t *command)
@@ -677,8 +779,7 @@ marklin_error_t __marklin_set_all_switches(track_direction direction)
 			log_error("Failed to set switch %d to direction %d", entry->switch_id, direction);
 			last_error = result;
 		} else {
-			entry->direction = direction;
-			entry->last_changed_tick = current_tick;
+			__marklin_update_switch(entry, direction, current_tick);
 		}
 	}
 
@@ -734,6 +835,9 @@ marklin_error_t __marklin_system_reset(marklin_track_type_t track_type)
 	log_info("Controller: Re-initializing system");
 	__marklin_init(track_type);
 
+	// Snapshots taken before the reset hold trains and switches that no longer exist
+	marklin_system.snapshot_base_version = __marklin_next_snapshot_version();
+
 	log_info("Controller: System reset completed");
 	return MARKLIN_ERROR_OK;
 }
@@ -741,6 +845,7 @@ marklin_error_t __marklin_system_reset(marklin_track_type_t track_type)
 static void __process_request(int sender_tid, marklin_request_t *request)
 {
 	marklin_reply_t reply;
+	int reply_size = sizeof(reply);
 	reply.error = MARKLIN_ERROR_OK;
 
 	switch (request->type) {
@@ -765,7 +870,10 @@ static void __process_request(int sender_tid, marklin_request_t *request)
 		break;
 
 	case MARKLIN_REQ_GET_SYSTEM_SNAPSHOT:
-		reply.error = __marklin_get_system_snapshot(&reply.system_snapshot);
+		// Only the changed records go back over IPC
+		reply_size = __marklin_get_system_snapshot(request->system_snapshot.since_version,
+							   &reply.snapshot_delta);
+		reply_size += offsetof(marklin_reply_t, snapshot_delta.records);
 		break;
 
 	case MARKLIN_REQ_STOP_ALL_TRAINS:
@@ -789,7 +897,7 @@ static void __process_request(int sender_tid, marklin_request_t *request)
 		break;
 	}
 
-	Reply(sender_tid, (const char *)&reply, sizeof(reply));
+	Reply(sender_tid, (const char *)&reply, reply_size);
 }
 
 void __marklin_process_msgqueue_message()
@@ -891,7 +999,7 @@ void marklin_controller_task(void)
 
 	// Create core server tasks that survive reset
 	Create(MARKLIN_MSGQUEUE_SERVER_TASK_PRIORITY, marklin_msgqueue_server_task);
-	Create(MARKLIN_CMD_SERVER_TASK_PRIORITY, marklin_cmd_server_task);
+	CreateWithStack(MARKLIN_CMD_SERVER_TASK_PRIORITY, marklin_cmd_server_task, TASK_SMALL_STACK_SIZE);
 
 	Create(MARKLIN_TUI_SERVER_TASK_PRIORITY, marklin_tui_server_task);
 	__marklin_system_reset(MARKLIN_TRACK_TYPE_A);
@@ -5,6 +5,8 @@
 #include "string.h"
 #include "compiler.h"
 #include "clock.h"
+#include "params.h"
+#include "dlist.h"
 
 #define LOG_MODULE "msgqueue"
 #define LOG_LEVEL LOG_LEVEL_ERROR
@@ -24,7 +26,21 @@ static inline int get_msgqueue_server_tid(void)
 	return msgqueue_server_tid;
 }
 
+// Only the header and data_size bytes of payload arrive in the reply
+static inline void copy_received_message(marklin_msgqueue_message_t *message, const marklin_msgqueue_reply_t *reply)
+{
+	message->event_type = reply->receive.message.event_type;
+	message->data_size = reply->receive.message.data_size;
+	memcpy(message->data, reply->receive.message.data, reply->receive.message.data_size);
+}
+
 marklin_error_t Marklin_MsgQueue_Publish(marklin_msgqueue_event_type_t event_type, const void *data, u32 data_size)
+{
+	return Marklin_MsgQueue_PublishKeyed(event_type, MARKLIN_MSGQUEUE_NO_KEY, data, data_size);
+}
+
+marklin_error_t Marklin_MsgQueue_PublishKeyed(marklin_msgqueue_event_type_t event_type, u16 key, const void *data,
+					      u32 data_size)
 {
 	int server_tid = get_msgqueue_server_tid();
 	if (server_tid < 0) {
@@ -41,10 +57,12 @@ marklin_error_t Marklin_MsgQueue_Publish(marklin_msgqueue_event_type_t event_typ
 	request.type = MARKLIN_MSGQUEUE_REQ_PUBLISH;
 	request.publish.event_type = event_type;
 	request.publish.data_size = data_size;
+	request.publish.key = key;
 
 	memcpy(request.publish.data, data, data_size);
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE + data_size,
+			  (char *)&reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
 
 	if (result < 0) {
 		return MARKLIN_ERROR_COMMUNICATION;
@@ -55,6 +73,12 @@ marklin_error_t Marklin_MsgQueue_Publish(marklin_msgqueue_event_type_t event_typ
 
 marklin_error_t Marklin_MsgQueue_Subscribe(marklin_msgqueue_event_type_t event_type,
 					   marklin_msgqueue_subscription_t *subscription)
+{
+	return Marklin_MsgQueue_SubscribeKeyed(event_type, MARKLIN_MSGQUEUE_NO_KEY, subscription);
+}
+
+marklin_error_t Marklin_MsgQueue_SubscribeKeyed(marklin_msgqueue_event_type_t event_type, u16 key,
+						marklin_msgqueue_subscription_t *subscription)
 {
 	int server_tid = get_msgqueue_server_tid();
 	if (server_tid < 0) {
@@ -70,8 +94,10 @@ marklin_error_t Marklin_MsgQueue_Subscribe(marklin_msgqueue_event_type_t event_t
 
 	request.type = MARKLIN_MSGQUEUE_REQ_SUBSCRIBE;
 	request.subscribe.event_type = event_type;
+	request.subscribe.filter_key = key;
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
 
 	if (result < 0) {
 		return MARKLIN_ERROR_COMMUNICATION;
@@ -104,7 +130,8 @@ marklin_error_t Marklin_MsgQueue_Unsubscribe(const marklin_msgqueue_subscription
 	request.unsubscribe.event_type = subscription->event_type;
 	request.unsubscribe.subscription_id = subscription->subscription_id;
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
 
 	if (result < 0) {
 		return MARKLIN_ERROR_COMMUNICATION;
@@ -113,7 +140,7 @@ marklin_error_t Marklin_MsgQueue_Unsubscribe(const marklin_msgqueue_subscription
 	return reply.error;
 }
 
-marklin_error_t Marklin_MsgQueue_Receive(marklin_msgqueue_message_t *message, u32 timeout_ticks)
+static marklin_error_t msgqueue_receive(int subscriber_tid, marklin_msgqueue_message_t *message, u32 timeout_ticks)
 {
 	int server_tid = get_msgqueue_server_tid();
 	if (server_tid < 0) {
@@ -129,20 +156,27 @@ marklin_error_t Marklin_MsgQueue_Receive(marklin_msgqueue_message_t *message, u3
 
 	request.type = MARKLIN_MSGQUEUE_REQ_RECEIVE;
 	request.receive.timeout_ticks = timeout_ticks;
+	request.receive.subscriber_tid = subscriber_tid;
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  sizeof(reply));
 
 	if (result < 0) {
 		return MARKLIN_ERROR_COMMUNICATION;
 	}
 
 	if (reply.error == MARKLIN_ERROR_OK) {
-		*message = reply.receive.message;
+		copy_received_message(message, &reply);
 	}
 
 	return reply.error;
 }
 
+marklin_error_t Marklin_MsgQueue_Receive(marklin_msgqueue_message_t *message, u32 timeout_ticks)
+{
+	return msgqueue_receive(-1, message, timeout_ticks);
+}
+
 marklin_error_t Marklin_MsgQueue_ReceiveNonBlock(marklin_msgqueue_message_t *message)
 {
 	int server_tid = get_msgqueue_server_tid();
@@ -159,14 +193,48 @@ marklin_error_t Marklin_MsgQueue_ReceiveNonBlock(marklin_msgqueue_message_t *mes
 
 	request.type = MARKLIN_MSGQUEUE_REQ_RECEIVE_NONBLOCK;
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  sizeof(reply));
 
 	if (result < 0) {
 		return MARKLIN_ERROR_COMMUNICATION;
 	}
 
 	if (reply.error == MARKLIN_ERROR_OK) {
-		*message = reply.receive.message;
+		copy_received_message(message, &reply);
+	}
+
+	return reply.error;
+}
+
+marklin_error_t Marklin_MsgQueue_GetSubscriptionStats(const marklin_msgqueue_subscription_t *subscription,
+						      marklin_msgqueue_subscription_stats_t *stats)
+{
+	int server_tid = get_msgqueue_server_tid();
+	if (server_tid < 0) {
+		return MARKLIN_ERROR_NOT_FOUND;
+	}
+
+	if (!subscription || !stats) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	marklin_msgqueue_request_t request;
+	marklin_msgqueue_reply_t reply;
+
+	request.type = MARKLIN_MSGQUEUE_REQ_GET_STATS;
+	request.stats.event_type = subscription->event_type;
+	request.stats.subscription_id = subscription->subscription_id;
+
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+
+	if (result < 0) {
+		return MARKLIN_ERROR_COMMUNICATION;
+	}
+
+	if (reply.error == MARKLIN_ERROR_OK) {
+		*stats = reply.stats;
 	}
 
 	return reply.error;
@@ -184,7 +252,8 @@ int Marklin_MsgQueue_GetPendingCount(void)
 
 	request.type = MARKLIN_MSGQUEUE_REQ_GET_PENDING_COUNT;
 
-	int result = Send(server_tid, (const char *)&request, sizeof(request), (char *)&reply, sizeof(reply));
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
 
 	if (result < 0 || reply.error != MARKLIN_ERROR_OK) {
 		return -1;
@@ -193,26 +262,257 @@ int Marklin_MsgQueue_GetPendingCount(void)
 	return reply.pending_count.pending_count;
 }
 
+// #########################################################
+// # Multiplexed Wait
+// #########################################################
+
+// Receives the parent's subscribed messages and forwards each one in a Send, trimmed to its payload. An
+// empty Send reports the deadline, a bare error code a receive that failed; the reply carries the next deadline.
+static void __noreturn msgqueue_courier_task(void)
+{
+	int waiter_tid = MyParentTid();
+	marklin_msgqueue_message_t message;
+	marklin_error_t result = MARKLIN_ERROR_OK;
+	const char *report = (const char *)&message;
+	int report_size = 0;
+
+	for (;;) {
+		u32 deadline_tick;
+
+		if (Send(waiter_tid, report, report_size, (char *)&deadline_tick, sizeof(deadline_tick)) !=
+		    sizeof(deadline_tick)) {
+			Exit();
+		}
+
+		clock_time_t now;
+		GetClockTime(&now);
+
+		report = (const char *)&message;
+		report_size = 0;
+		if (deadline_tick && now.ticks >= deadline_tick) {
+			continue;
+		}
+
+		u32 timeout_ticks = deadline_tick ? deadline_tick - (u32)now.ticks : 0;
+		result = msgqueue_receive(waiter_tid, &message, timeout_ticks);
+		if (result == MARKLIN_ERROR_OK) {
+			report_size = offsetof(marklin_msgqueue_message_t, data) + message.data_size;
+		} else if (result != MARKLIN_ERROR_TIMEOUT) {
+			report = (const char *)&result;
+			report_size = sizeof(result);
+		}
+	}
+
+	UNREACHABLE();
+}
+
+// Drop the receive a courier left waiting on the caller's behalf, without replying to the courier
+static marklin_error_t msgqueue_cancel_receive(void)
+{
+	int server_tid = get_msgqueue_server_tid();
+	if (server_tid < 0) {
+		return MARKLIN_ERROR_NOT_FOUND;
+	}
+
+	marklin_msgqueue_request_t request;
+	marklin_msgqueue_reply_t reply;
+
+	request.type = MARKLIN_MSGQUEUE_REQ_CANCEL_RECEIVE;
+
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+
+	if (result < 0) {
+		return MARKLIN_ERROR_COMMUNICATION;
+	}
+
+	return reply.error;
+}
+
+// Move the deadline of the receive the courier is blocked in on the caller's behalf forward
+static marklin_error_t msgqueue_rearm(u32 deadline_tick)
+{
+	int server_tid = get_msgqueue_server_tid();
+	if (server_tid < 0) {
+		return MARKLIN_ERROR_NOT_FOUND;
+	}
+
+	marklin_msgqueue_request_t request;
+	marklin_msgqueue_reply_t reply;
+
+	request.type = MARKLIN_MSGQUEUE_REQ_REARM;
+	request.rearm.deadline_tick = deadline_tick;
+
+	int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE, (char *)&reply,
+			  MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+
+	if (result < 0) {
+		return MARKLIN_ERROR_COMMUNICATION;
+	}
+
+	return reply.error;
+}
+
+marklin_error_t Marklin_MsgQueue_WaiterInit(marklin_msgqueue_waiter_t *waiter)
+{
+	task_stats_t self;
+
+	if (!waiter) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	if (GetTaskStats(MyTid(), &self, 1) != 1) {
+		return MARKLIN_ERROR_UNKNOWN;
+	}
+
+	// A task killed while its courier waited leaves that receive behind, and its TID may be ours now
+	msgqueue_cancel_receive();
+
+	waiter->courier_tid = CreateWithStack(self.priority, msgqueue_courier_task, TASK_SMALL_STACK_SIZE);
+	waiter->courier_state = MARKLIN_MSGQUEUE_COURIER_STARTING;
+	waiter->armed_deadline_tick = 0;
+
+	return waiter->courier_tid < 0 ? MARKLIN_ERROR_UNKNOWN : MARKLIN_ERROR_OK;
+}
+
+marklin_error_t Marklin_MsgQueue_WaiterDestroy(marklin_msgqueue_waiter_t *waiter)
+{
+	if (!waiter || waiter->courier_tid < 0) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	// Kill first, so the courier cannot start another receive after the cancel
+	Kill(waiter->courier_tid, 0);
+	waiter->courier_tid = -1;
+	waiter->armed_deadline_tick = 0;
+
+	return msgqueue_cancel_receive();
+}
+
+int Marklin_MsgQueue_Wait(marklin_msgqueue_waiter_t *waiter, u32 deadline_tick, int *sender_tid, void *msg,
+			  int *msglen, marklin_msgqueue_message_t *event)
+{
+	if (!waiter || waiter->courier_tid < 0 || !sender_tid || !msg || !msglen || !event) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	for (;;) {
+		// Hand the idle courier the deadline, it then waits in the message queue while we wait here
+		if (waiter->courier_state == MARKLIN_MSGQUEUE_COURIER_IDLE) {
+			clock_time_t now;
+			GetClockTime(&now);
+
+			if (deadline_tick && now.ticks >= deadline_tick) {
+				return MARKLIN_MSGQUEUE_WAIT_DEADLINE;
+			}
+
+			Reply(waiter->courier_tid, (const char *)&deadline_tick, sizeof(deadline_tick));
+			waiter->courier_state = MARKLIN_MSGQUEUE_COURIER_WAITING;
+			waiter->armed_deadline_tick = deadline_tick;
+		} else if (waiter->courier_state == MARKLIN_MSGQUEUE_COURIER_WAITING && deadline_tick &&
+			   (!waiter->armed_deadline_tick || deadline_tick < waiter->armed_deadline_tick)) {
+			// The courier still waits towards a later deadline from an earlier call, bring it forward
+			if (msgqueue_rearm(deadline_tick) == MARKLIN_ERROR_OK) {
+				waiter->armed_deadline_tick = deadline_tick;
+			}
+		}
+
+		int tid;
+		int size = Receive(&tid, (char *)event, sizeof(*event));
+		if (size < 0) {
+			return MARKLIN_ERROR_COMMUNICATION;
+		}
+
+		if (tid != waiter->courier_tid) {
+			memcpy(msg, event, size < *msglen ? size : *msglen);
+			*msglen = size;
+			*sender_tid = tid;
+			return MARKLIN_MSGQUEUE_WAIT_MESSAGE;
+		}
+
+		marklin_msgqueue_courier_state_t state = waiter->courier_state;
+		waiter->courier_state = MARKLIN_MSGQUEUE_COURIER_IDLE;
+
+		if (state == MARKLIN_MSGQUEUE_COURIER_WAITING) {
+			if (size == 0) {
+				return MARKLIN_MSGQUEUE_WAIT_DEADLINE;
+			}
+
+			// A forwarded message is never this short, its header alone is larger
+			if (size == sizeof(marklin_error_t)) {
+				marklin_error_t error;
+				memcpy(&error, event, sizeof(error));
+				return error;
+			}
+
+			return MARKLIN_MSGQUEUE_WAIT_EVENT;
+		}
+	}
+}
+
 // #########################################################
 // # Message Queue Server Implementation
 // #########################################################
 
+// Indexed by TID
 typedef struct {
-	int tid;
+	int waiting;
+	int reply_tid; // Blocked in the receive: the subscriber itself or its courier
 	u32 timeout_ticks;
 	u64 request_time;
+	u64 deadline_tick;
+	struct dlist_node deadline_node; // On the server's deadline list while a timed receive waits
 } marklin_msgqueue_pending_receive_t;
 
+#define POOL_CLASSES MARKLIN_MSGQUEUE_POOL_CLASSES
+#define POOL_RECORD_SIZE(data_size) ((MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE + (data_size) + 7) & ~7UL)
+#define POOL_STORAGE_SIZE                                                                               \
+	(MARKLIN_MSGQUEUE_POOL_SMALL_MESSAGES * POOL_RECORD_SIZE(MARKLIN_MSGQUEUE_POOL_SMALL_DATA_SIZE) +   \
+	 MARKLIN_MSGQUEUE_POOL_MEDIUM_MESSAGES * POOL_RECORD_SIZE(MARKLIN_MSGQUEUE_POOL_MEDIUM_DATA_SIZE) + \
+	 MARKLIN_MSGQUEUE_POOL_LARGE_MESSAGES * POOL_RECORD_SIZE(MARKLIN_MSGQUEUE_MAX_DATA_SIZE))
+
+typedef struct {
+	u32 data_size;
+	u32 messages;
+} marklin_msgqueue_pool_class_t;
+
+static const marklin_msgqueue_pool_class_t pool_classes[POOL_CLASSES] = {
+	{ MARKLIN_MSGQUEUE_POOL_SMALL_DATA_SIZE, MARKLIN_MSGQUEUE_POOL_SMALL_MESSAGES },
+	{ MARKLIN_MSGQUEUE_POOL_MEDIUM_DATA_SIZE, MARKLIN_MSGQUEUE_POOL_MEDIUM_MESSAGES },
+	{ MARKLIN_MSGQUEUE_MAX_DATA_SIZE, MARKLIN_MSGQUEUE_POOL_LARGE_MESSAGES },
+};
+
+typedef struct {
+	// The receive reply exactly as sent: reply header, then data_size bytes of payload
+	marklin_msgqueue_reply_t *record;
+	u32 refcount; // Subscriber queue entries referring to this message
+	u8 size_class;
+	int next_free;
+} marklin_msgqueue_pool_message_t;
+
 typedef struct {
 	marklin_msgqueue_subscriber_info_t subscribers[MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS];
-	marklin_msgqueue_pending_receive_t pending_receives[MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS];
+	int topic_subscribers[MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT]; // First subscriber of each event type, -1 if none
+	int task_subscribers[MAX_TASKS]; // First subscription of each TID, -1 if none
+	marklin_msgqueue_pending_receive_t pending_receives[MAX_TASKS];
 	int pending_receive_count;
+	struct dlist_node deadlines; // Timed receives, earliest deadline first
+	int timer_tid; // The timer task, while it is parked waiting for a deadline
 	u32 next_subscription_id;
 	u32 next_sequence_number;
+	marklin_msgqueue_pool_message_t pool[MARKLIN_MSGQUEUE_POOL_MESSAGES];
+	int pool_free[POOL_CLASSES];
+	u8 pool_storage[POOL_STORAGE_SIZE] __attribute__((aligned(8)));
 } marklin_msgqueue_server_state_t;
 
 static marklin_msgqueue_server_state_t *server_state_g = NULL;
 
+// Topics where only the newest message per key matters, so a slow subscriber gets the latest value instead
+// of a backlog of stale ones
+static const u8 topic_coalesces[MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT] = {
+	[MARKLIN_MSGQUEUE_EVENT_TYPE_TRAIN_POSITION] = 1,
+};
+
 static void server_state_init(marklin_msgqueue_server_state_t *server_state)
 {
 	memset(server_state, 0, sizeof(*server_state));
@@ -229,19 +529,103 @@ static void server_state_init(marklin_msgqueue_server_state_t *server_state)
 		server_state->subscribers[i].tid = -1;
 		server_state->subscribers[i].event_type = 0xFF; // Invalid event type as canary
 		server_state->subscribers[i].subscription_id = 0;
+		server_state->subscribers[i].next_in_topic = -1;
+		server_state->subscribers[i].next_for_task = -1;
+	}
+
+	for (int i = 0; i < MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT; i++) {
+		server_state->topic_subscribers[i] = -1;
+	}
+
+	for (int i = 0; i < MAX_TASKS; i++) {
+		server_state->task_subscribers[i] = -1;
+		server_state->pending_receives[i].waiting = 0;
+		dlist_init_node(&server_state->pending_receives[i].deadline_node);
+	}
+
+	dlist_init(&server_state->deadlines);
+	server_state->timer_tid = -1;
+
+	// Carve the storage into records and thread each class onto its free list
+	u32 offset = 0;
+	int index = 0;
+	for (int c = 0; c < POOL_CLASSES; c++) {
+		server_state->pool_free[c] = -1;
+
+		for (u32 i = 0; i < pool_classes[c].messages; i++, index++) {
+			marklin_msgqueue_pool_message_t *message = &server_state->pool[index];
+
+			message->record = (marklin_msgqueue_reply_t *)&server_state->pool_storage[offset];
+			message->refcount = 0;
+			message->size_class = c;
+			message->next_free = server_state->pool_free[c];
+			server_state->pool_free[c] = index;
+
+			offset += POOL_RECORD_SIZE(pool_classes[c].data_size);
+		}
+	}
+}
+
+// Store a payload once, in the smallest class with a free record. Returns the pool index, -1 if none is free.
+static int pool_alloc(marklin_msgqueue_event_type_t event_type, const void *data, u32 data_size)
+{
+	for (int c = 0; c < POOL_CLASSES; c++) {
+		if (data_size > pool_classes[c].data_size || server_state_g->pool_free[c] < 0) {
+			continue;
+		}
+
+		int index = server_state_g->pool_free[c];
+		marklin_msgqueue_pool_message_t *message = &server_state_g->pool[index];
+
+		server_state_g->pool_free[c] = message->next_free;
+		message->refcount = 0;
+		message->record->error = MARKLIN_ERROR_OK;
+		message->record->receive.message.event_type = event_type;
+		message->record->receive.message.data_size = data_size;
+		memcpy(message->record->receive.message.data, data, data_size);
 
-		server_state->pending_receives[i].tid = -1;
-		server_state->pending_receives[i].timeout_ticks = 0;
-		server_state->pending_receives[i].request_time = 0;
+		return index;
+	}
+
+	return -1;
+}
+
+// Smallest class a payload fits in, which is the one it is charged to until it is stored
+static int pool_class_for(u32 data_size)
+{
+	int c = 0;
+	while (c < POOL_CLASSES - 1 && data_size > pool_classes[c].data_size) {
+		c++;
+	}
+	return c;
+}
+
+static void pool_release(int index)
+{
+	marklin_msgqueue_pool_message_t *message = &server_state_g->pool[index];
+
+	if (--message->refcount == 0) {
+		message->next_free = server_state_g->pool_free[message->size_class];
+		server_state_g->pool_free[message->size_class] = index;
 	}
 }
 
+// The one copy of the payload a subscriber gets, straight from the pool into its reply buffer
+static void reply_with_message(int tid, int index)
+{
+	marklin_msgqueue_reply_t *record = server_state_g->pool[index].record;
+
+	Reply(tid, (const char *)record, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE + record->receive.message.data_size);
+	pool_release(index);
+}
+
+#define SUBSCRIBER_INDEX(subscriber) ((int)((subscriber) - server_state_g->subscribers))
+
 static marklin_msgqueue_subscriber_info_t *find_subscriber_by_tid_and_event(int tid,
 									    marklin_msgqueue_event_type_t event_type)
 {
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		if (server_state_g->subscribers[i].is_active && server_state_g->subscribers[i].tid == tid &&
-		    server_state_g->subscribers[i].event_type == event_type) {
+	for (int i = server_state_g->task_subscribers[tid]; i >= 0; i = server_state_g->subscribers[i].next_for_task) {
+		if (server_state_g->subscribers[i].event_type == event_type) {
 			return &server_state_g->subscribers[i];
 		}
 	}
@@ -251,9 +635,8 @@ static marklin_msgqueue_subscriber_info_t *find_subscriber_by_tid_and_event(int
 static marklin_msgqueue_subscriber_info_t *
 find_subscriber_by_subscription_id(int tid, marklin_msgqueue_event_type_t event_type, u32 subscription_id)
 {
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		if (server_state_g->subscribers[i].is_active && server_state_g->subscribers[i].tid == tid &&
-		    server_state_g->subscribers[i].event_type == event_type &&
+	for (int i = server_state_g->task_subscribers[tid]; i >= 0; i = server_state_g->subscribers[i].next_for_task) {
+		if (server_state_g->subscribers[i].event_type == event_type &&
 		    server_state_g->subscribers[i].subscription_id == subscription_id) {
 			return &server_state_g->subscribers[i];
 		}
@@ -261,6 +644,48 @@ find_subscriber_by_subscription_id(int tid, marklin_msgqueue_event_type_t event_
 	return NULL;
 }
 
+// First of the task's subscriptions with a message queued
+static marklin_msgqueue_subscriber_info_t *find_subscriber_with_messages(int tid)
+{
+	for (int i = server_state_g->task_subscribers[tid]; i >= 0; i = server_state_g->subscribers[i].next_for_task) {
+		if (server_state_g->subscribers[i].pending_messages > 0) {
+			return &server_state_g->subscribers[i];
+		}
+	}
+	return NULL;
+}
+
+static void subscriber_link(marklin_msgqueue_subscriber_info_t *subscriber)
+{
+	int index = SUBSCRIBER_INDEX(subscriber);
+
+	subscriber->next_in_topic = server_state_g->topic_subscribers[subscriber->event_type];
+	server_state_g->topic_subscribers[subscriber->event_type] = index;
+
+	subscriber->next_for_task = server_state_g->task_subscribers[subscriber->tid];
+	server_state_g->task_subscribers[subscriber->tid] = index;
+}
+
+static void subscriber_unlink(marklin_msgqueue_subscriber_info_t *subscriber)
+{
+	int index = SUBSCRIBER_INDEX(subscriber);
+
+	int *link = &server_state_g->topic_subscribers[subscriber->event_type];
+	while (*link != index) {
+		link = &server_state_g->subscribers[*link].next_in_topic;
+	}
+	*link = subscriber->next_in_topic;
+
+	link = &server_state_g->task_subscribers[subscriber->tid];
+	while (*link != index) {
+		link = &server_state_g->subscribers[*link].next_for_task;
+	}
+	*link = subscriber->next_for_task;
+
+	subscriber->next_in_topic = -1;
+	subscriber->next_for_task = -1;
+}
+
 static marklin_msgqueue_subscriber_info_t *find_free_subscriber_slot(void)
 {
 	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
@@ -276,122 +701,292 @@ static int subscriber_queue_is_full(marklin_msgqueue_subscriber_info_t *subscrib
 	return subscriber->pending_messages >= MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER;
 }
 
-static marklin_error_t subscriber_queue_enqueue(marklin_msgqueue_subscriber_info_t *subscriber,
-						const marklin_msgqueue_message_t *message)
+// The subscriber already holds its share of the class's pool records
+static int subscriber_pool_share_is_full(marklin_msgqueue_subscriber_info_t *subscriber, int size_class)
 {
-	if (subscriber_queue_is_full(subscriber)) {
-		return MARKLIN_ERROR_QUEUE_FULL;
-	}
+	u32 share = pool_classes[size_class].messages / MARKLIN_MSGQUEUE_POOL_SUBSCRIBER_SHARE;
+	return subscriber->pool_records[size_class] >= (share ? share : 1);
+}
 
-	marklin_msgqueue_internal_message_t *internal_msg = &subscriber->message_queue[subscriber->queue_tail];
+static void subscriber_queue_enqueue(marklin_msgqueue_subscriber_info_t *subscriber, int index, u16 key,
+				     u32 sequence_number)
+{
+	marklin_msgqueue_queue_entry_t *entry = &subscriber->message_queue[subscriber->queue_tail];
 
-	internal_msg->message = *message;
-	internal_msg->sequence_number = server_state_g->next_sequence_number++;
+	entry->message = index;
+	entry->key = key;
+	entry->sequence_number = sequence_number;
+	server_state_g->pool[index].refcount++;
+	subscriber->pool_records[server_state_g->pool[index].size_class]++;
 
 	subscriber->queue_tail = (subscriber->queue_tail + 1) % MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER;
 	subscriber->pending_messages++;
-
-	return MARKLIN_ERROR_OK;
 }
 
-static marklin_error_t subscriber_queue_dequeue(marklin_msgqueue_subscriber_info_t *subscriber,
-						marklin_msgqueue_message_t *message)
+// Returns the pool index of the oldest queued message, -1 if the queue is empty. The queue's reference
+// passes to the caller.
+static int subscriber_queue_dequeue(marklin_msgqueue_subscriber_info_t *subscriber)
 {
 	if (subscriber->pending_messages == 0) {
-		return MARKLIN_ERROR_NOT_FOUND;
+		return -1;
 	}
 
-	marklin_msgqueue_internal_message_t *internal_msg = &subscriber->message_queue[subscriber->queue_head];
-
-	*message = internal_msg->message;
+	int index = subscriber->message_queue[subscriber->queue_head].message;
 
 	subscriber->queue_head = (subscriber->queue_head + 1) % MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER;
 	subscriber->pending_messages--;
+	subscriber->pool_records[server_state_g->pool[index].size_class]--;
 
-	return MARKLIN_ERROR_OK;
+	return index;
 }
 
-static marklin_error_t add_pending_receive(int tid, u32 timeout_ticks, u64 request_time)
+static u64 server_now_tick(void)
 {
-	if (server_state_g->pending_receive_count >= MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS) {
-		return MARKLIN_ERROR_QUEUE_FULL;
+	clock_time_t now;
+
+	GetClockTime(&now);
+	return now.ticks;
+}
+
+// Tick the timer task should wake at for the earliest deadline
+static u32 timer_wake_tick(u64 now)
+{
+	marklin_msgqueue_pending_receive_t *first =
+		dlist_entry(dlist_first(&server_state_g->deadlines), marklin_msgqueue_pending_receive_t, deadline_node);
+	u64 wake = first->deadline_tick;
+
+	// A deadline added later can be earlier than the one the timer sleeps towards, so it never sleeps long
+	if (wake > now + MARKLIN_MSGQUEUE_TIMER_MAX_SLEEP_TICKS) {
+		wake = now + MARKLIN_MSGQUEUE_TIMER_MAX_SLEEP_TICKS;
 	}
 
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		if (server_state_g->pending_receives[i].tid == -1) {
-			server_state_g->pending_receives[i].tid = tid;
-			server_state_g->pending_receives[i].timeout_ticks = timeout_ticks;
-			server_state_g->pending_receives[i].request_time = request_time;
-			server_state_g->pending_receive_count++;
-			return MARKLIN_ERROR_OK;
-		}
+	return (u32)wake;
+}
+
+// Send a parked timer task off to sleep until the earliest deadline
+static void timer_arm(u64 now)
+{
+	if (server_state_g->timer_tid < 0 || dlist_is_empty(&server_state_g->deadlines)) {
+		return;
 	}
 
-	return MARKLIN_ERROR_QUEUE_FULL;
+	marklin_msgqueue_reply_t reply;
+	reply.error = MARKLIN_ERROR_OK;
+	reply.timer.wake_tick = timer_wake_tick(now);
+
+	Reply(server_state_g->timer_tid, (const char *)&reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+	server_state_g->timer_tid = -1;
 }
 
-static void remove_pending_receive(int tid)
+// Sorted insert, searched from the back since most waiters use the same timeout
+static void deadline_insert(marklin_msgqueue_pending_receive_t *pending)
 {
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		if (server_state_g->pending_receives[i].tid == tid) {
-			server_state_g->pending_receives[i].tid = -1;
-			server_state_g->pending_receives[i].timeout_ticks = 0;
-			server_state_g->pending_receives[i].request_time = 0;
-			server_state_g->pending_receive_count--;
+	struct dlist_node *pos;
+	dlist_for_each_reverse(pos, &server_state_g->deadlines) {
+		marklin_msgqueue_pending_receive_t *other =
+			dlist_entry(pos, marklin_msgqueue_pending_receive_t, deadline_node);
+		if (other->deadline_tick <= pending->deadline_tick) {
 			break;
 		}
 	}
+	dlist_insert(pos, &pending->deadline_node);
 }
 
-static marklin_error_t check_and_reply_pending_receives(void)
+static marklin_error_t add_pending_receive(int tid, int reply_tid, u32 timeout_ticks, u64 request_time)
 {
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		if (server_state_g->pending_receives[i].tid == -1) {
-			continue;
-		}
+	marklin_msgqueue_pending_receive_t *pending = &server_state_g->pending_receives[tid];
 
-		int tid = server_state_g->pending_receives[i].tid;
+	if (pending->waiting) {
+		return MARKLIN_ERROR_QUEUE_FULL;
+	}
 
-		marklin_msgqueue_subscriber_info_t *subscriber_with_messages = NULL;
-		for (int j = 0; j < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; j++) {
-			marklin_msgqueue_subscriber_info_t *subscriber = &server_state_g->subscribers[j];
-			if (subscriber->is_active && subscriber->tid == tid && subscriber->pending_messages > 0) {
-				subscriber_with_messages = subscriber;
-				break;
-			}
+	pending->waiting = 1;
+	pending->reply_tid = reply_tid;
+	pending->timeout_ticks = timeout_ticks;
+	pending->request_time = request_time;
+	server_state_g->pending_receive_count++;
+
+	if (timeout_ticks == 0) {
+		return MARKLIN_ERROR_OK;
+	}
+
+	pending->deadline_tick = request_time + timeout_ticks;
+	deadline_insert(pending);
+	timer_arm(request_time);
+
+	return MARKLIN_ERROR_OK;
+}
+
+static void remove_pending_receive(int tid)
+{
+	marklin_msgqueue_pending_receive_t *pending = &server_state_g->pending_receives[tid];
+
+	if (pending->waiting) {
+		if (pending->timeout_ticks) {
+			dlist_del(&pending->deadline_node);
+			dlist_init_node(&pending->deadline_node);
 		}
 
-		if (subscriber_with_messages) {
-			marklin_msgqueue_reply_t reply;
-			reply.error = subscriber_queue_dequeue(subscriber_with_messages, &reply.receive.message);
+		pending->waiting = 0;
+		pending->timeout_ticks = 0;
+		pending->request_time = 0;
+		server_state_g->pending_receive_count--;
+	}
+}
 
-			Reply(tid, (const char *)&reply, sizeof(reply));
-			remove_pending_receive(tid);
+// From the timer task: fail every receive whose deadline has passed, then send the timer back to sleep
+// until the next deadline, or park it until there is one
+static marklin_error_t handle_timer_request(int sender_tid, marklin_msgqueue_reply_t *reply)
+{
+	u64 now = server_now_tick();
+
+	while (!dlist_is_empty(&server_state_g->deadlines)) {
+		marklin_msgqueue_pending_receive_t *first =
+			dlist_entry(dlist_first(&server_state_g->deadlines), marklin_msgqueue_pending_receive_t,
+				    deadline_node);
+		if (first->deadline_tick > now) {
+			break;
 		}
+
+		int tid = (int)(first - server_state_g->pending_receives);
+		marklin_msgqueue_reply_t timeout_reply;
+		timeout_reply.error = MARKLIN_ERROR_TIMEOUT;
+
+		remove_pending_receive(tid);
+		Reply(first->reply_tid, (const char *)&timeout_reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+	}
+
+	if (dlist_is_empty(&server_state_g->deadlines)) {
+		server_state_g->timer_tid = sender_tid;
+		return MARKLIN_ERROR_PENDING;
 	}
 
+	reply->timer.wake_tick = timer_wake_tick(now);
 	return MARKLIN_ERROR_OK;
 }
 
-static marklin_error_t handle_publish_request(const marklin_msgqueue_request_t *request)
+// From a waiter whose courier may be blocked in a receive for it: move that receive's deadline forward. A
+// deadline that has already passed times the receive out now.
+static marklin_error_t handle_rearm_request(const marklin_msgqueue_request_t *request, int sender_tid)
 {
-	marklin_msgqueue_message_t message;
-	message.event_type = request->publish.event_type;
-	message.data_size = request->publish.data_size;
+	marklin_msgqueue_pending_receive_t *pending = &server_state_g->pending_receives[sender_tid];
+	u64 deadline_tick = request->rearm.deadline_tick;
 
-	memcpy(message.data, request->publish.data, request->publish.data_size);
+	// The receive already completed, its reply is on the way to the waiter
+	if (!pending->waiting) {
+		return MARKLIN_ERROR_OK;
+	}
 
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
+	if (pending->timeout_ticks && pending->deadline_tick <= deadline_tick) {
+		return MARKLIN_ERROR_OK;
+	}
+
+	u64 now = server_now_tick();
+	if (deadline_tick <= now) {
+		marklin_msgqueue_reply_t timeout_reply;
+		timeout_reply.error = MARKLIN_ERROR_TIMEOUT;
+
+		remove_pending_receive(sender_tid);
+		Reply(pending->reply_tid, (const char *)&timeout_reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+		return MARKLIN_ERROR_OK;
+	}
+
+	if (pending->timeout_ticks) {
+		dlist_del(&pending->deadline_node);
+		dlist_init_node(&pending->deadline_node);
+	}
+
+	pending->timeout_ticks = (u32)(deadline_tick - pending->request_time);
+	pending->deadline_tick = deadline_tick;
+	deadline_insert(pending);
+	timer_arm(now);
+
+	return MARKLIN_ERROR_OK;
+}
+
+// Queued entry with the given key, NULL if none. On a coalescing topic the queue holds at most one entry
+// per key, so this scans as many entries as there are keys.
+static marklin_msgqueue_queue_entry_t *subscriber_queue_find_key(marklin_msgqueue_subscriber_info_t *subscriber,
+								 u16 key)
+{
+	int slot = subscriber->queue_head;
+
+	for (int i = 0; i < subscriber->pending_messages; i++) {
+		if (subscriber->message_queue[slot].key == key) {
+			return &subscriber->message_queue[slot];
+		}
+		slot = (slot + 1) % MARKLIN_MSGQUEUE_MAX_MESSAGES_PER_SUBSCRIBER;
+	}
+
+	return NULL;
+}
+
+static marklin_error_t handle_publish_request(const marklin_msgqueue_request_t *request, int request_size)
+{
+	if (request_size < (int)MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE ||
+	    request->publish.event_type >= MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT || request->publish.data_size == 0 ||
+	    request->publish.data_size > MARKLIN_MSGQUEUE_MAX_DATA_SIZE ||
+	    (u32)request_size < MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE + request->publish.data_size) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
+	// Stored on the first subscriber that takes it, every other subscriber queues the same index
+	int index = -1;
+	u32 sequence_number = server_state_g->next_sequence_number++;
+	u16 key = (u16)request->publish.key;
+	int coalesce = topic_coalesces[request->publish.event_type] && key != MARKLIN_MSGQUEUE_NO_KEY;
+
+	int next;
+	for (int i = server_state_g->topic_subscribers[request->publish.event_type]; i >= 0; i = next) {
 		marklin_msgqueue_subscriber_info_t *subscriber = &server_state_g->subscribers[i];
+		next = subscriber->next_in_topic;
+
+		// Keyed subscribers only take their own key, plain publishes reach the unfiltered ones
+		if (subscriber->filter_key != MARKLIN_MSGQUEUE_NO_KEY && subscriber->filter_key != key) {
+			continue;
+		}
+
+		marklin_msgqueue_queue_entry_t *stale = coalesce ? subscriber_queue_find_key(subscriber, key) : NULL;
+		int size_class = index < 0 ? pool_class_for(request->publish.data_size) :
+					     server_state_g->pool[index].size_class;
 
-		if (subscriber->is_active) {
-			if (subscriber->event_type == request->publish.event_type) {
-				subscriber_queue_enqueue(subscriber, &message);
+		if (!stale &&
+		    (subscriber_queue_is_full(subscriber) || subscriber_pool_share_is_full(subscriber, size_class))) {
+			subscriber->dropped++;
+			continue;
+		}
+
+		if (index < 0) {
+			index = pool_alloc(request->publish.event_type, request->publish.data,
+					   request->publish.data_size);
+			if (index < 0) {
+				// Every subscriber that would take it loses this message, the publisher is not failed
+				subscriber->dropped++;
+				continue;
 			}
 		}
-	}
 
-	check_and_reply_pending_receives();
+		// Overwrite the undelivered older value in place, keeping its position in the queue
+		if (stale) {
+			subscriber->pool_records[server_state_g->pool[stale->message].size_class]--;
+			subscriber->pool_records[server_state_g->pool[index].size_class]++;
+			pool_release(stale->message);
+			stale->message = index;
+			stale->sequence_number = sequence_number;
+			server_state_g->pool[index].refcount++;
+			subscriber->coalesced++;
+			continue;
+		}
+
+		subscriber_queue_enqueue(subscriber, index, key, sequence_number);
+
+		// A waiting receiver has nothing else queued, hand it this message now
+		if (server_state_g->pending_receives[subscriber->tid].waiting) {
+			reply_with_message(server_state_g->pending_receives[subscriber->tid].reply_tid,
+					   subscriber_queue_dequeue(subscriber));
+			remove_pending_receive(subscriber->tid);
+		}
+	}
 
 	return MARKLIN_ERROR_OK;
 }
@@ -399,10 +994,15 @@ static marklin_error_t handle_publish_request(const marklin_msgqueue_request_t *
 static marklin_error_t handle_subscribe_request(const marklin_msgqueue_request_t *request, int subscriber_tid,
 						marklin_msgqueue_reply_t *reply)
 {
+	if (request->subscribe.event_type >= MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+
 	marklin_msgqueue_subscriber_info_t *existing =
 		find_subscriber_by_tid_and_event(subscriber_tid, request->subscribe.event_type);
 
 	if (existing) {
+		existing->filter_key = (u16)request->subscribe.filter_key;
 		reply->subscribe.subscription_id = existing->subscription_id;
 		return MARKLIN_ERROR_OK;
 	}
@@ -419,6 +1019,10 @@ static marklin_error_t handle_subscribe_request(const marklin_msgqueue_request_t
 	subscriber->pending_messages = 0;
 	subscriber->queue_head = 0;
 	subscriber->queue_tail = 0;
+	subscriber->filter_key = (u16)request->subscribe.filter_key;
+	subscriber->coalesced = 0;
+	subscriber->dropped = 0;
+	subscriber_link(subscriber);
 
 	reply->subscribe.subscription_id = subscriber->subscription_id;
 
@@ -434,31 +1038,52 @@ static marklin_error_t handle_unsubscribe_request(const marklin_msgqueue_request
 		return MARKLIN_ERROR_NOT_FOUND;
 	}
 
+	// Drop the references its queue still holds
+	int index;
+	while ((index = subscriber_queue_dequeue(subscriber)) >= 0) {
+		pool_release(index);
+	}
+
+	subscriber_unlink(subscriber);
 	subscriber->is_active = 0;
 	return MARKLIN_ERROR_OK;
 }
 
-static marklin_error_t handle_receive_request(const marklin_msgqueue_request_t *request, int subscriber_tid,
-					      marklin_msgqueue_reply_t *reply)
+static marklin_error_t handle_get_stats_request(const marklin_msgqueue_request_t *request, int subscriber_tid,
+					       marklin_msgqueue_reply_t *reply)
 {
-	marklin_msgqueue_subscriber_info_t *subscriber_with_messages = NULL;
+	marklin_msgqueue_subscriber_info_t *subscriber = find_subscriber_by_subscription_id(
+		subscriber_tid, request->stats.event_type, request->stats.subscription_id);
 
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		marklin_msgqueue_subscriber_info_t *subscriber = &server_state_g->subscribers[i];
+	if (!subscriber) {
+		return MARKLIN_ERROR_NOT_FOUND;
+	}
 
-		if (subscriber->is_active && subscriber->tid == subscriber_tid && subscriber->pending_messages > 0) {
-			subscriber_with_messages = subscriber;
-			break;
-		}
+	reply->stats.coalesced = subscriber->coalesced;
+	reply->stats.dropped = subscriber->dropped;
+	return MARKLIN_ERROR_OK;
+}
+
+static marklin_error_t handle_receive_request(const marklin_msgqueue_request_t *request, int sender_tid,
+					      int *message)
+{
+	// A courier receives on behalf of the task that owns the subscriptions
+	int subscriber_tid = request->receive.subscriber_tid < 0 ? sender_tid : request->receive.subscriber_tid;
+	if (subscriber_tid >= MAX_TASKS) {
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
 	}
 
+	marklin_msgqueue_subscriber_info_t *subscriber_with_messages = find_subscriber_with_messages(subscriber_tid);
+
 	if (subscriber_with_messages) {
-		return subscriber_queue_dequeue(subscriber_with_messages, &reply->receive.message);
+		*message = subscriber_queue_dequeue(subscriber_with_messages);
+		return MARKLIN_ERROR_OK;
 	}
 
 	// No messages available - add to pending receive list for blocking behavior
-	u64 current_time = Time(0);
-	marklin_error_t result = add_pending_receive(subscriber_tid, request->receive.timeout_ticks, current_time);
+	u64 current_time = server_now_tick();
+	marklin_error_t result = add_pending_receive(subscriber_tid, sender_tid, request->receive.timeout_ticks,
+						     current_time);
 
 	if (result != MARKLIN_ERROR_OK) {
 		return result;
@@ -469,18 +1094,9 @@ static marklin_error_t handle_receive_request(const marklin_msgqueue_request_t *
 
 static marklin_error_t handle_receive_nonblock_request(const marklin_msgqueue_request_t *request
 						       __attribute__((unused)),
-						       int subscriber_tid, marklin_msgqueue_reply_t *reply)
+						       int subscriber_tid, int *message)
 {
-	marklin_msgqueue_subscriber_info_t *subscriber_with_messages = NULL;
-
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		marklin_msgqueue_subscriber_info_t *subscriber = &server_state_g->subscribers[i];
-
-		if (subscriber->is_active && subscriber->tid == subscriber_tid && subscriber->pending_messages > 0) {
-			subscriber_with_messages = subscriber;
-			break;
-		}
-	}
+	marklin_msgqueue_subscriber_info_t *subscriber_with_messages = find_subscriber_with_messages(subscriber_tid);
 
 	// klog_info("MsgQueue: Checking subscriber %d for messages", subscriber_tid);
 
@@ -488,30 +1104,98 @@ static marklin_error_t handle_receive_nonblock_request(const marklin_msgqueue_re
 		return MARKLIN_ERROR_NOT_FOUND;
 	}
 
-	return subscriber_queue_dequeue(subscriber_with_messages, &reply->receive.message);
+	*message = subscriber_queue_dequeue(subscriber_with_messages);
+	return MARKLIN_ERROR_OK;
 }
 
 static marklin_error_t handle_get_pending_count_request(int subscriber_tid, marklin_msgqueue_reply_t *reply)
 {
 	int total_pending = 0;
 
-	for (int i = 0; i < MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS; i++) {
-		marklin_msgqueue_subscriber_info_t *subscriber = &server_state_g->subscribers[i];
-
-		if (subscriber->is_active && subscriber->tid == subscriber_tid) {
-			total_pending += subscriber->pending_messages;
-		}
+	for (int i = server_state_g->task_subscribers[subscriber_tid]; i >= 0;
+	     i = server_state_g->subscribers[i].next_for_task) {
+		total_pending += server_state_g->subscribers[i].pending_messages;
 	}
 
 	reply->pending_count.pending_count = total_pending;
 	return MARKLIN_ERROR_OK;
 }
 
-void __noreturn marklin_msgqueue_server_task(void)
+// A receive that finds a message sets *message to its pool index, the caller replies from the pool
+static marklin_error_t handle_request(const marklin_msgqueue_request_t *request, int request_size, int sender_tid,
+				      marklin_msgqueue_reply_t *reply, int *message)
 {
-	int sender_tid;
+	switch (request->type) {
+	case MARKLIN_MSGQUEUE_REQ_PUBLISH:
+		return handle_publish_request(request, request_size);
+
+	case MARKLIN_MSGQUEUE_REQ_SUBSCRIBE:
+		return handle_subscribe_request(request, sender_tid, reply);
+
+	case MARKLIN_MSGQUEUE_REQ_UNSUBSCRIBE:
+		return handle_unsubscribe_request(request, sender_tid);
+
+	case MARKLIN_MSGQUEUE_REQ_RECEIVE:
+		return handle_receive_request(request, sender_tid, message);
+
+	case MARKLIN_MSGQUEUE_REQ_RECEIVE_NONBLOCK:
+		return handle_receive_nonblock_request(request, sender_tid, message);
+
+	case MARKLIN_MSGQUEUE_REQ_GET_PENDING_COUNT:
+		return handle_get_pending_count_request(sender_tid, reply);
+
+	case MARKLIN_MSGQUEUE_REQ_TIMER:
+		return handle_timer_request(sender_tid, reply);
+
+	case MARKLIN_MSGQUEUE_REQ_GET_STATS:
+		return handle_get_stats_request(request, sender_tid, reply);
+
+	case MARKLIN_MSGQUEUE_REQ_REARM:
+		return handle_rearm_request(request, sender_tid);
+
+	case MARKLIN_MSGQUEUE_REQ_CANCEL_RECEIVE:
+		remove_pending_receive(sender_tid);
+		return MARKLIN_ERROR_OK;
+
+	default:
+		return MARKLIN_ERROR_INVALID_ARGUMENT;
+	}
+}
+
+// The one task that sleeps on behalf of every timed receive. It asks the server for the next wakeup tick,
+// sleeps until then and asks again, which is when the server times out the receives that are due.
+static void __noreturn marklin_msgqueue_timer_task(void)
+{
+	int server_tid = MyParentTid();
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
 	marklin_msgqueue_request_t request;
 	marklin_msgqueue_reply_t reply;
+
+	request.type = MARKLIN_MSGQUEUE_REQ_TIMER;
+
+	for (;;) {
+		int result = Send(server_tid, (const char *)&request, MARKLIN_MSGQUEUE_REQUEST_HEADER_SIZE,
+				  (char *)&reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+		if (result < 0 || reply.error != MARKLIN_ERROR_OK) {
+			log_error("MsgQueue: Timer task lost the server");
+			Exit();
+		}
+
+		DelayUntil(clock_tid, (int)reply.timer.wake_tick);
+	}
+
+	UNREACHABLE();
+}
+
+void __noreturn marklin_msgqueue_server_task(void)
+{
+	int sender_tids[MARKLIN_MSGQUEUE_RECEIVE_BATCH];
+	int request_sizes[MARKLIN_MSGQUEUE_RECEIVE_BATCH];
+	int reply_tids[MARKLIN_MSGQUEUE_RECEIVE_BATCH];
+	marklin_msgqueue_request_t requests[MARKLIN_MSGQUEUE_RECEIVE_BATCH];
+	marklin_msgqueue_reply_t reply;
+	// Header-only replies, sent together with one ReplyMany
+	char short_replies[MARKLIN_MSGQUEUE_RECEIVE_BATCH][MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE];
 	marklin_msgqueue_server_state_t server_state;
 
 	server_state_init(&server_state);
@@ -522,50 +1206,45 @@ void __noreturn marklin_msgqueue_server_task(void)
 		Exit();
 	}
 
-	log_info("MsgQueue: Server started");
+	log_info("MsgQueue: Server started, %u bytes of state", (u32)sizeof(server_state));
+
+	if (CreateWithStack(MARKLIN_MSGQUEUE_SERVER_TASK_PRIORITY, marklin_msgqueue_timer_task,
+			    TASK_SMALL_STACK_SIZE) < 0) {
+		log_error("MsgQueue: Failed to create the timer task, receive timeouts will not fire");
+	}
 
 	for (;;) {
-		int result = Receive(&sender_tid, (char *)&request, sizeof(request));
+		// Drain every queued sender in one kernel entry
+		int count = ReceiveMany(sender_tids, request_sizes, (char *)requests, sizeof(requests[0]),
+					MARKLIN_MSGQUEUE_RECEIVE_BATCH);
 
-		if (result < 0) {
+		if (count <= 0) {
 			continue;
 		}
 
-		reply.error = MARKLIN_ERROR_OK;
-
-		switch (request.type) {
-		case MARKLIN_MSGQUEUE_REQ_PUBLISH:
-			reply.error = handle_publish_request(&request);
-			break;
+		int reply_count = 0;
+		for (int i = 0; i < count; i++) {
+			int message = -1;
+			reply.error = handle_request(&requests[i], request_sizes[i], sender_tids[i], &reply, &message);
 
-		case MARKLIN_MSGQUEUE_REQ_SUBSCRIBE:
-			reply.error = handle_subscribe_request(&request, sender_tid, &reply);
-			break;
-
-		case MARKLIN_MSGQUEUE_REQ_UNSUBSCRIBE:
-			reply.error = handle_unsubscribe_request(&request, sender_tid);
-			break;
-
-		case MARKLIN_MSGQUEUE_REQ_RECEIVE:
-			reply.error = handle_receive_request(&request, sender_tid, &reply);
-			break;
-
-		case MARKLIN_MSGQUEUE_REQ_RECEIVE_NONBLOCK:
-			reply.error = handle_receive_nonblock_request(&request, sender_tid, &reply);
-			break;
+			// Only reply if the request is not pending (blocking)
+			if (reply.error == MARKLIN_ERROR_PENDING) {
+				continue;
+			}
 
-		case MARKLIN_MSGQUEUE_REQ_GET_PENDING_COUNT:
-			reply.error = handle_get_pending_count_request(sender_tid, &reply);
-			break;
+			if (message >= 0) {
+				reply_with_message(sender_tids[i], message);
+				continue;
+			}
 
-		default:
-			reply.error = MARKLIN_ERROR_INVALID_ARGUMENT;
-			break;
+			memcpy(short_replies[reply_count], &reply, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+			reply_tids[reply_count++] = sender_tids[i];
 		}
 
-		// Only reply if the request is not pending (blocking)
-		if (reply.error != MARKLIN_ERROR_PENDING) {
-			Reply(sender_tid, (const char *)&reply, sizeof(reply));
+		if (reply_count == 1) {
+			Reply(reply_tids[0], short_replies[0], MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE);
+		} else if (reply_count > 1) {
+			ReplyMany(reply_tids, (const char *)short_replies, MARKLIN_MSGQUEUE_REPLY_HEADER_SIZE, reply_count);
 		}
 	}
 
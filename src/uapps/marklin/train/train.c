@@ -1537,7 +1537,7 @@ marklin_error_t train_set_speed_and_headlight(train_task_data_t *data, u8 speed,
 	}
 
 	marklin_error_t result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, cmd, param,
-								     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+								     MARKLIN_TRAIN_CMD_DELAY_US,
 								     MARKLIN_CMD_PRIORITY_HIGH, data->train_id);
 	log_info("Train %d: Set speed to %d with headlight %d", data->train_id, speed, headlight);
 	if (result == MARKLIN_ERROR_OK) {
@@ -1583,7 +1583,7 @@ marklin_error_t train_reverse(train_task_data_t *data)
 
 	marklin_error_t result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM,
 								     MARKLIN_REVERSE_CMD + 16, data->train_id,
-								     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+								     MARKLIN_TRAIN_CMD_DELAY_US,
 								     MARKLIN_CMD_PRIORITY_HIGH, data->train_id);
 	if (result == MARKLIN_ERROR_OK) {
 		data->motion.commanded_speed = 0;
@@ -1675,10 +1675,10 @@ marklin_error_t train_force_stop(train_task_data_t *data)
 
 	marklin_error_t result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM,
 								     MARKLIN_REVERSE_CMD + 16, data->train_id,
-								     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+								     MARKLIN_TRAIN_CMD_DELAY_US,
 								     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16,
-						     data->train_id, MARKLIN_TRAIN_CMD_DELAY_TICKS,
+						     data->train_id, MARKLIN_TRAIN_CMD_DELAY_US,
 						     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 
 	// Set immediate stop flags
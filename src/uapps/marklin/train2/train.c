@@ -51,6 +51,7 @@ static const u32 TRAIN_STATE_TABLE_SIZE = sizeof(train_state_table) / sizeof(tra
 // ############################################################################
 
 #define TRAIN_PATH_REQUEST_INTERVAL_MS 2000
+#define TRAIN_IDLE_WAKE_TICKS 25 // Loop interval of a stopped train with nothing to do
 #define TRAIN_PATH_CONTINUATION_INTERVAL_MS 500
 
 // Kinematic estimation configuration constants
@@ -1020,6 +1021,8 @@ static marklin_error_t train_handle_debug_command(train_task_data_t *data, const
 	const char *current_sensor = data->motion.current_position.sensor ? data->motion.current_position.sensor->name :
 									    "UNKNOWN";
 	log_warn("Position: Sensor=%s, Offset=%lldmm", current_sensor, data->motion.current_position.offset_mm);
+	log_warn("Position Reports: Published=%u, Suppressed=%u", data->position_reports,
+		 data->position_reports_suppressed);
 
 	const char *dest_sensor = data->destination ? data->destination->name : "NONE";
 	log_warn("Destination: %s (offset=%lldmm)", dest_sensor, data->destination_offset_mm);
@@ -1118,6 +1121,8 @@ static void train_init_task_data(train_task_data_t *data)
 
 	data->last_path_request_tick = 0;
 	data->last_position_report_tick = 0;
+	data->position_reports = 0;
+	data->position_reports_suppressed = 0;
 	data->last_path_continuation_tick = 0;
 
 	// Sensor tracking initialization
@@ -1248,12 +1253,12 @@ void __noreturn marklin_train_task(void)
 
 	train_set_speed_and_headlight(&train_data, 0, MARKLIN_TRAIN_HEADLIGHT_ON);
 
-	// Subscribe to sensor updates for position tracking
+	// Subscribe to sensor updates for position tracking, only the triggers the conductor attributes to us
 
 	train_switch_to_mode(&train_data, TRAIN_MODE_WAYPOINT);
 
-	marklin_error_t sub_result =
-		Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &train_data.sensor_subscription);
+	marklin_error_t sub_result = Marklin_MsgQueue_SubscribeKeyed(
+		MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, train_data.train_id, &train_data.sensor_subscription);
 	if (sub_result == MARKLIN_ERROR_OK) {
 		train_data.sensor_subscription_active = true;
 		log_info("Train %d: Subscribed to sensor updates", train_data.train_id);
@@ -1261,11 +1266,18 @@ void __noreturn marklin_train_task(void)
 		log_error("Train %d: Failed to subscribe to sensor updates: %d", train_data.train_id, sub_result);
 	}
 
+	// Commands, sensor updates and the loop deadline are all waited on together
+	marklin_error_t waiter_result = Marklin_MsgQueue_WaiterInit(&train_data.waiter);
+	if (waiter_result != MARKLIN_ERROR_OK) {
+		log_error("Train %d: Failed to set up the wait courier: %d", train_data.train_id, waiter_result);
+	}
+
 	// Calculate initial expected sensors
 	train_calculate_next_sensors(&train_data);
 
 	train_autonomous_loop(&train_data);
 
+	Marklin_MsgQueue_WaiterDestroy(&train_data.waiter);
 	Exit();
 	UNREACHABLE();
 }
@@ -1274,6 +1286,26 @@ void __noreturn marklin_train_task(void)
 // # Position Reporting Functions
 // ############################################################################
 
+bool train_position_report_due(const marklin_train_position_data_t *last, const marklin_train_position_data_t *position,
+			       u64 last_tick, u64 now_tick)
+{
+	if (now_tick - last_tick >= TRAIN_POSITION_REPORT_MAX_STALE_TICKS) {
+		return true;
+	}
+
+	kinematic_distance_t moved_mm = position->location_offset_mm - last->location_offset_mm;
+	if (moved_mm >= TRAIN_POSITION_REPORT_MIN_DELTA_MM || moved_mm <= -TRAIN_POSITION_REPORT_MIN_DELTA_MM) {
+		return true;
+	}
+
+	return position->current_location != last->current_location || position->direction != last->direction ||
+	       position->headlight != last->headlight || position->current_speed != last->current_speed ||
+	       position->destination != last->destination || position->mode != last->mode ||
+	       position->destination_offset_mm != last->destination_offset_mm || position->status != last->status ||
+	       position->next_sensor_1 != last->next_sensor_1 || position->next_sensor_2 != last->next_sensor_2 ||
+	       strcmp(position->destination_name, last->destination_name) != 0;
+}
+
 static void train_position_report(train_task_data_t *data)
 {
 	marklin_train_position_data_t position_data = {
@@ -1292,15 +1324,111 @@ static void train_position_report(train_task_data_t *data)
 	};
 	strncpy(position_data.destination_name, data->destination_name, 15);
 	position_data.destination_name[15] = '\0';
-	Marklin_MsgQueue_PublishTyped(MARKLIN_MSGQUEUE_EVENT_TYPE_TRAIN_POSITION, &position_data);
+
+	clock_time_t now;
+	GetClockTime(&now);
+
+	if (data->position_reports > 0 && !train_position_report_due(&data->last_position_report, &position_data,
+								    data->last_position_report_tick, now.ticks)) {
+		data->position_reports_suppressed++;
+		return;
+	}
+
+	position_data.sequence = ++data->position_reports;
+	Marklin_MsgQueue_PublishKeyedTyped(MARKLIN_MSGQUEUE_EVENT_TYPE_TRAIN_POSITION, data->train_id, &position_data);
+
+	data->last_position_report = position_data;
+	data->last_position_report_tick = now.ticks;
 }
 
 // ############################################################################
 // # Main Autonomous Loop
 // ############################################################################
 
+// Handle a command sent to the train task and reply with the result
+static void train_handle_command(train_task_data_t *data, int sender_tid, const marklin_train_command_t *command)
+{
+	marklin_error_t cmd_result = MARKLIN_ERROR_OK;
+
+	if (!train_is_command_valid_for_mode(data->operating_mode, command->command_type)) {
+		log_info("Train %d: Invalid command %d for mode %d", data->train_id, command->command_type,
+			 data->operating_mode);
+		cmd_result = MARKLIN_ERROR_INVALID_ARGUMENT;
+	} else {
+		log_info("Train %d: Received command %d from %d", data->train_id, command->command_type, sender_tid);
+		switch (command->command_type) {
+		case MARKLIN_TRAIN_CMD_SET_MODE:
+			cmd_result = train_handle_mode_command(data, command);
+			break;
+
+		case MARKLIN_TRAIN_CMD_MANUAL_SET_EFFECTIVE_SPEED:
+		case MARKLIN_TRAIN_CMD_MANUAL_TOGGLE_HEADLIGHT:
+		case MARKLIN_TRAIN_CMD_MANUAL_STOP:
+			cmd_result = train_handle_manual_command(data, command);
+			break;
+
+		case MARKLIN_TRAIN_CMD_MANUAL_REVERSE:
+			// Route to appropriate handler based on mode
+			if (data->operating_mode == TRAIN_MODE_MANUAL) {
+				cmd_result = train_handle_manual_command(data, command);
+			} else if (data->operating_mode == TRAIN_MODE_WAYPOINT) {
+				cmd_result = train_handle_waypoint_command(data, command);
+			}
+			break;
+
+		case MARKLIN_TRAIN_CMD_SET_REQUESTED_SPEED:
+		case MARKLIN_TRAIN_CMD_SET_DESTINATION:
+			cmd_result = train_handle_waypoint_command(data, command);
+			break;
+
+		case MARKLIN_TRAIN_CMD_EMERGENCY_STOP:
+			cmd_result = train_handle_emergency_command(data, command);
+			break;
+
+		case MARKLIN_TRAIN_CMD_NAVIGATE_TO_DESTINATION:
+			cmd_result = train_navigate_to_destination(
+				data, command->navigate_to_destination.destination_name,
+				command->navigate_to_destination.requested_speed);
+			break;
+
+		// Random destination mode command
+		case MARKLIN_TRAIN_CMD_SET_RANDOM_DESTINATION_MODE:
+			cmd_result = train_handle_waypoint_command(data, command);
+			break;
+
+		// Debug command
+		case MARKLIN_TRAIN_CMD_DEBUG_INFO:
+			cmd_result = train_handle_debug_command(data, command);
+			break;
+
+		// Clear destination command
+		case MARKLIN_TRAIN_CMD_CLEAR_DESTINATION:
+			cmd_result = train_clear_destination(data);
+			break;
+
+		default:
+			cmd_result = MARKLIN_ERROR_INVALID_ARGUMENT;
+			break;
+		}
+	}
+
+	Reply(sender_tid, (const char *)&cmd_result, sizeof(cmd_result));
+}
+
+// Stopped with nothing to do: no state machine work, motion, path or timed retry pending
+static bool train_is_idle(const train_task_data_t *data)
+{
+	return data->state_machine.current_state == TRAIN_STATE_IDLE && !data->state_machine.event_pending &&
+	       data->motion.commanded_speed == 0 && !data->motion.is_accelerating && !data->has_active_path &&
+	       !data->needs_path_continuation && !data->random_destination_enabled && !data->in_retry_backoff;
+}
+
 static void train_autonomous_loop(train_task_data_t *data)
 {
+	// Sensor update received while waiting at the end of the previous iteration
+	marklin_msgqueue_message_t message;
+	marklin_error_t msg_result = MARKLIN_ERROR_NOT_FOUND;
+
 	for (;;) {
 		// 1. Update state machine - process any pending events first
 		train_state_machine_update(data);
@@ -1311,18 +1439,13 @@ static void train_autonomous_loop(train_task_data_t *data)
 		// 2a. Ensure we always own the block we're currently in
 		train_ensure_current_block_reserved(data);
 
-		// 3. Poll sensor updates (non-blocking) and generate events
-		if (data->sensor_subscription_active) {
-			marklin_msgqueue_message_t message;
-			marklin_error_t msg_result = Marklin_MsgQueue_ReceiveNonBlock(&message);
-
-			if (msg_result == MARKLIN_ERROR_OK &&
-			    message.event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE) {
-				train_process_sensor_update(data, &message);
-				// Generate sensor trigger event for state machine
-				train_state_machine_process_event(data, TRAIN_EVENT_SENSOR_TRIGGERED);
-			}
+		// 3. Handle the sensor update that ended the last wait and generate events
+		if (msg_result == MARKLIN_ERROR_OK && message.event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE) {
+			train_process_sensor_update(data, &message);
+			// Generate sensor trigger event for state machine
+			train_state_machine_process_event(data, TRAIN_EVENT_SENSOR_TRIGGERED);
 		}
+		msg_result = MARKLIN_ERROR_NOT_FOUND;
 
 		// 4. Update stopping distance
 		train_update_stop_distance(data);
@@ -1362,82 +1485,32 @@ static void train_autonomous_loop(train_task_data_t *data)
 		// 7. Broadcast position
 		train_position_report(data);
 
-		// 8. Handle interactive commands (non-blocking receive)
+		train_check_block_safety_conditions(data);
+
+		// 8. Sleep until a command, a sensor update or the next update is due. A moving train updates every
+		// tick, an idle one only reports its position now and then.
+		clock_time_t now;
+		GetClockTime(&now);
+		u32 wake_tick = (u32)now.ticks + (train_is_idle(data) ? TRAIN_IDLE_WAKE_TICKS : 1);
+
 		marklin_train_command_t command;
+		int command_size = sizeof(command);
 		int sender_tid;
-		int result = ReceiveNonBlock(&sender_tid, (char *)&command, sizeof(command));
-		if (result == sizeof(command)) {
-			marklin_error_t cmd_result = MARKLIN_ERROR_OK;
-
-			if (!train_is_command_valid_for_mode(data->operating_mode, command.command_type)) {
-				log_info("Train %d: Invalid command %d for mode %d", data->train_id,
-					 command.command_type, data->operating_mode);
-				cmd_result = MARKLIN_ERROR_INVALID_ARGUMENT;
+		int source = Marklin_MsgQueue_Wait(&data->waiter, wake_tick, &sender_tid, &command, &command_size,
+						   &message);
+
+		if (source == MARKLIN_MSGQUEUE_WAIT_MESSAGE) {
+			if (command_size == sizeof(command)) {
+				train_handle_command(data, sender_tid, &command);
 			} else {
-				log_info("Train %d: Received command %d from %d", data->train_id, command.command_type,
-					 sender_tid);
-				switch (command.command_type) {
-				case MARKLIN_TRAIN_CMD_SET_MODE:
-					cmd_result = train_handle_mode_command(data, &command);
-					break;
-
-				case MARKLIN_TRAIN_CMD_MANUAL_SET_EFFECTIVE_SPEED:
-				case MARKLIN_TRAIN_CMD_MANUAL_TOGGLE_HEADLIGHT:
-				case MARKLIN_TRAIN_CMD_MANUAL_STOP:
-					cmd_result = train_handle_manual_command(data, &command);
-					break;
-
-				case MARKLIN_TRAIN_CMD_MANUAL_REVERSE:
-					// Route to appropriate handler based on mode
-					if (data->operating_mode == TRAIN_MODE_MANUAL) {
-						cmd_result = train_handle_manual_command(data, &command);
-					} else if (data->operating_mode == TRAIN_MODE_WAYPOINT) {
-						cmd_result = train_handle_waypoint_command(data, &command);
-					}
-					break;
-
-				case MARKLIN_TRAIN_CMD_SET_REQUESTED_SPEED:
-				case MARKLIN_TRAIN_CMD_SET_DESTINATION:
-					cmd_result = train_handle_waypoint_command(data, &command);
-					break;
-
-				case MARKLIN_TRAIN_CMD_EMERGENCY_STOP:
-					cmd_result = train_handle_emergency_command(data, &command);
-					break;
-
-				case MARKLIN_TRAIN_CMD_NAVIGATE_TO_DESTINATION:
-					cmd_result = train_navigate_to_destination(
-						data, command.navigate_to_destination.destination_name,
-						command.navigate_to_destination.requested_speed);
-					break;
-
-				// Random destination mode command
-				case MARKLIN_TRAIN_CMD_SET_RANDOM_DESTINATION_MODE:
-					cmd_result = train_handle_waypoint_command(data, &command);
-					break;
-
-				// Debug command
-				case MARKLIN_TRAIN_CMD_DEBUG_INFO:
-					cmd_result = train_handle_debug_command(data, &command);
-					break;
-
-				// Clear destination command
-				case MARKLIN_TRAIN_CMD_CLEAR_DESTINATION:
-					cmd_result = train_clear_destination(data);
-					break;
-
-				default:
-					cmd_result = MARKLIN_ERROR_INVALID_ARGUMENT;
-					break;
-				}
+				marklin_error_t cmd_result = MARKLIN_ERROR_INVALID_ARGUMENT;
+				Reply(sender_tid, (const char *)&cmd_result, sizeof(cmd_result));
 			}
-
-			Reply(sender_tid, (const char *)&cmd_result, sizeof(cmd_result));
+		} else if (source == MARKLIN_MSGQUEUE_WAIT_EVENT) {
+			msg_result = MARKLIN_ERROR_OK;
+		} else if (source < 0) {
+			Delay(data->clock_server_tid, 1);
 		}
-
-		train_check_block_safety_conditions(data);
-
-		Delay(data->clock_server_tid, 1); // 20ms loop interval
 	}
 }
 
@@ -1745,7 +1818,7 @@ marklin_error_t train_set_speed_and_headlight(train_task_data_t *data, u8 speed,
 	}
 
 	marklin_error_t result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, cmd, param,
-								     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+								     MARKLIN_TRAIN_CMD_DELAY_US,
 								     MARKLIN_CMD_PRIORITY_HIGH, data->train_id);
 	log_info("Train %d: Set speed to %d with headlight %d", data->train_id, speed, headlight);
 	if (result == MARKLIN_ERROR_OK) {
@@ -1783,7 +1856,7 @@ marklin_error_t train_reverse(train_task_data_t *data)
 
 	marklin_error_t result = Marklin_ScheduleCommandWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM,
 								     MARKLIN_REVERSE_CMD + 16, data->train_id,
-								     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+								     MARKLIN_TRAIN_CMD_DELAY_US,
 								     MARKLIN_CMD_PRIORITY_HIGH, data->train_id);
 	if (result == MARKLIN_ERROR_OK) {
 		data->motion.commanded_speed = 0;
@@ -1858,7 +1931,7 @@ marklin_error_t train_stop(train_task_data_t *data)
 	}
 
 	// Block release will be handled by unified cleanup when train transitions to IDLE
-	Delay(data->clock_server_tid, MS_TO_TICK(stop_time_ms));
+	DelayUs((u64)stop_time_ms * 1000);
 
 	return MARKLIN_ERROR_OK;
 }
@@ -1870,16 +1943,16 @@ marklin_error_t train_force_stop(train_task_data_t *data)
 	}
 
 	marklin_error_t result = Marklin_ScheduleCommandBlockingWithPriority(
-		MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16, data->train_id, MARKLIN_TRAIN_CMD_DELAY_TICKS,
+		MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16, data->train_id, MARKLIN_TRAIN_CMD_DELAY_US,
 		MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, 1 + 16, data->train_id,
-							     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+							     MARKLIN_TRAIN_CMD_DELAY_US,
 							     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, 0 + 16, data->train_id,
-							     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+							     MARKLIN_TRAIN_CMD_DELAY_US,
 							     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16,
-							     data->train_id, MARKLIN_TRAIN_CMD_DELAY_TICKS,
+							     data->train_id, MARKLIN_TRAIN_CMD_DELAY_US,
 							     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 
 	// Set immediate stop flags
@@ -1904,13 +1977,13 @@ marklin_error_t train_emergency_stop(train_task_data_t *data)
 
 	// Use reverse command with CRITICAL priority for immediate hard stop
 	marklin_error_t result = Marklin_ScheduleCommandBlockingWithPriority(
-		MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16, data->train_id, MARKLIN_TRAIN_CMD_DELAY_TICKS,
+		MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16, data->train_id, MARKLIN_TRAIN_CMD_DELAY_US,
 		MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, 1 + 16, data->train_id,
-							     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+							     MARKLIN_TRAIN_CMD_DELAY_US,
 							     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, 0 + 16, data->train_id,
-							     MARKLIN_TRAIN_CMD_DELAY_TICKS,
+							     MARKLIN_TRAIN_CMD_DELAY_US,
 							     MARKLIN_CMD_PRIORITY_CRITICAL, data->train_id);
 	result = Marklin_ScheduleCommandBlockingWithPriority(MARKLIN_CMD_TYPE_WITH_PARAM, MARKLIN_REVERSE_CMD + 16,
 							     data->train_id, 0, MARKLIN_CMD_PRIORITY_CRITICAL,
@@ -2088,14 +2161,15 @@ static void train_calculate_next_sensors(train_task_data_t *data)
 		data->motion.sensor_timeout_logged[0] = false;
 		data->motion.sensor_timeout_logged[1] = false;
 		data->motion.expected_sensor_count = 0;
+		Marklin_ClearExpectedSensors(data->train_id);
 		return;
 	}
 
-	// Query the conductor for next two sensors (it knows switch states)
-	marklin_error_t result = Marklin_GetNextTwoSensors(data->motion.current_position.sensor,
-							   TRAIN_DIRECTION_FORWARD, data->motion.expected_sensors,
-							   data->motion.expected_distances,
-							   &data->motion.expected_sensor_count);
+	// Query the conductor for next two sensors (it knows switch states). It routes their triggers to us.
+	marklin_error_t result = Marklin_ExpectNextTwoSensors(data->train_id, data->motion.current_position.sensor,
+							      TRAIN_DIRECTION_FORWARD, data->motion.expected_sensors,
+							      data->motion.expected_distances,
+							      &data->motion.expected_sensor_count);
 
 	if (result != MARKLIN_ERROR_OK) {
 		log_error("Train %d: Failed to get next sensors from conductor: %d", data->train_id, result);
@@ -2609,6 +2683,7 @@ static void train_check_sensor_timeouts(train_task_data_t *data)
 		data->motion.sensor_timeout_logged[0] = false;
 		data->motion.sensor_timeout_logged[1] = false;
 		data->motion.expected_sensor_count = 0;
+		Marklin_ClearExpectedSensors(data->train_id);
 	}
 }
 
@@ -14,6 +14,7 @@
 #include "marklin/controller/api.h"
 #include "io.h"
 #include "name.h"
+#include "params.h"
 #include <stdarg.h>
 
 #define LOG_MODULE "TUI"
@@ -24,6 +25,7 @@ static tui_state_t tui_state;
 
 // Function prototypes for internal functions
 static void tui_update_track_panel(void);
+static void tui_update_top_panel(u64 current_time_tick);
 void tui_record_sensor_trigger(u8 bank, u8 sensor_num);
 static void tui_console_output(const char *msg);
 static void tui_process_shell_command(void);
@@ -31,6 +33,11 @@ static void tui_process_command(const char *command);
 static void tui_process_block_reservation_update(const marklin_msgqueue_message_t *message);
 static void tui_init_block_status(void);
 static void tui_display_block_reservations(void);
+static void tui_display_ipc_latency(int tid);
+static void tui_handle_profile_command(const char *args);
+static void tui_display_irq_latency(bool reset);
+static void tui_display_snapshot_stats(void);
+static void tui_dump_trace(void);
 
 // Frame buffer functions
 static void frame_buffer_init(void);
@@ -44,16 +51,19 @@ static char parse_char(const char *str, int *pos);
 // Buffer for each panel
 #define STATUS_BUFFER_SIZE 512
 #define INPUT_BUFFER_SIZE 256
-#define TRACK_BUFFER_SIZE 2048
+#define TRACK_BUFFER_SIZE 4096 // A full train table row is over 100 bytes of UTF-8
+#define TOP_BUFFER_SIZE 2048
 
 static char status_buffer[STATUS_BUFFER_SIZE];
 static char input_buffer[INPUT_BUFFER_SIZE];
 static char track_buffer[TRACK_BUFFER_SIZE];
+static char top_buffer[TOP_BUFFER_SIZE];
 
 // Buffers to track last drawn state
 static char status_last_buffer[STATUS_BUFFER_SIZE];
 static char input_last_buffer[INPUT_BUFFER_SIZE];
 static char track_last_buffer[TRACK_BUFFER_SIZE];
+static char top_last_buffer[TOP_BUFFER_SIZE];
 
 // Frame buffer for batched terminal output
 #define FRAME_BUFFER_SIZE 8192
@@ -97,6 +107,19 @@ static u64 last_status_update_time = 0; // Last time status was updated
 static char cached_time_str[32] = { 0 }; // Cached time string
 static u8 track_panel_needs_update = 1; // Flag to track when track panel needs updating
 
+// Top panel: busiest tasks by CPU time since the previous refresh
+#define TUI_TOP_UPDATE_INTERVAL_MS 1000
+static task_stats_t top_stats[MAX_TASKS];
+static u64 top_prev_run_time[MAX_TASKS]; // Run time at the previous refresh, indexed by TID
+static u64 top_last_update_tick = 0;
+
+// Track panel snapshot, kept between refreshes so the controller only sends what changed
+static marklin_system_snapshot_t track_snapshot;
+static u32 snapshot_refreshes = 0; // Refreshes since the last "snap" command
+static u64 snapshot_bytes = 0; // Reply bytes copied by those refreshes
+static u64 snapshot_stats_tick = 0;
+static u64 snapshot_controller_run_us = 0; // Controller run time at the last "snap" command
+
 // Block reservation tracking
 #define MAX_BLOCKS 30
 typedef struct {
@@ -262,6 +285,10 @@ void tui_init(void)
 		track_buffer[i] = 0;
 		track_last_buffer[i] = 0;
 	}
+	for (int i = 0; i < TOP_BUFFER_SIZE; i++) {
+		top_buffer[i] = 0;
+		top_last_buffer[i] = 0;
+	}
 
 	// Status panel (top)
 	tui_setup_panels(TUI_PANEL_STATUS, 0, 1, TUI_SCREEN_WIDTH, 3, TUI_STYLE_BORDER, status_buffer,
@@ -275,8 +302,12 @@ void tui_init(void)
 	tui_setup_panels(TUI_PANEL_INPUT, 0, 20, TUI_SCREEN_WIDTH, 3, TUI_STYLE_BORDER, input_buffer, INPUT_BUFFER_SIZE,
 			 0, input_last_buffer, "Command Input");
 
-	// Set console output start position (below input panel)
-	console_output_start_y = 23;
+	// Top panel (below input panel, sharing bottom border with input)
+	tui_setup_panels(TUI_PANEL_TOP, 0, 22, TUI_SCREEN_WIDTH, 12, TUI_STYLE_BORDER, top_buffer, TOP_BUFFER_SIZE, 0,
+			 top_last_buffer, "Top Tasks");
+
+	// Set console output start position (below top panel)
+	console_output_start_y = 34;
 	console_output_current_y = console_output_start_y;
 
 	tui_state.input_pos = 0;
@@ -713,6 +744,11 @@ void tui_show_help(void)
 	tui_console_output("  reset <A/B> - Reset the track with type A or B");
 	tui_console_output("  allsw <S/C> - Set all single switches");
 	tui_console_output("  blocks - Display current block reservations");
+	tui_console_output("  trace - Dump the kernel trace ring as hex");
+	tui_console_output("  lat <tid> - Show IPC queue/service latency histograms of a server");
+	tui_console_output("  prof <start [us]|stop|reset|report [n]> - Sampling profiler");
+	tui_console_output("  irqlat [reset] - Show interrupt entry/wakeup latency per IRQ source");
+	tui_console_output("  snap - Show snapshot bytes per refresh and controller CPU since the last snap");
 	tui_console_output("  go - Start the demo function");
 	tui_console_output("  q - Quit and reboot");
 	tui_console_output("");
@@ -1444,6 +1480,23 @@ static void tui_process_command(const char *command)
 	} else if (strcmp(command, "blocks") == 0) {
 		// Display block reservations command
 		tui_display_block_reservations();
+	} else if (strncmp(command, "lat ", 4) == 0) {
+		// IPC latency histogram command: lat <tid>
+		int pos = 4;
+		int tid = parse_int(command, &pos);
+		tui_display_ipc_latency(tid);
+	} else if (strcmp(command, "irqlat") == 0 || strcmp(command, "irqlat reset") == 0) {
+		// Interrupt latency command: irqlat [reset]
+		tui_display_irq_latency(command[6] != '\0');
+	} else if (strncmp(command, "prof ", 5) == 0) {
+		// Sampling profiler command: prof <start [us]|stop|reset|report [n]>
+		tui_handle_profile_command(&command[5]);
+	} else if (strcmp(command, "snap") == 0) {
+		// Snapshot cost command: bytes per track panel refresh and controller CPU share
+		tui_display_snapshot_stats();
+	} else if (strcmp(command, "trace") == 0) {
+		// Kernel trace dump command: the most recent records, as hex through the IO server
+		tui_dump_trace();
 	} else if (strcmp(command, "q") == 0) {
 		// Quit command
 		tui_console_output("Shutting down and rebooting...");
@@ -1511,6 +1564,285 @@ void tui_mark_track_panel_for_update(void)
 	track_panel_needs_update = 1;
 }
 
+// Refresh the top panel with the tasks that used the most CPU since the previous refresh
+static void tui_update_top_panel(u64 current_time_tick)
+{
+	if (top_last_update_tick != 0 &&
+	    current_time_tick - top_last_update_tick < MS_TO_TICK(TUI_TOP_UPDATE_INTERVAL_MS)) {
+		return;
+	}
+	top_last_update_tick = current_time_tick;
+
+	int count = GetTaskStats(-1, top_stats, MAX_TASKS);
+	if (count <= 0) {
+		return;
+	}
+
+	// Every microsecond is charged to some task, idle included, so the deltas sum to the elapsed time
+	u64 deltas[MAX_TASKS];
+	u64 total = 0;
+	for (int i = 0; i < count; i++) {
+		int tid = top_stats[i].tid;
+		u64 prev = top_prev_run_time[tid];
+		// A smaller run time means the TID was recycled by a new task
+		deltas[i] = top_stats[i].run_time_us >= prev ? top_stats[i].run_time_us - prev : top_stats[i].run_time_us;
+		top_prev_run_time[tid] = top_stats[i].run_time_us;
+		total += deltas[i];
+	}
+
+	tui_panel_t *panel = &tui_state.panels[TUI_PANEL_TOP];
+	panel->buffer_pos = 0;
+
+	char line[TUI_SCREEN_WIDTH];
+	snprintf(line, sizeof(line), "%-4s %-3s %-32s %6s %10s %10s %10s %10s %10s", "TID", "PRI", "TASK", "CPU%",
+		 "DISPATCH", "VOLUNTARY", "PREEMPTED", "SENDS", "RECEIVES");
+	tui_panel_add_message(TUI_PANEL_TOP, line);
+
+	// Partial selection sort: pick the busiest tasks that fit in the panel
+	int rows = panel->height - 3;
+	for (int row = 0; row < rows && row < count; row++) {
+		int busiest = row;
+		for (int i = row + 1; i < count; i++) {
+			if (deltas[i] > deltas[busiest]) {
+				busiest = i;
+			}
+		}
+
+		task_stats_t tmp_stats = top_stats[row];
+		top_stats[row] = top_stats[busiest];
+		top_stats[busiest] = tmp_stats;
+		u64 tmp_delta = deltas[row];
+		deltas[row] = deltas[busiest];
+		deltas[busiest] = tmp_delta;
+
+		task_stats_t *stats = &top_stats[row];
+		u32 cpu_x10 = total ? (u32)(deltas[row] * 1000 / total) : 0;
+		snprintf(line, sizeof(line), "%-4d %-3d %-32s %4u.%u %10u %10u %10u %10u %10u", stats->tid,
+			 stats->priority, stats->name, cpu_x10 / 10, cpu_x10 % 10, stats->dispatches,
+			 stats->voluntary_switches, stats->preemptions, stats->sends, stats->receives);
+		tui_panel_add_message(TUI_PANEL_TOP, line);
+	}
+
+	tui_mark_panel_dirty(TUI_PANEL_TOP);
+}
+
+// Display the IPC latency histograms of a server task
+static void tui_display_ipc_latency(int tid)
+{
+	ipc_latency_t latency;
+	char line[TUI_SCREEN_WIDTH];
+
+	if (tid < 0 || GetIpcLatency(tid, &latency, 0) < 0) {
+		tui_console_output("Usage: lat <tid>");
+		return;
+	}
+
+	snprintf(line, sizeof(line), "IPC latency for task %d:", tid);
+	tui_console_output(line);
+	tui_console_output("  >= ns          queue      service");
+
+	bool any = false;
+	for (int b = 0; b < IPC_LATENCY_BUCKETS; b++) {
+		if (latency.queue[b] || latency.service[b]) {
+			snprintf(line, sizeof(line), "  %-10u %10u %12u", 1U << b, latency.queue[b], latency.service[b]);
+			tui_console_output(line);
+			any = true;
+		}
+	}
+
+	if (!any) {
+		tui_console_output("  (no messages served)");
+	}
+}
+
+// Display the interrupt latency of every IRQ source as percentiles of its histograms
+static void tui_display_irq_latency(bool reset)
+{
+	static const char *source_names[IRQ_LATENCY_SOURCES] = { "tick", "hrtimer", "uart0", "uart3", "other" };
+	irq_latency_t latency[IRQ_LATENCY_SOURCES];
+	char line[TUI_SCREEN_WIDTH];
+
+	if (GetIrqLatency(latency, IRQ_LATENCY_SOURCES, reset) < 0) {
+		tui_console_output("Failed to read IRQ latency");
+		return;
+	}
+
+	// Bucket lower bounds, so p50/p99 read as ">= value"
+	tui_console_output("  source      irqs  entry p50/p99/max ns      wakes  wake p50/p99/max ns");
+	for (int s = 0; s < IRQ_LATENCY_SOURCES; s++) {
+		const irq_latency_t *l = &latency[s];
+		u32 entry_p50 = 0, entry_p99 = 0, wake_p50 = 0, wake_p99 = 0;
+		u32 entry_seen = 0, wake_seen = 0;
+
+		for (int b = 0; b < IRQ_LATENCY_BUCKETS; b++) {
+			entry_seen += l->entry[b];
+			wake_seen += l->wake[b];
+			if (!entry_p50 && l->count && entry_seen * 2 >= l->count) {
+				entry_p50 = 1U << b;
+			}
+			if (!entry_p99 && l->count && (u64)entry_seen * 100 >= (u64)l->count * 99) {
+				entry_p99 = 1U << b;
+			}
+			if (!wake_p50 && l->wakeups && wake_seen * 2 >= l->wakeups) {
+				wake_p50 = 1U << b;
+			}
+			if (!wake_p99 && l->wakeups && (u64)wake_seen * 100 >= (u64)l->wakeups * 99) {
+				wake_p99 = 1U << b;
+			}
+		}
+
+		snprintf(line, sizeof(line), "  %-8s %7u  %7u/%7u/%8u  %7u  %7u/%7u/%8u", source_names[s], l->count,
+			 entry_p50, entry_p99, l->entry_max_ns, l->wakeups, wake_p50, wake_p99, l->wake_max_ns);
+		tui_console_output(line);
+	}
+
+	if (reset) {
+		tui_console_output("IRQ latency histograms cleared");
+	}
+}
+
+// Display the average bytes each track panel refresh copied from the controller and the controller's CPU share,
+// both since the previous call
+static void tui_display_snapshot_stats(void)
+{
+	char line[TUI_SCREEN_WIDTH];
+	task_stats_t stats;
+
+	u64 now_tick = Time(clock_server_tid);
+	int controller_tid = WhoIs(MARKLIN_CONTROLLER_SERVER_NAME);
+	if (controller_tid < 0 || GetTaskStats(controller_tid, &stats, 1) != 1) {
+		tui_console_output("Failed to read controller stats");
+		return;
+	}
+
+	u64 elapsed_us = TICK_TO_MS(now_tick - snapshot_stats_tick) * 1000;
+	u64 run_us = stats.run_time_us >= snapshot_controller_run_us ? stats.run_time_us - snapshot_controller_run_us :
+								       stats.run_time_us;
+	u32 cpu_x100 = elapsed_us ? (u32)(run_us * 10000 / elapsed_us) : 0;
+	u32 avg_bytes = snapshot_refreshes ? (u32)(snapshot_bytes / snapshot_refreshes) : 0;
+
+	snprintf(line, sizeof(line), "Snapshot refreshes: %u, avg %u bytes (full snapshot %u bytes)", snapshot_refreshes,
+		 avg_bytes, (u32)sizeof(marklin_system_snapshot_t));
+	tui_console_output(line);
+	snprintf(line, sizeof(line), "Controller CPU: %u.%02u%% over %u ms", cpu_x100 / 100, cpu_x100 % 100,
+		 (u32)(elapsed_us / 1000));
+	tui_console_output(line);
+
+	snapshot_refreshes = 0;
+	snapshot_bytes = 0;
+	snapshot_stats_tick = now_tick;
+	snapshot_controller_run_us = stats.run_time_us;
+}
+
+// Records in a TUI trace dump, and how many are written to the IO server before waiting for the line to drain.
+// A chunk is ~2KB of hex, well inside the IO server's console buffer and ~180ms at 115200 baud.
+#define TUI_TRACE_DUMP_RECORDS 1024
+#define TUI_TRACE_DUMP_CHUNK_RECORDS 64
+#define TUI_TRACE_DUMP_CHUNK_DELAY_TICKS 20
+
+static void tui_append_hex(char *out, const void *data, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const u8 *bytes = data;
+
+	for (size_t i = 0; i < len; i++) {
+		*out++ = hex[bytes[i] >> 4];
+		*out++ = hex[bytes[i] & 0xf];
+	}
+	*out = '\0';
+}
+
+// Dump the most recent kernel trace records in the KTRACE-BEGIN/KTRACE-END hex format of the kernel's console
+// dump. The kernel only copies the records out; they go to the console in chunks while everything else keeps
+// running, instead of the kernel writing the whole ring with IRQs masked.
+static void tui_dump_trace(void)
+{
+	static u8 dump[sizeof(struct ktrace_dump_header) + TUI_TRACE_DUMP_RECORDS * sizeof(struct ktrace_record)];
+	static char chunk[TUI_TRACE_DUMP_CHUNK_RECORDS * (2 + 2 * sizeof(struct ktrace_record)) + 1];
+
+	if (TraceDump(dump, sizeof(dump)) < 0) {
+		tui_console_output("Failed to dump kernel trace");
+		return;
+	}
+
+	const struct ktrace_dump_header *header = (const struct ktrace_dump_header *)dump;
+	const struct ktrace_record *records = (const struct ktrace_record *)(header + 1);
+
+	console_puts("\r\nKTRACE-BEGIN\r\n");
+	tui_append_hex(chunk, header, sizeof(*header));
+	console_puts(chunk);
+
+	for (u32 first = 0; first < header->count; first += TUI_TRACE_DUMP_CHUNK_RECORDS) {
+		char *out = chunk;
+		for (u32 i = first; i < header->count && i < first + TUI_TRACE_DUMP_CHUNK_RECORDS; i++) {
+			*out++ = '\r';
+			*out++ = '\n';
+			tui_append_hex(out, &records[i], sizeof(records[i]));
+			out += 2 * sizeof(records[i]);
+		}
+
+		console_puts(chunk);
+		Delay(clock_server_tid, TUI_TRACE_DUMP_CHUNK_DELAY_TICKS);
+	}
+
+	console_puts("\r\nKTRACE-END\r\n");
+}
+
+// Control the kernel sampling profiler and show its flat profile
+static void tui_handle_profile_command(const char *args)
+{
+	char line[TUI_SCREEN_WIDTH];
+	int pos;
+
+	if (strncmp(args, "start", 5) == 0) {
+		pos = 5;
+		int period_us = parse_int(args, &pos);
+		if (Profile(PROFILE_START, period_us > 0 ? period_us : 0, NULL) < 0) {
+			snprintf(line, sizeof(line), "Failed to start profiler (minimum period %d us)",
+				 PROFILE_MIN_PERIOD_US);
+			tui_console_output(line);
+			return;
+		}
+		snprintf(line, sizeof(line), "Profiler sampling every %d us",
+			 period_us > 0 ? period_us : PROFILE_DEFAULT_PERIOD_US);
+		tui_console_output(line);
+	} else if (strcmp(args, "stop") == 0) {
+		Profile(PROFILE_STOP, 0, NULL);
+		tui_console_output("Profiler stopped");
+	} else if (strcmp(args, "reset") == 0) {
+		Profile(PROFILE_RESET, 0, NULL);
+		tui_console_output("Profiler samples cleared");
+	} else if (strncmp(args, "report", 6) == 0) {
+		static profile_report_t report;
+
+		pos = 6;
+		int max_entries = parse_int(args, &pos);
+		int count = Profile(PROFILE_REPORT, max_entries > 0 ? max_entries : 10, &report);
+		if (count < 0) {
+			tui_console_output("Failed to read profile");
+			return;
+		}
+
+		snprintf(line, sizeof(line), "Profile: %u samples every %u us, %u dropped, %u functions%s",
+			 report.samples, report.period_us, report.dropped, report.functions,
+			 report.running ? " (running)" : "");
+		tui_console_output(line);
+		if (report.samples == 0) {
+			return;
+		}
+
+		tui_console_output("     %     hits  function");
+		for (int i = 0; i < count; i++) {
+			u32 pct_x10 = (u32)((u64)report.entries[i].hits * 1000 / report.samples);
+			snprintf(line, sizeof(line), "  %3u.%u %8u  %s", pct_x10 / 10, pct_x10 % 10,
+				 report.entries[i].hits, report.entries[i].name);
+			tui_console_output(line);
+		}
+	} else {
+		tui_console_output("Usage: prof <start [us]|stop|reset|report [n]>");
+	}
+}
+
 // Display current block reservation status
 static void tui_display_block_reservations(void)
 {
@@ -1621,13 +1953,16 @@ void tui_update_track_panel(void)
 	int usable_height = panel->height - 2;
 	int lines_used = 0;
 
-	// Get system snapshot to display train information
-	marklin_system_snapshot_t system_snapshot = { 0 };
-	marklin_error_t snapshot_result = Marklin_ControllerGetSystemSnapshot(&system_snapshot);
+	// Bring the system snapshot up to date to display train information
+	marklin_error_t snapshot_result = Marklin_ControllerUpdateSystemSnapshot(&track_snapshot);
+	if (snapshot_result == MARKLIN_ERROR_OK) {
+		snapshot_refreshes++;
+		snapshot_bytes += track_snapshot.last_update_bytes;
+	}
 
 	char line[TUI_SCREEN_WIDTH * 4]; // Account for UTF-8 characters
-	// int max_switch_count = (snapshot_result == MARKLIN_ERROR_OK) ? system_snapshot.active_switch_count : 0;
-	int max_train_count = (snapshot_result == MARKLIN_ERROR_OK) ? system_snapshot.active_train_count : 0;
+	// int max_switch_count = (snapshot_result == MARKLIN_ERROR_OK) ? track_snapshot.active_switch_count : 0;
+	int max_train_count = (snapshot_result == MARKLIN_ERROR_OK) ? track_snapshot.active_train_count : 0;
 
 	// if (max_switch_count > 0) {
 	// 	// Build the header row with switch numbers
@@ -1657,7 +1992,7 @@ void tui_update_track_panel(void)
 	// 	for (int i = 0; i < display_switch_count && pos < (int)(sizeof(line) - 20); i++) {
 	// 		if (i < max_switch_count) {
 	// 			pos += snprintf(&line[pos], sizeof(line) - pos, "│ %3d ",
-	// 					system_snapshot.switches[i].switch_id);
+	// 					track_snapshot.switches[i].switch_id);
 	// 		} else {
 	// 			pos += snprintf(&line[pos], sizeof(line) - pos, "│  -  ");
 	// 		}
@@ -1683,7 +2018,7 @@ void tui_update_track_panel(void)
 	// 	pos = 0;
 	// 	for (int i = 0; i < display_switch_count && pos < (int)(sizeof(line) - 20); i++) {
 	// 		if (i < max_switch_count) {
-	// 			const char *dir_str = (system_snapshot.switches[i].direction == DIR_STRAIGHT) ? "S" :
+	// 			const char *dir_str = (track_snapshot.switches[i].direction == DIR_STRAIGHT) ? "S" :
 	// 													"C";
 	// 			pos += snprintf(&line[pos], sizeof(line) - pos, "│  %s  ", dir_str);
 	// 		} else {
@@ -1713,12 +2048,13 @@ void tui_update_track_panel(void)
 	// }
 
 	// Display trains in a vertical table
+	const char *empty_row = "│     │     │   │   │      │         │             │         │         │      │";
 	tui_panel_add_message(TUI_PANEL_TRACK,
-			      "┌─────┬─────┬───┬───┬──────┬─────────┬─────────────┬─────────┬─────────┐");
+			      "┌─────┬─────┬───┬───┬──────┬─────────┬─────────────┬─────────┬─────────┬──────┐");
 	tui_panel_add_message(TUI_PANEL_TRACK,
-			      "│ Trn │ Spd │ D │ L │ Mode │   Loc   │    Dest     │  Next   │  Status │");
+			      "│ Trn │ Spd │ D │ L │ Mode │   Loc   │    Dest     │  Next   │  Status │ Miss │");
 	tui_panel_add_message(TUI_PANEL_TRACK,
-			      "├─────┼─────┼───┼───┼──────┼─────────┼─────────────┼─────────┼─────────┤");
+			      "├─────┼─────┼───┼───┼──────┼─────────┼─────────────┼─────────┼─────────┼──────┤");
 	lines_used += 4;
 
 	// Limit train table rows to preserve space for sensor display
@@ -1732,14 +2068,12 @@ void tui_update_track_panel(void)
 
 	if (max_train_count == 0) {
 		// Show empty row
-		tui_panel_add_message(TUI_PANEL_TRACK,
-				      "│     │     │   │   │      │         │             │         │         │");
-		tui_panel_add_message(TUI_PANEL_TRACK,
-				      "│     │     │   │   │      │         │             │         │         │");
+		tui_panel_add_message(TUI_PANEL_TRACK, empty_row);
+		tui_panel_add_message(TUI_PANEL_TRACK, empty_row);
 		lines_used += 2;
 	} else {
 		for (int i = 0; i < max_train_count; i++) {
-			marklin_train_snapshot_t *train = &system_snapshot.trains[i];
+			marklin_train_snapshot_t *train = &track_snapshot.trains[i];
 
 			// Skip invalid trains (train_id = 0 means not spawned)
 			if (train->train_id == 0) {
@@ -1810,23 +2144,23 @@ void tui_update_track_panel(void)
 				break;
 			}
 
-			snprintf(line, TUI_SCREEN_WIDTH, "│ %3d │  %2d │ %c │ %c │ %-4s │ %-7s │ %-11s │ %-7s │ %-7s │",
-				 train->train_id, train->speed, direction, headlight, mode, location_with_offset,
-				 destination_with_offset, next_sensors, status);
+			// Miss counts position reports the controller never saw, coalesced away while it lagged
+			snprintf(line, sizeof(line),
+				 "│ %3d │  %2d │ %c │ %c │ %-4s │ %-7s │ %-11s │ %-7s │ %-7s │ %4u │", train->train_id,
+				 train->speed, direction, headlight, mode, location_with_offset,
+				 destination_with_offset, next_sensors, status, train->position_reports_missed);
 			tui_panel_add_message(TUI_PANEL_TRACK, line);
 			lines_used += 1;
 		}
 		if (max_train_count == 1) {
 			// If only one train, add an empty row for spacing
-			tui_panel_add_message(
-				TUI_PANEL_TRACK,
-				"│     │     │   │   │      │         │             │         │         │");
+			tui_panel_add_message(TUI_PANEL_TRACK, empty_row);
 			lines_used += 1;
 		}
 	}
 
 	tui_panel_add_message(TUI_PANEL_TRACK,
-			      "└─────┴─────┴───┴───┴──────┴─────────┴─────────────┴─────────┴─────────┘");
+			      "└─────┴─────┴───┴───┴──────┴─────────┴─────────────┴─────────┴─────────┴──────┘");
 	lines_used += 1;
 
 	// Add a separator
@@ -1916,6 +2250,34 @@ void tui_update_track_panel(void)
 	track_panel_needs_update = 0;
 }
 
+static void tui_process_message(marklin_msgqueue_message_t *message)
+{
+	if (message->event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE) {
+		tui_process_sensor_update(message);
+	} else if (message->event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_BLOCK_RESERVATION) {
+		tui_process_block_reservation_update(message);
+	}
+}
+
+// Sleep for one tick, woken early by message queue updates if subscribed
+static void tui_wait_for_updates(void)
+{
+	if (!sensor_subscription_active && !block_subscription_active) {
+		Delay(clock_server_tid, 1);
+		return;
+	}
+
+	marklin_msgqueue_message_t message;
+	marklin_error_t result = Marklin_MsgQueue_Receive(&message, 1);
+
+	while (result == MARKLIN_ERROR_OK) {
+		tui_process_message(&message);
+
+		// Drain whatever else arrived with it
+		result = Marklin_MsgQueue_ReceiveNonBlock(&message);
+	}
+}
+
 // Update TUI with new data
 void tui_update(void)
 {
@@ -1925,23 +2287,6 @@ void tui_update(void)
 		tui_process_input((char)c);
 	}
 
-	// Process message queue updates if subscribed
-	if (sensor_subscription_active || block_subscription_active) {
-		marklin_msgqueue_message_t message;
-		marklin_error_t result = Marklin_MsgQueue_ReceiveNonBlock(&message);
-
-		while (result == MARKLIN_ERROR_OK) {
-			if (message.event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE) {
-				tui_process_sensor_update(&message);
-			} else if (message.event_type == MARKLIN_MSGQUEUE_EVENT_TYPE_BLOCK_RESERVATION) {
-				tui_process_block_reservation_update(&message);
-			}
-
-			// Try to get another message
-			result = Marklin_MsgQueue_ReceiveNonBlock(&message);
-		}
-	}
-
 	if (!tui_state.active) {
 		return;
 	}
@@ -1960,6 +2305,7 @@ void tui_update(void)
 
 	tui_update_status();
 	tui_update_track_panel();
+	tui_update_top_panel(current_time_tick);
 
 	tui_draw();
 	// Position cursor at input location with single IPC call (accounting for "> " prompt)
@@ -1974,7 +2320,7 @@ void marklin_tui_server_task(void)
 
 	while (1) {
 		tui_update();
-		Delay(clock_server_tid, 1);
+		tui_wait_for_updates();
 	}
 }
 
@@ -0,0 +1,78 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "clock.h"
+#include "name.h"
+#include "string.h"
+#include "params.h"
+
+// Ten minutes when run on its own, a short smoke run as part of ALL
+#define TICK_DRIFT_SECONDS (strcmp(PERF_TEST, "TICK_DRIFT") == 0 ? 600 : 10)
+#define TICK_DRIFT_SAMPLE_SECONDS 10
+
+// Compare the clock server's tick count against the free-running microsecond clock. A tick that drifts
+// shows up as a growing gap between ticks * 10ms and elapsed microseconds.
+void tick_drift_perf_main(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	clock_time_t start;
+	clock_time_t now;
+
+	int start_tick = Time(clock_tid);
+	GetClockTime(&start);
+
+	console_printf("test,elapsed_s,clock_ticks,kernel_ticks,drift_us,missed_ticks,max_late_us\r\n");
+
+	int seconds = TICK_DRIFT_SECONDS;
+	for (int elapsed = TICK_DRIFT_SAMPLE_SECONDS; elapsed <= seconds; elapsed += TICK_DRIFT_SAMPLE_SECONDS) {
+		int tick = DelayUntil(clock_tid, start_tick + elapsed * TICK_PER_S);
+		GetClockTime(&now);
+
+		i64 elapsed_us = (i64)(now.time_us - start.time_us);
+		i64 drift_us = elapsed_us - (i64)TICK_TO_MS(tick - start_tick) * 1000;
+
+		console_printf("tick_drift,%d,%d,%llu,%lld,%u,%u\r\n", elapsed, tick - start_tick,
+			       now.ticks - start.ticks, drift_us, now.missed_ticks - start.missed_ticks, now.max_late_us);
+	}
+}
+
+#define IDLE_RATE_SECONDS 10
+
+static u64 idle_rate_total_dispatches(task_stats_t *stats, int count)
+{
+	u64 dispatches = 0;
+
+	for (int i = 0; i < count; i++) {
+		dispatches += stats[i].dispatches;
+	}
+
+	return dispatches;
+}
+
+// Interrupt and context-switch rates while every task is blocked for IDLE_RATE_SECONDS
+void idle_rate_perf_main(void)
+{
+	static task_stats_t stats[MAX_TASKS];
+	irq_latency_t before[IRQ_LATENCY_SOURCES];
+	irq_latency_t after[IRQ_LATENCY_SOURCES];
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+
+	GetIrqLatency(before, IRQ_LATENCY_SOURCES, 0);
+	u64 dispatches_before = idle_rate_total_dispatches(stats, GetTaskStats(-1, stats, MAX_TASKS));
+
+	Delay(clock_tid, IDLE_RATE_SECONDS * TICK_PER_S);
+
+	GetIrqLatency(after, IRQ_LATENCY_SOURCES, 0);
+	u64 dispatches_after = idle_rate_total_dispatches(stats, GetTaskStats(-1, stats, MAX_TASKS));
+
+	u32 irqs = 0;
+	for (int s = 0; s < IRQ_LATENCY_SOURCES; s++) {
+		irqs += after[s].count - before[s].count;
+	}
+
+	console_printf("test,seconds,tick_irqs,irqs,dispatches,irqs_per_s,dispatches_per_s\r\n");
+	console_printf("idle_rate,%d,%u,%u,%llu,%u,%llu\r\n", IDLE_RATE_SECONDS,
+		       after[IRQ_LATENCY_TIMER_TICK].count - before[IRQ_LATENCY_TIMER_TICK].count, irqs,
+		       dispatches_after - dispatches_before, irqs / IDLE_RATE_SECONDS,
+		       (dispatches_after - dispatches_before) / IDLE_RATE_SECONDS);
+}
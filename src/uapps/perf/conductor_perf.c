@@ -0,0 +1,100 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "string.h"
+#include "name.h"
+#include "clock.h"
+#include "marklin/conductor/next_sensor.h"
+#include "marklin/topology/api.h"
+#include "marklin/topology/topology.h"
+
+#define NEXT_SENSOR_LOOKUP_ROUNDS 1000
+#define NEXT_SENSOR_SWITCH_CHANGES 2000
+
+static next_sensor_table_t next_sensor_table;
+static next_sensor_table_t next_sensor_reference;
+
+// Next-sensor lookups per second on track A and what a switch change costs to apply, against rebuilding the
+// whole table, which is what walking the track on every request amounts to. The incrementally updated table
+// must match a full rebuild at the end.
+void next_sensor_perf_main(void)
+{
+	const track_node *track_nodes = NULL;
+	marklin_track_type_t track_type;
+	const track_node *branches[TRACK_MAX];
+	int branch_count = 0;
+
+	perf_start_topology_server();
+
+	int track_size = -1;
+	if (Marklin_InitTrack(MARKLIN_TRACK_TYPE_A) == MARKLIN_ERROR_OK) {
+		track_size = Marklin_GetTrackNodes(&track_nodes, &track_type);
+	}
+	if (track_size <= 0) {
+		console_printf("next_sensor,FAIL,could not load track A\r\n");
+		return;
+	}
+
+	for (int i = 0; i < track_size; i++) {
+		if (track_nodes[i].type == NODE_BRANCH) {
+			branches[branch_count++] = &track_nodes[i];
+		}
+	}
+
+	u64 start = time_get_tick_64();
+	next_sensor_table_init(&next_sensor_table, track_nodes, track_size);
+	u64 build_us = time_get_tick_64() - start;
+
+	// Lookups from every node, as trains ask for their next two sensors
+	const track_node *sensors[2];
+	kinematic_distance_t distances[2];
+	u32 found = 0;
+
+	start = time_get_tick_64();
+	for (int round = 0; round < NEXT_SENSOR_LOOKUP_ROUNDS; round++) {
+		for (int i = 0; i < track_size; i++) {
+			found += next_sensor_table_lookup(&next_sensor_table, &track_nodes[i], sensors, distances);
+		}
+	}
+	u64 lookup_us = time_get_tick_64() - start;
+	u64 lookups = (u64)NEXT_SENSOR_LOOKUP_ROUNDS * track_size;
+
+	console_printf("test,track,nodes,branches,build_us,lookups,sensors_found,lookups_per_s\r\n");
+	console_printf("next_sensor_lookup,A,%d,%d,%llu,%llu,%u,%llu\r\n", track_size, branch_count, build_us, lookups,
+		       found, lookup_us ? lookups * 1000000 / lookup_us : 0);
+
+	// Flip pseudo-random switches so the table goes through many switch combinations
+	u32 seed = 1;
+	u64 recomputed = 0;
+	int max_recomputed = 0;
+
+	start = time_get_tick_64();
+	for (int i = 0; i < NEXT_SENSOR_SWITCH_CHANGES; i++) {
+		seed = seed * 1103515245 + 12345;
+		const track_node *branch = branches[(seed >> 16) % branch_count];
+		track_direction direction = next_sensor_table.branch_directions[branch - track_nodes] == DIR_STRAIGHT ?
+						    DIR_CURVED :
+						    DIR_STRAIGHT;
+
+		int count = next_sensor_table_set_switch(&next_sensor_table, branch, direction);
+		recomputed += count;
+		if (count > max_recomputed) {
+			max_recomputed = count;
+		}
+	}
+	u64 switch_us = time_get_tick_64() - start;
+
+	memcpy(&next_sensor_reference, &next_sensor_table, sizeof(next_sensor_reference));
+	start = time_get_tick_64();
+	next_sensor_table_rebuild(&next_sensor_reference);
+	u64 rebuild_us = time_get_tick_64() - start;
+
+	int matches = memcmp(next_sensor_reference.entries, next_sensor_table.entries,
+			     sizeof(next_sensor_table.entries)) == 0;
+
+	console_printf("test,switch_changes,avg_ns_per_change,avg_entries_recomputed,max_entries_recomputed,"
+		       "full_rebuild_ns,result\r\n");
+	console_printf("next_sensor_switch,%d,%llu,%llu,%d,%llu,%s\r\n", NEXT_SENSOR_SWITCH_CHANGES,
+		       switch_us * 1000 / NEXT_SENSOR_SWITCH_CHANGES, recomputed / NEXT_SENSOR_SWITCH_CHANGES,
+		       max_recomputed, rebuild_us * 1000, matches ? "PASS" : "FAIL");
+}
@@ -0,0 +1,68 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+
+#define IRQ_NESTING_SLEEPS 2000
+#define IRQ_NESTING_SLEEP_US 500
+
+// Timer interrupts should preempt the console drain: worst-case entry stays well below one console
+// FIFO drain (16 bytes at 115200 baud, ~1.4ms)
+#define IRQ_NESTING_MAX_ENTRY_NS 100000
+
+// Below the perf task, so it only floods while the perf task sleeps
+#define IRQ_NESTING_FLOOD_PRIORITY (PERF_TASK_PRIORITY + 1)
+
+static volatile int irq_nesting_flooding;
+
+// Keeps the kernel console buffer full, so every exception entry and IRQ bottom half spends its time waiting
+// on the FIFO. Output through the IO server would never reach that drain.
+static void irq_nesting_flood_task(void)
+{
+	static const char line[] =
+		"irq_nesting_flood,0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghijklmnopqrstuvwx\r\n";
+	int queued = 0;
+
+	while (irq_nesting_flooding) {
+		queued += ConsoleWrite(line + queued, sizeof(line) - 1 - queued);
+		if (queued == sizeof(line) - 1) {
+			queued = 0;
+		}
+	}
+
+	Exit();
+}
+
+// Worst-case timer IRQ latency while the console is saturated with output
+void irq_nesting_perf_main(void)
+{
+	irq_latency_t latency[IRQ_LATENCY_SOURCES];
+	int max_late_us = 0;
+
+	irq_nesting_flooding = 1;
+	int flood_tid = Create(IRQ_NESTING_FLOOD_PRIORITY, irq_nesting_flood_task);
+
+	GetIrqLatency(NULL, 0, 1);
+
+	for (int i = 0; i < IRQ_NESTING_SLEEPS; i++) {
+		int late_us = DelayUs(IRQ_NESTING_SLEEP_US);
+		if (late_us > max_late_us) {
+			max_late_us = late_us;
+		}
+	}
+
+	GetIrqLatency(latency, IRQ_LATENCY_SOURCES, 0);
+
+	irq_nesting_flooding = 0;
+	WaitTid(flood_tid);
+
+	irq_latency_t *hrtimer = &latency[IRQ_LATENCY_HRTIMER];
+	irq_latency_t *tick = &latency[IRQ_LATENCY_TIMER_TICK];
+	irq_latency_t *console = &latency[IRQ_LATENCY_CONSOLE_UART];
+	u32 entry_max_ns = hrtimer->entry_max_ns > tick->entry_max_ns ? hrtimer->entry_max_ns : tick->entry_max_ns;
+
+	console_printf("test,sleeps,console_irqs,hrtimer_irqs,hrtimer_entry_max_ns,hrtimer_wake_max_ns,"
+		       "tick_entry_max_ns,tick_wake_max_ns,max_late_us,result\r\n");
+	console_printf("irq_nesting,%d,%u,%u,%u,%u,%u,%u,%d,%s\r\n", IRQ_NESTING_SLEEPS, console->count, hrtimer->count,
+		       hrtimer->entry_max_ns, hrtimer->wake_max_ns, tick->entry_max_ns, tick->wake_max_ns, max_late_us,
+		       entry_max_ns <= IRQ_NESTING_MAX_ENTRY_NS ? "PASS" : "FAIL");
+}
@@ -0,0 +1,709 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "marklin/msgqueue/api.h"
+#include "marklin/msgqueue/msgqueue.h"
+#include "marklin/conductor/api.h"
+#include "marklin/conductor/conductor.h"
+#include "marklin/topology/api.h"
+#include "string.h"
+#include "arch/pmu.h"
+#include "params.h"
+#include "clock.h"
+#include "name.h"
+
+#define FANIN_PUBLISHERS 8
+#define FANIN_PUBLISHES_PER_TASK 1000
+#define FANIN_PAYLOAD_SIZE 16
+
+static void fanin_publisher_task(void)
+{
+	u8 payload[FANIN_PAYLOAD_SIZE] = { 0 };
+
+	for (int i = 0; i < FANIN_PUBLISHES_PER_TASK; i++) {
+		payload[0] = (u8)i;
+		Marklin_MsgQueue_Publish(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, payload, sizeof(payload));
+	}
+
+	Exit();
+}
+
+// Publishers share the msgqueue server's priority, so while the server is busy the
+// other publishers run and queue up behind it, which is the case ReceiveMany drains.
+void msgqueue_fanin_perf_main(void)
+{
+	int publisher_tids[FANIN_PUBLISHERS];
+
+	perf_start_msgqueue_server();
+
+	for (int i = 0; i < FANIN_PUBLISHERS; i++) {
+		publisher_tids[i] = Create(MARKLIN_MSGQUEUE_SERVER_TASK_PRIORITY, fanin_publisher_task);
+	}
+
+	// Nothing at the publishers' priority runs until we block here
+	u64 start_time = time_get_tick_64();
+
+	for (int i = 0; i < FANIN_PUBLISHERS; i++) {
+		WaitTid(publisher_tids[i]);
+	}
+
+	u64 total_time_us = time_get_tick_64() - start_time;
+	int total_publishes = FANIN_PUBLISHERS * FANIN_PUBLISHES_PER_TASK;
+	u64 publishes_per_s = total_time_us ? (u64)total_publishes * 1000000 / total_time_us : 0;
+
+	console_printf("test,receive_batch,publishers,publishes,total_time_us,publishes_per_s\r\n");
+	console_printf("msgqueue_fanin,%d,%d,%d,%llu,%llu\r\n", MARKLIN_MSGQUEUE_RECEIVE_BATCH, FANIN_PUBLISHERS,
+		       total_publishes, total_time_us, publishes_per_s);
+}
+
+#define PUBLISH_MESSAGES 2000
+
+// Above the perf task, so every publish is delivered and the subscriber is back in Receive before the next
+#define PUBLISH_SUBSCRIBER_PRIORITY (PERF_TASK_PRIORITY - 1)
+
+static const u32 publish_payload_sizes[] = { 16, 256, 4000 };
+
+static void publish_subscriber_task(void)
+{
+	static marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+
+	Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &subscription);
+
+	for (int i = 0; i < PUBLISH_MESSAGES; i++) {
+		Marklin_MsgQueue_Receive(&message, 0);
+	}
+
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// Cycles per Publish including delivery to one blocked subscriber, by payload size. The IPC copies scale
+// with the payload, not with MARKLIN_MSGQUEUE_MAX_DATA_SIZE.
+void msgqueue_publish_perf_main(void)
+{
+	static u8 payload[4000];
+
+	perf_start_msgqueue_server();
+
+	console_printf("test,payload_size,publishes,cycles_per_publish,subscriber_table_bytes\r\n");
+
+	for (u32 s = 0; s < sizeof(publish_payload_sizes) / sizeof(publish_payload_sizes[0]); s++) {
+		u32 size = publish_payload_sizes[s];
+		int subscriber_tid = Create(PUBLISH_SUBSCRIBER_PRIORITY, publish_subscriber_task);
+
+		u64 start_cycles = pmu_read_cycles();
+		for (int i = 0; i < PUBLISH_MESSAGES; i++) {
+			payload[0] = (u8)i;
+			Marklin_MsgQueue_Publish(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, payload, size);
+		}
+		u64 cycles = pmu_read_cycles() - start_cycles;
+
+		WaitTid(subscriber_tid);
+
+		console_printf("msgqueue_publish,%u,%d,%llu,%u\r\n", size, PUBLISH_MESSAGES, cycles / PUBLISH_MESSAGES,
+			       (u32)(sizeof(marklin_msgqueue_subscriber_info_t) * MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS));
+	}
+}
+
+#define FANOUT_PUBLISHES 500
+#define FANOUT_PAYLOAD_SIZE 16
+
+static const int fanout_subscriber_counts[] = { 1, 8, MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS };
+
+static int fanout_next_index;
+static u64 fanout_delivered[MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS];
+
+// Above the perf task, like the publish test, so each delivery is timestamped as soon as it is replied to
+static void fanout_subscriber_task(void)
+{
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+	int index = fanout_next_index++;
+
+	Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &subscription);
+
+	for (int i = 0; i < FANOUT_PUBLISHES; i++) {
+		Marklin_MsgQueue_Receive(&message, 0);
+		fanout_delivered[index] = pmu_read_cycles();
+	}
+
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// Cycles from the start of a Publish until the last subscriber holds the message
+void msgqueue_fanout_perf_main(void)
+{
+	u8 payload[FANOUT_PAYLOAD_SIZE] = { 0 };
+	int tids[MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS];
+
+	perf_start_msgqueue_server();
+
+	console_printf("test,subscribers,publishes,avg_delivered_cycles,max_delivered_cycles\r\n");
+
+	for (u32 n = 0; n < sizeof(fanout_subscriber_counts) / sizeof(fanout_subscriber_counts[0]); n++) {
+		int subscribers = fanout_subscriber_counts[n];
+
+		fanout_next_index = 0;
+		for (int i = 0; i < subscribers; i++) {
+			tids[i] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, fanout_subscriber_task,
+						  TASK_SMALL_STACK_SIZE);
+		}
+
+		u64 total_cycles = 0;
+		u64 max_cycles = 0;
+		for (int p = 0; p < FANOUT_PUBLISHES; p++) {
+			payload[0] = (u8)p;
+			u64 start = pmu_read_cycles();
+			Marklin_MsgQueue_Publish(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, payload, sizeof(payload));
+
+			u64 last = start;
+			for (int i = 0; i < subscribers; i++) {
+				if (fanout_delivered[i] > last) {
+					last = fanout_delivered[i];
+				}
+			}
+
+			total_cycles += last - start;
+			if (last - start > max_cycles) {
+				max_cycles = last - start;
+			}
+		}
+
+		for (int i = 0; i < subscribers; i++) {
+			WaitTid(tids[i]);
+		}
+
+		console_printf("msgqueue_fanout,%d,%d,%llu,%llu\r\n", subscribers, FANOUT_PUBLISHES,
+			       total_cycles / FANOUT_PUBLISHES, max_cycles);
+	}
+}
+
+#define TOPICS_PUBLISHES 500
+
+// 32 subscribers spread unevenly over the event types, so per-type publish cost shows how it scales with
+// recipients rather than with the size of the subscriber table
+static const int topics_subscribers[MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT] = { 1, 3, 8, 20 };
+
+static int topics_next_subscriber;
+
+static void topics_subscriber_task(void)
+{
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+	int index = topics_next_subscriber++;
+	int event_type = 0;
+
+	while (index >= topics_subscribers[event_type]) {
+		index -= topics_subscribers[event_type++];
+	}
+
+	Marklin_MsgQueue_Subscribe((marklin_msgqueue_event_type_t)event_type, &subscription);
+
+	for (int i = 0; i < TOPICS_PUBLISHES; i++) {
+		Marklin_MsgQueue_Receive(&message, 0);
+	}
+
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// Cycles per Publish for each event type, every subscriber blocked in Receive
+void msgqueue_topics_perf_main(void)
+{
+	u8 payload[FANOUT_PAYLOAD_SIZE] = { 0 };
+	int tids[MARKLIN_MSGQUEUE_MAX_SUBSCRIBERS];
+	int total = 0;
+
+	perf_start_msgqueue_server();
+
+	topics_next_subscriber = 0;
+	for (int t = 0; t < MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT; t++) {
+		for (int i = 0; i < topics_subscribers[t]; i++) {
+			tids[total++] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, topics_subscriber_task,
+							TASK_SMALL_STACK_SIZE);
+		}
+	}
+
+	console_printf("test,event_type,subscribers,total_subscribers,publishes,cycles_per_publish\r\n");
+
+	for (int t = 0; t < MARKLIN_MSGQUEUE_EVENT_TYPE_COUNT; t++) {
+		u64 start_cycles = pmu_read_cycles();
+		for (int p = 0; p < TOPICS_PUBLISHES; p++) {
+			payload[0] = (u8)p;
+			Marklin_MsgQueue_Publish((marklin_msgqueue_event_type_t)t, payload, sizeof(payload));
+		}
+		u64 cycles = pmu_read_cycles() - start_cycles;
+
+		console_printf("msgqueue_topics,%d,%d,%d,%d,%llu\r\n", t, topics_subscribers[t], total, TOPICS_PUBLISHES,
+			       cycles / TOPICS_PUBLISHES);
+	}
+
+	for (int i = 0; i < total; i++) {
+		WaitTid(tids[i]);
+	}
+}
+
+#define IDLE_TRAINS 6
+#define IDLE_SECONDS 5
+
+static volatile int idle_running;
+static volatile int idle_timed;
+
+// A train task with nothing to do: wait out each loop tick for a sensor update that never comes, either
+// polling the queue and sleeping on the clock server or blocking in a receive with a one tick timeout
+static void idle_train_task(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+
+	Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &subscription);
+
+	while (idle_running) {
+		if (idle_timed) {
+			Marklin_MsgQueue_Receive(&message, 1);
+		} else {
+			Marklin_MsgQueue_ReceiveNonBlock(&message);
+			Delay(clock_tid, 1);
+		}
+	}
+
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// Requests per second reaching the msgqueue and clock servers while idle trains wait for sensor updates
+void msgqueue_idle_perf_main(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	int tids[IDLE_TRAINS];
+
+	perf_start_msgqueue_server();
+	int server_tid = WhoIs(MARKLIN_MSGQUEUE_SERVER_NAME);
+
+	console_printf("test,mode,trains,seconds,msgqueue_requests_per_s,msgqueue_run_us_per_s,"
+		       "clock_requests_per_s\r\n");
+
+	for (int timed = 0; timed <= 1; timed++) {
+		task_stats_t server_before, server_after, clock_before, clock_after;
+
+		idle_running = 1;
+		idle_timed = timed;
+		for (int i = 0; i < IDLE_TRAINS; i++) {
+			tids[i] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, idle_train_task, TASK_SMALL_STACK_SIZE);
+		}
+
+		// Let every train subscribe and settle into its loop
+		Delay(clock_tid, 2);
+
+		GetTaskStats(server_tid, &server_before, 1);
+		GetTaskStats(clock_tid, &clock_before, 1);
+		Delay(clock_tid, IDLE_SECONDS * TICK_PER_S);
+		GetTaskStats(server_tid, &server_after, 1);
+		GetTaskStats(clock_tid, &clock_after, 1);
+
+		idle_running = 0;
+		for (int i = 0; i < IDLE_TRAINS; i++) {
+			WaitTid(tids[i]);
+		}
+
+		console_printf("msgqueue_idle,%s,%d,%d,%u,%llu,%u\r\n", timed ? "timed_receive" : "poll_delay",
+			       IDLE_TRAINS, IDLE_SECONDS,
+			       (server_after.receives - server_before.receives) / IDLE_SECONDS,
+			       (server_after.run_time_us - server_before.run_time_us) / IDLE_SECONDS,
+			       (clock_after.receives - clock_before.receives) / IDLE_SECONDS);
+	}
+}
+
+#define COALESCE_KEYS 6
+#define COALESCE_ROUNDS 200
+#define COALESCE_SLOW_TICKS 5 // The subscriber handles one message per this many ticks
+
+typedef struct {
+	u32 key;
+	u32 round;
+} coalesce_payload_t;
+
+typedef struct {
+	marklin_msgqueue_event_type_t event_type;
+	u32 delivered;
+	u32 out_of_order;
+	u32 latest[COALESCE_KEYS];
+	marklin_msgqueue_subscription_stats_t stats;
+} coalesce_result_t;
+
+// TRAIN_POSITION coalesces by key, SENSOR_UPDATE queues every message
+static coalesce_result_t coalesce_results[2] = {
+	{ .event_type = MARKLIN_MSGQUEUE_EVENT_TYPE_TRAIN_POSITION },
+	{ .event_type = MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE },
+};
+
+static int coalesce_next_subscriber;
+static volatile int coalesce_done;
+
+static void coalesce_slow_subscriber_task(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	coalesce_result_t *result = &coalesce_results[coalesce_next_subscriber++];
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+
+	Marklin_MsgQueue_Subscribe(result->event_type, &subscription);
+
+	for (;;) {
+		marklin_error_t error = Marklin_MsgQueue_Receive(&message, 1);
+		if (error != MARKLIN_ERROR_OK) {
+			if (coalesce_done) {
+				break;
+			}
+			continue;
+		}
+
+		coalesce_payload_t *payload = MARKLIN_MSGQUEUE_CAST_TO(coalesce_payload_t, &message);
+		if (payload && payload->key < COALESCE_KEYS) {
+			if (payload->round < result->latest[payload->key]) {
+				result->out_of_order++;
+			}
+			result->latest[payload->key] = payload->round;
+		}
+		result->delivered++;
+
+		Delay(clock_tid, COALESCE_SLOW_TICKS);
+	}
+
+	Marklin_MsgQueue_GetSubscriptionStats(&subscription, &result->stats);
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// A subscriber far slower than the publisher, on a coalescing and on a queueing topic. The coalescing one
+// should lose nothing to a full queue and end up with the newest value of every key.
+void msgqueue_coalesce_perf_main(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	int tids[2];
+
+	perf_start_msgqueue_server();
+
+	coalesce_done = 0;
+	coalesce_next_subscriber = 0;
+	for (int i = 0; i < 2; i++) {
+		tids[i] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, coalesce_slow_subscriber_task,
+					  TASK_SMALL_STACK_SIZE);
+	}
+
+	for (u32 round = 0; round < COALESCE_ROUNDS; round++) {
+		for (u32 key = 0; key < COALESCE_KEYS; key++) {
+			coalesce_payload_t payload = { key, round };
+
+			for (int i = 0; i < 2; i++) {
+				Marklin_MsgQueue_PublishKeyedTyped(coalesce_results[i].event_type, (u16)key, &payload);
+			}
+		}
+
+		Delay(clock_tid, 1);
+	}
+
+	coalesce_done = 1;
+	for (int i = 0; i < 2; i++) {
+		WaitTid(tids[i]);
+	}
+
+	console_printf("test,event_type,published,delivered,coalesced,dropped,out_of_order,latest_delivered,result\r\n");
+
+	for (int i = 0; i < 2; i++) {
+		coalesce_result_t *result = &coalesce_results[i];
+		int latest = 1;
+
+		for (int key = 0; key < COALESCE_KEYS; key++) {
+			latest &= result->latest[key] == COALESCE_ROUNDS - 1;
+		}
+
+		// Only the coalescing topic is expected to keep up
+		int pass = i != 0 || (result->stats.dropped == 0 && result->out_of_order == 0 && latest &&
+				      result->delivered + result->stats.coalesced == COALESCE_ROUNDS * COALESCE_KEYS);
+
+		console_printf("msgqueue_coalesce,%d,%d,%u,%u,%u,%u,%d,%s\r\n", result->event_type,
+			       COALESCE_ROUNDS * COALESCE_KEYS, result->delivered, result->stats.coalesced,
+			       result->stats.dropped, result->out_of_order, latest, pass ? "PASS" : "FAIL");
+	}
+}
+
+#define WAIT_TRAINS 6
+#define WAIT_SECONDS 5
+#define WAIT_IDLE_TICKS 25 // Loop interval of an idle train2 task
+#define WAIT_MOVING_TICKS 1
+
+typedef enum {
+	WAIT_MODE_POLL, // The old train loop: poll for commands and sensor updates, then Delay a tick
+	WAIT_MODE_IDLE,
+	WAIT_MODE_MOVING,
+} wait_mode_t;
+
+static const char *const wait_mode_names[] = { "poll", "wait_idle", "wait_moving" };
+
+static volatile int wait_running;
+static volatile wait_mode_t wait_mode;
+
+static void wait_train_task(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+	marklin_msgqueue_waiter_t waiter;
+	int command;
+
+	Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &subscription);
+	if (wait_mode != WAIT_MODE_POLL) {
+		Marklin_MsgQueue_WaiterInit(&waiter);
+	}
+
+	while (wait_running) {
+		if (wait_mode == WAIT_MODE_POLL) {
+			int sender_tid;
+			ReceiveNonBlock(&sender_tid, (char *)&command, sizeof(command));
+			Marklin_MsgQueue_ReceiveNonBlock(&message);
+			Delay(clock_tid, 1);
+			continue;
+		}
+
+		clock_time_t now;
+		GetClockTime(&now);
+		u32 wake_tick = (u32)now.ticks + (wait_mode == WAIT_MODE_IDLE ? WAIT_IDLE_TICKS : WAIT_MOVING_TICKS);
+
+		int sender_tid;
+		int command_size = sizeof(command);
+		Marklin_MsgQueue_Wait(&waiter, wake_tick, &sender_tid, &command, &command_size, &message);
+	}
+
+	if (wait_mode != WAIT_MODE_POLL) {
+		Marklin_MsgQueue_WaiterDestroy(&waiter);
+	}
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+static u64 wait_total_dispatches(task_stats_t *stats, int count)
+{
+	u64 dispatches = 0;
+
+	for (int i = 0; i < count; i++) {
+		dispatches += stats[i].dispatches;
+	}
+
+	return dispatches;
+}
+
+// Context switches per second across the system with 6 train loops that have nothing to react to,
+// polling as train2 used to or blocked in Marklin_MsgQueue_Wait with an idle or a moving train's deadline
+void train_wait_perf_main(void)
+{
+	static task_stats_t stats[MAX_TASKS];
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	int tids[WAIT_TRAINS];
+
+	perf_start_msgqueue_server();
+
+	console_printf("test,mode,trains,seconds,dispatches_per_s\r\n");
+
+	for (int mode = WAIT_MODE_POLL; mode <= WAIT_MODE_MOVING; mode++) {
+		wait_running = 1;
+		wait_mode = (wait_mode_t)mode;
+		for (int i = 0; i < WAIT_TRAINS; i++) {
+			tids[i] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, wait_train_task, TASK_SMALL_STACK_SIZE);
+		}
+
+		// Let every train subscribe and settle into its loop
+		Delay(clock_tid, 2);
+
+		u64 before = wait_total_dispatches(stats, GetTaskStats(-1, stats, MAX_TASKS));
+		Delay(clock_tid, WAIT_SECONDS * TICK_PER_S);
+		u64 after = wait_total_dispatches(stats, GetTaskStats(-1, stats, MAX_TASKS));
+
+		// Idle trains may sleep a while before they see the flag
+		wait_running = 0;
+		for (int i = 0; i < WAIT_TRAINS; i++) {
+			WaitTid(tids[i]);
+		}
+
+		console_printf("train_wait,%s,%d,%d,%llu\r\n", wait_mode_names[mode], WAIT_TRAINS, WAIT_SECONDS,
+			       (after - before) / WAIT_SECONDS);
+	}
+}
+
+#define ROUTING_EVENTS 1000
+#define ROUTING_MAX_TRAINS 8
+
+static const int routing_train_counts[] = { 2, 4, ROUTING_MAX_TRAINS };
+static const char *const routing_mode_names[] = { "broadcast", "routed" };
+
+extern conductor_task_data_t *g_conductor_data;
+
+// The conductor's state, set up on track A as the conductor does, so triggers go through its real attribution
+static conductor_task_data_t routing_conductor;
+// Bank and sensor id of the two sensors each train expects next
+static marklin_sensor_state_t routing_expected[ROUTING_MAX_TRAINS][2];
+
+static int routing_next_index;
+static volatile int routing_routed;
+static u32 routing_delivered;
+static u32 routing_attributed;
+
+// Stand-in for a train2 task checking each trigger it gets against its expected sensors. A sensor in a bank
+// past the last one tells it to stop.
+static void routing_train_task(void)
+{
+	marklin_msgqueue_message_t message;
+	marklin_msgqueue_subscription_t subscription;
+	int index = routing_next_index++;
+	const marklin_sensor_state_t *expected = routing_expected[index];
+
+	if (routing_routed) {
+		Marklin_MsgQueue_SubscribeKeyed(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, index + 1, &subscription);
+	} else {
+		Marklin_MsgQueue_Subscribe(MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE, &subscription);
+	}
+
+	for (;;) {
+		Marklin_MsgQueue_Receive(&message, 0);
+		marklin_sensor_state_t *sensor = MARKLIN_MSGQUEUE_CAST_TO(marklin_sensor_state_t, &message);
+		if (!sensor || sensor->bank >= MARKLIN_SENSOR_BANK_COUNT) {
+			break;
+		}
+
+		// The check every train makes on every update it gets
+		routing_delivered++;
+		if (!sensor->triggered) {
+			continue;
+		}
+		for (int i = 0; i < 2; i++) {
+			if (sensor->bank == expected[i].bank && sensor->sensor_id == expected[i].sensor_id) {
+				routing_attributed++;
+				break;
+			}
+		}
+	}
+
+	Marklin_MsgQueue_Unsubscribe(&subscription);
+	Exit();
+}
+
+// Train i expects sensors i and i + 1 of the lookup table and holds the block of sensor i, so neighbouring
+// trains compete for a sensor and the conductor has to break the tie
+static void routing_set_expectations(int trains)
+{
+	conductor_init_sensor_lookup(&routing_conductor);
+	for (int i = 0; i < routing_conductor.track_block_count; i++) {
+		routing_conductor.track_blocks[i].owner_train_id = 0;
+	}
+
+	for (int i = 0; i < trains; i++) {
+		const track_node *sensors[2] = { routing_conductor.sensor_lookup[i].sensor_node,
+						 routing_conductor.sensor_lookup[i + 1].sensor_node };
+		sensor_set_expected(i + 1, sensors, 2);
+		routing_expected[i][0] = routing_conductor.sensor_lookup[i].state;
+		routing_expected[i][1] = routing_conductor.sensor_lookup[i + 1].state;
+
+		track_block_t *block =
+			conductor_find_block_containing_node(sensors[0], &routing_conductor, true, true, true, false);
+		if (block && !block->owner_train_id) {
+			block->owner_train_id = i + 1;
+		}
+	}
+}
+
+static u64 routing_run_time_us(const int *tids, int count)
+{
+	u64 run_time_us = 0;
+
+	for (int i = 0; i < count; i++) {
+		task_stats_t stats;
+		if (GetTaskStats(tids[i], &stats, 1) == 1) {
+			run_time_us += stats.run_time_us;
+		}
+	}
+
+	return run_time_us;
+}
+
+// CPU time per sensor event across the conductor, the msgqueue server and the train tasks, with every train
+// subscribed to every sensor update or only to the triggers the conductor attributes to it. Each event is one
+// sensor report with the next sensor triggered, which also releases the previous one.
+void sensor_routing_perf_main(void)
+{
+	int clock_tid = WhoIs(CLOCK_SERVER_NAME);
+	marklin_msgqueue_event_type_t topic = MARKLIN_MSGQUEUE_EVENT_TYPE_SENSOR_UPDATE;
+	// Conductor, server, then the trains
+	int tids[2 + ROUTING_MAX_TRAINS];
+
+	perf_start_msgqueue_server();
+	perf_start_topology_server();
+	tids[0] = MyTid();
+	tids[1] = WhoIs(MARKLIN_MSGQUEUE_SERVER_NAME);
+
+	routing_conductor.clock_server_tid = clock_tid;
+	if (Marklin_InitTrack(MARKLIN_TRACK_TYPE_A) == MARKLIN_ERROR_OK) {
+		routing_conductor.track_size =
+			Marklin_GetTrackNodes(&routing_conductor.track_nodes, &routing_conductor.track_type);
+	}
+	if (routing_conductor.track_size <= 0) {
+		console_printf("sensor_routing,FAIL,could not load track A\r\n");
+		return;
+	}
+	conductor_init_blocks(&routing_conductor);
+	g_conductor_data = &routing_conductor;
+
+	console_printf("test,mode,trains,events,deliveries_per_event,attributed,cpu_ns_per_event\r\n");
+
+	for (u32 n = 0; n < sizeof(routing_train_counts) / sizeof(routing_train_counts[0]); n++) {
+		int trains = routing_train_counts[n];
+
+		for (int routed = 0; routed <= 1; routed++) {
+			u16 sensor_data[MARKLIN_SENSOR_BANK_COUNT];
+
+			routing_set_expectations(trains);
+			routing_next_index = 0;
+			routing_routed = routed;
+			routing_delivered = 0;
+			routing_attributed = 0;
+			for (int i = 0; i < trains; i++) {
+				tids[2 + i] = CreateWithStack(PUBLISH_SUBSCRIBER_PRIORITY, routing_train_task,
+							      TASK_SMALL_STACK_SIZE);
+			}
+
+			// Let every train subscribe
+			Delay(clock_tid, 2);
+
+			// Trains run above the conductor, so each report returns once every delivery is handled
+			u64 before = routing_run_time_us(tids, 2 + trains);
+			for (int e = 0; e < ROUTING_EVENTS; e++) {
+				const marklin_sensor_state_t *state =
+					&routing_conductor.sensor_lookup[e % (trains + 1)].state;
+				memset(sensor_data, 0, sizeof(sensor_data));
+				sensor_data[state->bank] = 1 << (state->sensor_id - 1);
+				conductor_consume_sensor_data(sensor_data, e + 1);
+			}
+			u64 after = routing_run_time_us(tids, 2 + trains);
+
+			marklin_sensor_state_t stop = { .bank = MARKLIN_SENSOR_BANK_COUNT };
+			if (routed) {
+				for (int i = 0; i < trains; i++) {
+					Marklin_MsgQueue_PublishKeyedTyped(topic, i + 1, &stop);
+				}
+			} else {
+				Marklin_MsgQueue_PublishTyped(topic, &stop);
+			}
+			for (int i = 0; i < trains; i++) {
+				WaitTid(tids[2 + i]);
+			}
+
+			console_printf("sensor_routing,%s,%d,%d,%u,%u,%llu\r\n", routing_mode_names[routed], trains,
+				       ROUTING_EVENTS, routing_delivered / ROUTING_EVENTS, routing_attributed,
+				       (after - before) * 1000 / ROUTING_EVENTS);
+		}
+	}
+
+	g_conductor_data = NULL;
+}
@@ -0,0 +1,75 @@
+#include "perf.h"
+#include "syscall.h"
+#include "string.h"
+#include "io.h"
+#include "marklin/msgqueue/msgqueue.h"
+#include "marklin/topology/topology.h"
+#include "name.h"
+#include "clock.h"
+#include "params.h"
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+} perf_test_t;
+
+static const perf_test_t perf_tests[] = {
+	{ "SRR", srr_perf_main },
+	{ "MSGQUEUE_FANIN", msgqueue_fanin_perf_main },
+	{ "MSGQUEUE_PUBLISH", msgqueue_publish_perf_main },
+	{ "MSGQUEUE_FANOUT", msgqueue_fanout_perf_main },
+	{ "MSGQUEUE_TOPICS", msgqueue_topics_perf_main },
+	{ "MSGQUEUE_IDLE", msgqueue_idle_perf_main },
+	{ "MSGQUEUE_COALESCE", msgqueue_coalesce_perf_main },
+	{ "TRAIN_WAIT", train_wait_perf_main },
+	{ "SENSOR_ROUTING", sensor_routing_perf_main },
+	{ "TRAIN_POSITION_DELTA", train_position_delta_perf_main },
+	{ "NEXT_SENSOR", next_sensor_perf_main },
+	{ "TASK_TEARDOWN", task_teardown_perf_main },
+	{ "TASK_CHURN", task_churn_perf_main },
+	{ "CTX_SWITCH", ctx_switch_perf_main },
+	{ "PROFILE", profile_perf_main },
+	{ "TICK_DRIFT", tick_drift_perf_main },
+	{ "IDLE_RATE", idle_rate_perf_main },
+	{ "IRQ_NESTING", irq_nesting_perf_main },
+};
+
+#define PERF_NUM_TESTS (sizeof(perf_tests) / sizeof(perf_tests[0]))
+
+static int msgqueue_server_started = 0;
+
+void perf_start_msgqueue_server(void)
+{
+	if (!msgqueue_server_started) {
+		Create(MARKLIN_MSGQUEUE_SERVER_TASK_PRIORITY, marklin_msgqueue_server_task);
+		msgqueue_server_started = 1;
+	}
+}
+
+static int topology_server_started = 0;
+
+void perf_start_topology_server(void)
+{
+	if (!topology_server_started) {
+		CreateWithStack(MARKLIN_TOPOLOGY_SERVER_TASK_PRIORITY, marklin_topology_server_task,
+				TASK_SMALL_STACK_SIZE);
+		// Let it register before the test asks for a track
+		Delay(WhoIs(CLOCK_SERVER_NAME), 1);
+		topology_server_started = 1;
+	}
+}
+
+void perf_main(void)
+{
+	int run_all = strcmp(PERF_TEST, "ALL") == 0;
+
+	for (u32 i = 0; i < PERF_NUM_TESTS; i++) {
+		if (run_all || strcmp(PERF_TEST, perf_tests[i].name) == 0) {
+			console_printf("# perf test: %s\r\n", perf_tests[i].name);
+			perf_tests[i].run();
+		}
+	}
+
+	console_printf("# perf done\r\n");
+	Exit();
+}
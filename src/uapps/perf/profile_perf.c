@@ -0,0 +1,61 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "string.h"
+#include "compiler.h"
+
+#define PROFILE_PERF_PERIOD_US 100
+#define PROFILE_PERF_BUSY_US 500000
+#define PROFILE_PERF_TOP_ENTRIES 5
+
+// The known hot spot: spin on the system timer without entering the kernel, so every sample taken while
+// it runs lands inside this function
+static __noinline u64 profile_perf_busy_loop(u64 duration_us)
+{
+	volatile u64 sink = 0;
+	u64 start = time_get_tick_64();
+
+	while (time_get_tick_64() - start < duration_us) {
+		for (int i = 0; i < 64; i++) {
+			sink += (u64)i * 2654435761U;
+		}
+	}
+
+	return sink;
+}
+
+void profile_perf_main(void)
+{
+	profile_report_t report;
+
+	Profile(PROFILE_RESET, 0, NULL);
+	if (Profile(PROFILE_START, PROFILE_PERF_PERIOD_US, NULL) < 0) {
+		console_printf("profile,FAIL,could not start the profiler\r\n");
+		return;
+	}
+
+	profile_perf_busy_loop(PROFILE_PERF_BUSY_US);
+
+	Profile(PROFILE_STOP, 0, NULL);
+	int count = Profile(PROFILE_REPORT, PROFILE_PERF_TOP_ENTRIES, &report);
+	if (count <= 0) {
+		console_printf("profile,FAIL,no samples\r\n");
+		return;
+	}
+
+	console_printf("test,rank,function,hits,percent_x100\r\n");
+	for (int i = 0; i < count; i++) {
+		console_printf("profile,%d,%s,%u,%u\r\n", i, report.entries[i].name, report.entries[i].hits,
+			       (u32)((u64)report.entries[i].hits * 10000 / report.samples));
+	}
+
+	// Expect the busy loop to dominate: top of the profile with most of the samples
+	int dominates = strcmp(report.entries[0].name, "profile_perf_busy_loop") == 0 &&
+			(u64)report.entries[0].hits * 100 >= (u64)report.samples * 90;
+
+	console_printf("test,samples,dropped,functions,period_us,result\r\n");
+	console_printf("profile_summary,%u,%u,%u,%u,%s\r\n", report.samples, report.dropped, report.functions,
+		       report.period_us, dominates ? "PASS" : "FAIL");
+
+	Profile(PROFILE_RESET, 0, NULL);
+}
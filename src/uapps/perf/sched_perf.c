@@ -0,0 +1,54 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "arch/pmu.h"
+
+#define CTX_SWITCH_YIELDS_PER_TASK 10000
+
+// Below the perf task, so both yielders are created before either runs
+#define CTX_SWITCH_TASK_PRIORITY (PERF_TASK_PRIORITY + 1)
+
+#ifdef MMU
+#define CTX_SWITCH_MMU 1
+#else
+#define CTX_SWITCH_MMU 0
+#endif
+
+// Two of these at the same priority hand the CPU back and forth, so every Yield is a full context switch
+static void ctx_switch_yield_task(void)
+{
+	for (int i = 0; i < CTX_SWITCH_YIELDS_PER_TASK; i++) {
+		Yield();
+	}
+
+	Exit();
+}
+
+void ctx_switch_perf_main(void)
+{
+	int tids[2];
+
+	for (int i = 0; i < 2; i++) {
+		tids[i] = Create(CTX_SWITCH_TASK_PRIORITY, ctx_switch_yield_task);
+	}
+
+	u64 start_us = time_get_tick_64();
+	u64 start_cycles = pmu_read_cycles();
+	u32 start_refills = pmu_read_l1d_refills();
+	u32 start_accesses = pmu_read_l1d_accesses();
+
+	for (int i = 0; i < 2; i++) {
+		WaitTid(tids[i]);
+	}
+
+	u64 cycles = pmu_read_cycles() - start_cycles;
+	u32 refills = pmu_read_l1d_refills() - start_refills;
+	u32 accesses = pmu_read_l1d_accesses() - start_accesses;
+	u64 total_time_us = time_get_tick_64() - start_us;
+	u64 switches = 2 * CTX_SWITCH_YIELDS_PER_TASK;
+
+	console_printf("test,mmu,klog_level,switches,total_time_us,cycles_per_switch,l1d_refills_per_switch_x100,"
+		       "l1d_accesses_per_switch\r\n");
+	console_printf("ctx_switch,%d,%s,%llu,%llu,%llu,%llu,%llu\r\n", CTX_SWITCH_MMU, PERF_KLOG_LEVEL, switches,
+		       total_time_us, cycles / switches, (u64)refills * 100 / switches, (u64)accesses / switches);
+}
@@ -0,0 +1,158 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "params.h"
+
+// 3-level tree: TEARDOWN_TOPS * (1 + TEARDOWN_MIDS_PER_TOP * (1 + TEARDOWN_LEAVES_PER_MID)) = 60 tasks
+#define TEARDOWN_TOPS 4
+#define TEARDOWN_MIDS_PER_TOP 2
+#define TEARDOWN_LEAVES_PER_MID 6
+#define TEARDOWN_LEVELS 3
+
+// Below the perf task, so the whole tree is built before anything in it runs
+#define TEARDOWN_TASK_PRIORITY (PERF_TASK_PRIORITY + 3)
+
+// Live task counts for the Create/Exit churn test, including the parked tasks it creates
+static const int churn_live_tasks[] = { 50, 200, 500 };
+#define CHURN_LEVELS (sizeof(churn_live_tasks) / sizeof(churn_live_tasks[0]))
+#define CHURN_MAX_LIVE_TASKS 500
+#define CHURN_ITERATIONS 1000
+
+// The churned task preempts the perf task, so each Create runs the child to its Exit before returning
+#define CHURN_TASK_PRIORITY (PERF_TASK_PRIORITY - 1)
+
+// Park forever; the tree is only ever torn down with Kill
+static void __noreturn teardown_park(void)
+{
+	int sender_tid;
+	char msg;
+
+	for (;;) {
+		Receive(&sender_tid, &msg, sizeof(msg));
+	}
+}
+
+static void teardown_leaf_task(void)
+{
+	teardown_park();
+}
+
+static void teardown_mid_task(void)
+{
+	int created = 1;
+
+	for (int i = 0; i < TEARDOWN_LEAVES_PER_MID; i++) {
+		if (CreateWithStack(TEARDOWN_TASK_PRIORITY, teardown_leaf_task, TASK_SMALL_STACK_SIZE) >= 0) {
+			created++;
+		}
+	}
+
+	// Report the subtree size to the parent, then park
+	Send(MyParentTid(), (const char *)&created, sizeof(created), NULL, 0);
+	teardown_park();
+}
+
+static void teardown_top_task(void)
+{
+	int mids = 0;
+	int created = 1;
+
+	for (int i = 0; i < TEARDOWN_MIDS_PER_TOP; i++) {
+		if (CreateWithStack(TEARDOWN_TASK_PRIORITY, teardown_mid_task, TASK_SMALL_STACK_SIZE) >= 0) {
+			mids++;
+		}
+	}
+
+	for (int i = 0; i < mids; i++) {
+		int sender_tid;
+		int subtree;
+
+		Receive(&sender_tid, (char *)&subtree, sizeof(subtree));
+		Reply(sender_tid, NULL, 0);
+		created += subtree;
+	}
+
+	Send(MyParentTid(), (const char *)&created, sizeof(created), NULL, 0);
+	teardown_park();
+}
+
+void task_teardown_perf_main(void)
+{
+	int top_tids[TEARDOWN_TOPS];
+	int tops = 0;
+	int total_tasks = 0;
+
+	for (int i = 0; i < TEARDOWN_TOPS; i++) {
+		int tid = CreateWithStack(TEARDOWN_TASK_PRIORITY, teardown_top_task, TASK_SMALL_STACK_SIZE);
+		if (tid >= 0) {
+			top_tids[tops++] = tid;
+		}
+	}
+
+	// Wait until every subtree is fully built
+	for (int i = 0; i < tops; i++) {
+		int sender_tid;
+		int subtree;
+
+		Receive(&sender_tid, (char *)&subtree, sizeof(subtree));
+		Reply(sender_tid, NULL, 0);
+		total_tasks += subtree;
+	}
+
+	u64 start_time = time_get_tick_64();
+
+	for (int i = 0; i < tops; i++) {
+		Kill(top_tids[i], 1);
+	}
+
+	u64 teardown_time_us = time_get_tick_64() - start_time;
+
+	console_printf("test,levels,tasks,teardown_us\r\n");
+	console_printf("task_teardown,%d,%d,%llu\r\n", TEARDOWN_LEVELS, total_tasks, teardown_time_us);
+}
+
+static void churn_task(void)
+{
+	Exit();
+}
+
+// Parked tasks sit in the ready queue below the perf task, so they stay live without ever running
+void task_churn_perf_main(void)
+{
+	int parked_tids[CHURN_MAX_LIVE_TASKS];
+	int parked = 0;
+
+	console_printf("test,live_tasks,iterations,total_time_us,create_exit_ns\r\n");
+
+	for (u32 level = 0; level < CHURN_LEVELS; level++) {
+		int target = churn_live_tasks[level];
+
+		while (parked < target) {
+			int tid = CreateWithStack(TEARDOWN_TASK_PRIORITY, teardown_leaf_task, TASK_SMALL_STACK_SIZE);
+			if (tid < 0) {
+				break;
+			}
+			parked_tids[parked++] = tid;
+		}
+
+		if (parked < target) {
+			console_printf("# task_churn: only %d of %d live tasks created\r\n", parked, target);
+			break;
+		}
+
+		u64 start_time = time_get_tick_64();
+
+		for (int i = 0; i < CHURN_ITERATIONS; i++) {
+			CreateWithStack(CHURN_TASK_PRIORITY, churn_task, TASK_SMALL_STACK_SIZE);
+		}
+
+		u64 total_time_us = time_get_tick_64() - start_time;
+
+		console_printf("task_churn,%d,%d,%llu,%llu\r\n", target, CHURN_ITERATIONS, total_time_us,
+			       total_time_us * 1000 / CHURN_ITERATIONS);
+	}
+
+	for (int i = 0; i < parked; i++) {
+		Kill(parked_tids[i], 0);
+	}
+}
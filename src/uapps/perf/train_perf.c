@@ -0,0 +1,56 @@
+#include "perf.h"
+#include "syscall.h"
+#include "io.h"
+#include "clock.h"
+#include "string.h"
+#include "marklin/train2/train.h"
+
+#define POSITION_DELTA_SECONDS 60
+#define POSITION_DELTA_CRUISE_MM_PER_TICK 4 // About speed 10 on most trains
+#define POSITION_DELTA_SENSOR_SPACING_MM 800
+
+static const char *const position_delta_cases[] = { "stationary", "cruising" };
+
+// Position reports per second a train2 loop running every tick publishes, replaying its reporting policy
+// over simulated time for a stopped train and one cruising between sensors
+void train_position_delta_perf_main(void)
+{
+	// Stand-ins for consecutive sensors, only compared by address
+	static const track_node sensors[2];
+
+	console_printf("test,case,seconds,loop_iterations,reports,reports_per_s\r\n");
+
+	for (int moving = 0; moving <= 1; moving++) {
+		marklin_train_position_data_t last;
+		marklin_train_position_data_t position;
+		u64 last_tick = 0;
+		u32 reports = 0;
+		int sensor = 0;
+
+		memset(&position, 0, sizeof(position));
+		position.current_location = &sensors[0];
+		position.current_speed = moving ? 10 : 0;
+		position.status = moving ? TRAIN_STATUS_MOVING : TRAIN_STATUS_IDLE;
+
+		for (u64 tick = 0; tick < POSITION_DELTA_SECONDS * TICK_PER_S; tick++) {
+			if (moving) {
+				position.location_offset_mm += POSITION_DELTA_CRUISE_MM_PER_TICK;
+				if (position.location_offset_mm >= POSITION_DELTA_SENSOR_SPACING_MM) {
+					position.location_offset_mm -= POSITION_DELTA_SENSOR_SPACING_MM;
+					sensor ^= 1;
+					position.current_location = &sensors[sensor];
+				}
+			}
+
+			if (reports == 0 || train_position_report_due(&last, &position, last_tick, tick)) {
+				last = position;
+				last_tick = tick;
+				reports++;
+			}
+		}
+
+		console_printf("train_position_delta,%s,%d,%d,%u,%u\r\n", position_delta_cases[moving],
+			       POSITION_DELTA_SECONDS, POSITION_DELTA_SECONDS * TICK_PER_S, reports,
+			       reports / POSITION_DELTA_SECONDS);
+	}
+}
@@ -1,6 +1,6 @@
 #include "srr_perf.h"
 #include "syscall.h"
-#include "uart.h"
+#include "io.h"
 
 #define NUM_ITERATIONS 10000
 #define WARMUP_ITERATIONS 100
@@ -33,6 +33,26 @@ static void print_csv_row(const char *opt, const char *cache, const char *order,
 	console_printf("%s,%s,%s,%d,%d,%d\r\n", opt, cache, order, msg_size, time_us, iterations);
 }
 
+// Print the receiver's non-empty latency buckets, one row per bucket, after the timing rows
+static void print_latency_rows(const char *order, int msg_size)
+{
+	ipc_latency_t latency;
+	if (GetIpcLatency(receiver_tid, &latency, 0) < 0) {
+		return;
+	}
+
+	for (int b = 0; b < IPC_LATENCY_BUCKETS; b++) {
+		if (latency.queue[b]) {
+			console_printf("latency,%s,%d,queue,%u,%u\r\n", order, msg_size, 1U << b, latency.queue[b]);
+		}
+	}
+	for (int b = 0; b < IPC_LATENCY_BUCKETS; b++) {
+		if (latency.service[b]) {
+			console_printf("latency,%s,%d,service,%u,%u\r\n", order, msg_size, 1U << b, latency.service[b]);
+		}
+	}
+}
+
 static void get_message_with_size(int size, char *buffer)
 {
 	for (int i = 0; i < size; i++) {
@@ -79,6 +99,9 @@ void receiver_task()
 		Reply(sender_tid_recv, reply_buffer, current_msg_size);
 	}
 
+	// Only the timed iterations go into the latency histograms
+	GetIpcLatency(MyTid(), NULL, 1);
+
 	for (int i = 0; i < NUM_ITERATIONS; i++) {
 		Receive(&sender_tid_recv, receiver_buffer, current_msg_size);
 		Reply(sender_tid_recv, reply_buffer, current_msg_size);
@@ -102,6 +125,9 @@ void run_test(int msg_size, int recv_first)
 
 	WaitTid(sender_tid);
 	WaitTid(receiver_tid);
+
+	// The exited receiver's histograms stay readable until its TID is reused
+	print_latency_rows(receiver_first ? "R" : "S", msg_size);
 }
 
 void srr_perf_main()
@@ -110,12 +136,11 @@ void srr_perf_main()
 	int i, j;
 
 	console_printf("optimization,cache,order,msgsize,total_time_us,iterations\r\n");
+	console_printf("latency,order,msgsize,kind,bucket_ns,count\r\n");
 
 	for (i = 0; i < 3; i++) { // 3 message sizes
 		for (j = 0; j < 2; j++) { // 2 execution orders
 			run_test(msg_sizes[i], j); // j=0: sender_first, j=1: receiver_first
 		}
 	}
-
-	Exit();
 }
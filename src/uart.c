@@ -9,7 +9,9 @@
 #include "interrupt.h"
 #include "arch/interrupts.h"
 #include "event.h"
+#include "irq_latency.h"
 #include "compiler.h"
+#include "arch/registers.h"
 #include <stdarg.h>
 
 #ifndef MMIO_BASE
@@ -156,6 +158,55 @@ void uart_process_tx_buffers_blocking(void)
 	}
 }
 
+// Set while uart_process_tx_buffers_preemptible runs, an IRQ nested in it must not start another drain
+static int console_tx_draining = 0;
+
+// Same drain, but FIFO space is awaited with IRQs unmasked so an interrupt can preempt the wait. Called on
+// exception entry and after EOI in handle_irq, with IRQs masked; an IRQ taken in the wait only runs its top
+// half and returns here. The buffer itself is only touched with IRQs masked, so a nested handler that logs
+// cannot corrupt it.
+void uart_process_tx_buffers_preemptible(void)
+{
+	if (console_tx_draining) {
+		return;
+	}
+
+	console_tx_draining = 1;
+
+	while (console_tx_buffer.count > 0) {
+		if (UART_REG(CONSOLE, UART_FR) & UART_FR_TXFF) {
+			local_irq_enable();
+			while (UART_REG(CONSOLE, UART_FR) & UART_FR_TXFF) {
+			}
+			local_irq_disable();
+			continue;
+		}
+
+		UART_REG(CONSOLE, UART_DR) = console_tx_buffer.buffer[console_tx_buffer.tail];
+		console_tx_buffer.tail = (console_tx_buffer.tail + 1) % UART_TX_BUFFER_SIZE;
+		console_tx_buffer.count--;
+	}
+
+	console_tx_draining = 0;
+}
+
+// Queue as much of buf as the console buffer has room for, without draining; returns the bytes queued
+size_t uart_putl_nonblock(size_t line, const char *buf, size_t size)
+{
+	if (line != CONSOLE) {
+		return 0;
+	}
+
+	size_t queued = 0;
+	while (queued < size && console_tx_buffer.count < UART_TX_BUFFER_SIZE) {
+		console_tx_buffer.buffer[console_tx_buffer.head] = buf[queued++];
+		console_tx_buffer.head = (console_tx_buffer.head + 1) % UART_TX_BUFFER_SIZE;
+		console_tx_buffer.count++;
+	}
+
+	return queued;
+}
+
 void uart_putc(size_t line, char c)
 {
 	if (line != CONSOLE) {
@@ -347,7 +398,8 @@ static void uart_kernel_interrupt_handler(u32 irq, void *data)
 	UNUSED(irq);
 	UNUSED(data);
 
-	size_t lines_to_check[] = { CONSOLE, MARKLIN };
+	// Marklin first: a sensor byte or CTS edge is more urgent than console traffic on the shared line
+	size_t lines_to_check[] = { MARKLIN, CONSOLE };
 	size_t num_lines = sizeof(lines_to_check) / sizeof(lines_to_check[0]);
 
 	for (size_t i = 0; i < num_lines; i++) {
@@ -358,6 +410,9 @@ static void uart_kernel_interrupt_handler(u32 irq, void *data)
 			continue;
 		}
 
+		irq_latency_source(line == CONSOLE ? IRQ_LATENCY_CONSOLE_UART : IRQ_LATENCY_MARKLIN_UART,
+				   irq_latency_exception_time());
+
 		// Handle RX interrupts (data available)
 		if (status & (UART_INT_RX | UART_INT_RT)) {
 			uart_clear_rx_interrupt(line);
@@ -388,6 +443,7 @@ void uart_init_interrupts(void)
 	}
 
 	interrupt_set_type(IRQ_UART, IRQ_TYPE_LEVEL_HIGH);
+	interrupt_set_priority(IRQ_UART, IRQ_PRIORITY_UART);
 	interrupt_enable(IRQ_UART);
 	klog_info("Enabled UART interrupt (IRQ %d)", IRQ_UART);
 
@@ -34,6 +34,12 @@ int Create(int priority, void (*function)())
 	return syscall(SYS_CREATE, args);
 }
 
+int CreateWithStack(int priority, void (*function)(), int stack_size)
+{
+	long args[6] = { (long)priority, (long)function, (long)stack_size, 0, 0, 0 };
+	return syscall(SYS_CREATE_WITH_STACK, args);
+}
+
 int MyTid()
 {
 	long args[6] = { 0, 0, 0, 0, 0, 0 };
@@ -82,6 +88,18 @@ int Reply(int tid, const char *reply, int rplen)
 	return syscall(SYS_REPLY, args);
 }
 
+int ReceiveMany(int *tids, int *msglens, char *msgs, int msglen, int max_msgs)
+{
+	long args[6] = { (long)tids, (long)msglens, (long)msgs, (long)msglen, (long)max_msgs, 0 };
+	return syscall(SYS_RECEIVE_MANY, args);
+}
+
+int ReplyMany(const int *tids, const char *replies, int rplen, int count)
+{
+	long args[6] = { (long)tids, (long)replies, (long)rplen, (long)count, 0, 0 };
+	return syscall(SYS_REPLY_MANY, args);
+}
+
 int KLog(u8 level, const char *msg)
 {
 	long args[6] = { (long)level, (long)msg, 0, 0, 0, 0 };
@@ -131,6 +149,54 @@ int GetTaskInfo(char *buffer, int buffer_size)
 	return syscall(SYS_GET_TASK_INFO, args);
 }
 
+int GetTaskStats(int tid, task_stats_t *stats, int max_tasks)
+{
+	long args[6] = { (long)tid, (long)stats, (long)max_tasks, 0, 0, 0 };
+	return syscall(SYS_GET_TASK_STATS, args);
+}
+
+int GetIpcLatency(int tid, ipc_latency_t *latency, int reset)
+{
+	long args[6] = { (long)tid, (long)latency, (long)reset, 0, 0, 0 };
+	return syscall(SYS_GET_IPC_LATENCY, args);
+}
+
+int Profile(int cmd, int arg, profile_report_t *report)
+{
+	long args[6] = { (long)cmd, (long)arg, (long)report, 0, 0, 0 };
+	return syscall(SYS_PROFILE, args);
+}
+
+int GetIrqLatency(irq_latency_t *latency, int max_sources, int reset)
+{
+	long args[6] = { (long)latency, (long)max_sources, (long)reset, 0, 0, 0 };
+	return syscall(SYS_GET_IRQ_LATENCY, args);
+}
+
+int GetClockTime(clock_time_t *time)
+{
+	long args[6] = { (long)time, 0, 0, 0, 0, 0 };
+	return syscall(SYS_GET_CLOCK_TIME, args);
+}
+
+int RequestTick(int tick)
+{
+	long args[6] = { (long)tick, 0, 0, 0, 0, 0 };
+	return syscall(SYS_REQUEST_TICK, args);
+}
+
+int SleepUs(u64 time_us, int absolute)
+{
+	long args[6] = { (long)time_us, (long)absolute, 0, 0, 0, 0 };
+	return syscall(SYS_SLEEP_US, args);
+}
+
+int ConsoleWrite(const char *buf, int len)
+{
+	long args[6] = { (long)buf, (long)len, 0, 0, 0, 0 };
+	return syscall(SYS_CONSOLE_WRITE, args);
+}
+
 void __noreturn Reboot()
 {
 	long args[6] = { 0, 0, 0, 0, 0, 0 };
@@ -149,3 +215,9 @@ int ToggleIdleDisplay(void)
 	long args[6] = { 0, 0, 0, 0, 0, 0 };
 	return syscall(SYS_TOGGLE_IDLE_DISPLAY, args);
 }
+
+int TraceDump(void *buffer, int buffer_size)
+{
+	long args[6] = { (long)buffer, (long)buffer_size, 0, 0, 0, 0 };
+	return syscall(SYS_TRACE_DUMP, args);
+}